@@ -0,0 +1,30 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_ALIGN 64 // every block starts on a cache line
+
+#define ARENA_SMALLPAGES 0 // ordinary pages
+#define ARENA_TRANSPARENT 1 // ordinary pages the kernel is asked to back with transparent huge pages
+#define ARENA_HUGETLB 2	 // pages from the reserved huge page pool
+
+/**
+ * A block of memory reserved once and handed out front to back. Blocks are never freed one by one; the
+ * whole arena goes at once.
+ */
+typedef struct
+{
+	char *base;	   // first byte, NULL if there is no arena
+	size_t size;   // bytes reserved
+	size_t used;   // bytes handed out
+	int pages;	   // ARENA_SMALLPAGES, ARENA_TRANSPARENT or ARENA_HUGETLB
+} Arena;
+
+int arena_create(Arena *arena, size_t bytes, int huge_pages);
+void *arena_alloc(Arena *arena, size_t bytes);
+void arena_destroy(Arena *arena);
+void arena_advise_huge(void *memory, size_t bytes);
+size_t arena_block_size(size_t bytes);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef _BOARD_H
+#define _BOARD_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define FAILURE -1
+#define SUCCESS 0
+
+#define BOARDSIDE 8 // squares per side of the bitboard
+#define LEGALMOVSBUFSIZE 65
+#define POSITIONSTRLEN 67 // 64 squares, a space, the side to move and the terminator
+
+#define FILE_A 0x0101010101010101ULL
+#define FILE_H 0x8080808080808080ULL
+
+#define SYMMETRIES 8		  // transformations of the board onto itself, 0 being the identity
+#define SYMMETRY_MIRROR 1	  // symmetry bit: columns reversed
+#define SYMMETRY_FLIP 2		  // symmetry bit: rows reversed
+#define SYMMETRY_TRANSPOSE 4 // symmetry bit: rows and columns swapped, applied first
+
+extern const int EMPTY;
+extern const int BLACK;
+extern const int WHITE;
+extern const int ALLDIRECTIONS[8];
+extern const char piecenames[4];
+
+extern uint64_t ZOBRIST[2][64];
+extern uint64_t ZOBRIST_SIDE;
+extern uint64_t ZOBRIST_PASSED;
+
+/**
+ * A game state. The disc bitboards are indexed by colour (discs[BLACK - 1], discs[WHITE - 1]);
+ * bit 0 is square "00" and bit 63 is square "77".
+ */
+typedef struct
+{
+	uint64_t discs[2]; // bitboards of the black and white discs
+	uint64_t hash;	   // Zobrist key of the discs, the side to move and the pass
+	uint8_t to_move;   // BLACK or WHITE
+	uint8_t empties;   // number of empty squares
+	uint8_t passed;	   // 1 if the previous move was a pass
+} Position;
+
+uint64_t rng_next(uint64_t *state);
+void initialise_zobrist();
+void initialise_position(Position *pos);
+uint64_t hash_position(const Position *pos);
+void position_to_string(const Position *pos, char *str);
+int position_from_string(const char *str, Position *pos);
+void get_move_string(int loc, char *ms);
+int get_loc(char *movestring);
+void move_to_string(int loc, int size, char *ms);
+int move_from_string(const char *movestring, int size);
+uint64_t shift(uint64_t discs, int dir);
+uint64_t mobility(uint64_t own, uint64_t opp);
+int legal_moves(const Position *pos, int *moves);
+int legalp(const Position *pos, int move);
+int validp(int move);
+uint64_t would_flip(const Position *pos, int move);
+int opponent(int player);
+void make_move(Position *pos, int move);
+void make_pass(Position *pos);
+void print_board(FILE *fp, const Position *pos);
+char nameof(int piece);
+int count(const Position *pos, int player);
+uint64_t transform_discs(uint64_t discs, int symmetry);
+int transform_move(int move, int symmetry);
+int inverse_symmetry(int symmetry);
+void transform_position(const Position *pos, int symmetry, Position *out);
+int canonical_position(const Position *pos, Position *canonical);
+uint64_t canonical_hash(const Position *pos);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef _EVAL_H
+#define _EVAL_H
+
+#include "board.h"
+
+#define WINSCORE 10000 // added to the disc difference of a won game so it outranks any evaluation
+#define MAXBATCH 64 // most positions scored by one evaluate_batch call
+#define PLAYABLESQUARES 64
+#define CORNERS 0x8100000000000081ULL
+#define STABLEWEIGHT 6	 // per stable disc
+#define FRONTIERWEIGHT 1 // per frontier disc, counted against its owner
+
+extern const int SQUARE_WEIGHTS[64];
+
+int evaluate(const Position *pos, int player);
+int evaluate_discs(uint64_t own, uint64_t opp);
+void evaluate_batch(int player, const Position *positions, int amount_of_positions, int *scores);
+int evaluate_children(const Position *pos, int player, int *moves, int amount_of_moves, int *scores);
+int final_score(const Position *pos, int player);
+
+#endif
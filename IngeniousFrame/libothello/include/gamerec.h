@@ -0,0 +1,58 @@
+#ifndef _GAMEREC_H
+#define _GAMEREC_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "board.h"
+
+#define GAMEREC_MAXPLIES 128	// longest game: 60 moves and as many passes
+#define GAMEREC_PASS 64			// move byte of a pass
+#define GAMEREC_NOSCORE INT16_MIN // score of a ply that was not searched
+#define GAMEREC_DATA ".ogr"		// suffix of a game record file
+#define GAMEREC_INDEX ".ogi"	// suffix of its index
+#define GAMEREC_MAGIC "OGR1"	// first four bytes of a game record file
+#define GAMEREC_PATHBUFSIZE 4096
+
+/**
+ * One game from the starting position. A record is stored as four header bytes (plies, opening plies, result
+ * and a reserved zero), one byte per move, then one little-endian 16-bit score per move.
+ */
+typedef struct
+{
+	uint8_t num_plies;						// moves and passes played
+	uint8_t opening_plies;					// leading moves that were chosen at random
+	int8_t result;							// final disc difference, black minus white
+	uint8_t moves[GAMEREC_MAXPLIES];		// squares played, GAMEREC_PASS for a pass
+	int16_t scores[GAMEREC_MAXPLIES];		// search score for the player to move, or GAMEREC_NOSCORE
+} GameRecord;
+
+/**
+ * An append-only game record file and its index of record offsets (8 bytes per game).
+ */
+typedef struct
+{
+	FILE *data;
+	FILE *index;
+	long long games; // games in the file, including those appended
+} GameWriter;
+
+/**
+ * A game record file opened for reading, sequentially or by game number through the index.
+ */
+typedef struct
+{
+	FILE *data;
+	FILE *index;
+	long long games; // games listed in the index
+} GameReader;
+
+int gamerec_open_writer(GameWriter *writer, const char *prefix);
+int gamerec_append(GameWriter *writer, const GameRecord *game);
+void gamerec_close_writer(GameWriter *writer);
+int gamerec_open_reader(GameReader *reader, const char *prefix);
+int gamerec_read(GameReader *reader, GameRecord *game);
+int gamerec_seek(GameReader *reader, long long game_number);
+void gamerec_close_reader(GameReader *reader);
+int gamerec_replay(const GameRecord *game, int ply, Position *pos);
+
+#endif
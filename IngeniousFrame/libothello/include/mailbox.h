@@ -0,0 +1,43 @@
+#ifndef _MAILBOX_H
+#define _MAILBOX_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "board.h"
+
+#define MAILBOX_MINSIZE 4	// smallest board side
+#define MAILBOX_MAXSIZE 16	// largest board side, so that a coordinate has at most two digits
+#define MAILBOX_CELLS ((MAILBOX_MAXSIZE + 2) * (MAILBOX_MAXSIZE + 2)) // the largest board with its border
+#define MAILBOX_MOVESBUFSIZE (MAILBOX_MAXSIZE * MAILBOX_MAXSIZE + 1)
+#define MAILBOX_STRLEN (MAILBOX_MAXSIZE * MAILBOX_MAXSIZE + 3) // squares, a space, the side to move and the terminator
+#define MAILBOX_OUTSIDE 3		 // cell of the border around the board
+#define MAILBOX_MOBILITYWEIGHT 1 // per move more than the opponent has
+
+/**
+ * A game state on a square board of any even side from MAILBOX_MINSIZE to MAILBOX_MAXSIZE, kept as a mailbox:
+ * one cell per square, row by row, with a border of MAILBOX_OUTSIDE cells so that a line of discs always ends
+ * at the edge. Moves are numbered row * size + column, as on the bitboard, which is the faster choice for 8x8.
+ */
+typedef struct
+{
+	uint8_t cells[MAILBOX_CELLS]; // EMPTY, BLACK, WHITE or MAILBOX_OUTSIDE, size + 2 cells per row
+	uint8_t size;				  // squares per side
+	uint8_t to_move;			  // BLACK or WHITE
+	uint8_t passed;				  // 1 if the previous move was a pass
+	uint16_t empties;			  // number of empty squares
+} MailboxPosition;
+
+int mailbox_initialise(MailboxPosition *pos, int size);
+int mailbox_legal_moves(const MailboxPosition *pos, int *moves);
+int mailbox_flips(const MailboxPosition *pos, int move);
+void mailbox_make_move(MailboxPosition *pos, int move);
+void mailbox_make_pass(MailboxPosition *pos);
+int mailbox_count(const MailboxPosition *pos, int player);
+int mailbox_evaluate(const MailboxPosition *pos, int player);
+int mailbox_minimax(const MailboxPosition *pos, int player, int depth, int alpha, int beta);
+int mailbox_solve(const MailboxPosition *pos, int alpha, int beta);
+void mailbox_to_string(const MailboxPosition *pos, char *str);
+int mailbox_from_string(const char *str, MailboxPosition *pos);
+void mailbox_print(FILE *fp, const MailboxPosition *pos);
+
+#endif
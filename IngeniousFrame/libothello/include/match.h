@@ -0,0 +1,10 @@
+#ifndef _MATCH_H
+#define _MATCH_H
+
+#define MATCHCONFIG "Othello.json" // match settings that run_match.sh and run_rr.py write for the referee
+#define MATCHCONFIGBUFSIZE 4096
+#define MATCHNAMEBUFSIZE 64
+
+int match_setting(const char *path, const char *name, int fallback);
+
+#endif
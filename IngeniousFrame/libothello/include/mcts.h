@@ -0,0 +1,56 @@
+#ifndef _MCTS_H
+#define _MCTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "board.h"
+
+#define MCTS_PASS 64	   // move of a pass node
+#define MCTS_UNEXPANDED -1 // first_child of a node whose children are not generated yet
+#define MCTS_TERMINAL -2   // first_child of a node where the game is over
+#define MCTS_MAXPATH 130   // longest selection path: 60 moves and as many passes, plus the root
+#define MCTS_SLOTS (MCTS_PASS + 1) // statistics slots per tree level, one per move
+
+/**
+ * A tree node. Children of a node are stored next to each other in the pool starting at first_child.
+ * Wins are counted for the player who made the move leading to the node.
+ */
+typedef struct
+{
+	int32_t first_child;  // pool index of the first child, MCTS_UNEXPANDED or MCTS_TERMINAL
+	uint32_t visits;	  // playouts through this node
+	float wins;			  // playouts won by the player who moved here, draws count one half
+	float prior;		  // prior probability of the move, used by PUCT selection
+	uint8_t move;		  // square of the move leading here, or MCTS_PASS
+	uint8_t num_children; // number of children
+	uint8_t player;		  // player who made the move leading here
+} MCTSNode;
+
+/**
+ * A search tree with its node pool. Nodes are never allocated one by one: expansion takes a block of
+ * children from the pool, and re-rooting copies the surviving subtree into the spare pool.
+ */
+typedef struct
+{
+	MCTSNode *nodes;		 // node pool, the root is nodes[0]
+	MCTSNode *spare;		 // second pool of the same size, used when re-rooting
+	int capacity;			 // nodes in each pool
+	int used;				 // nodes taken from the pool
+	Position root_position;	 // position at the root
+	double exploration;		 // exploration constant of the selection rule
+	int use_puct;			 // 1 for PUCT selection with square-weight priors, 0 for UCT
+	uint64_t rng;			 // random number generator state for playouts
+	long long playouts;		 // playouts since the last re-root
+} MCTSTree;
+
+int mcts_create(MCTSTree *tree, void *memory, int capacity, double exploration, int use_puct, uint64_t seed);
+size_t mcts_pool_bytes(int capacity);
+void mcts_set_root(MCTSTree *tree, const Position *pos);
+void mcts_iterate(MCTSTree *tree);
+int mcts_best_move(const MCTSTree *tree);
+int mcts_statistics_size(int levels);
+void mcts_gather(const MCTSTree *tree, int levels, double *visits, double *wins);
+void mcts_add(MCTSTree *tree, int levels, const double *visits, const double *wins);
+int playout(Position pos, uint64_t *rng);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef _NET_H
+#define _NET_H
+
+#include <stdint.h>
+#include "board.h"
+
+#define NET_INPUTS 128		// a disc of the player scored for on each square, then an opponent's disc on each
+#define NET_HIDDEN1 32		// first layer, the accumulator
+#define NET_HIDDEN2 32		// second layer
+#define NET_BUCKETS 4		// sets of second and output layers, one per stage of the game
+#define NET_BUCKETMOVES 15	// moves per stage
+#define NET_ONE 127			// an activation of 1, the most a clipped activation can be
+#define NET_WEIGHTSCALE 64	// second and output layer weights are in 1/64ths
+#define NET_WEIGHTSHIFT 6	// log2 of NET_WEIGHTSCALE
+#define NET_SCORESCALE 8	// evaluation units per disc of predicted final margin
+#define NET_MAXPLY 128		// longer than any line of moves and passes
+#define NET_MAGIC "ONN1"	// first four bytes of a network file
+
+/**
+ * The first layer of the network for one position, from each player's point of view: values[c] is the bias
+ * plus the weights of every input active when colour c + 1 is scored for. It changes only by the weights of
+ * the discs that are placed or flipped, so a child's accumulator is its parent's plus a few rows.
+ */
+typedef struct
+{
+	int16_t values[2][NET_HIDDEN1] __attribute__((aligned(32)));
+} NetAccumulator;
+
+/**
+ * A quantised network: 128 inputs, two clipped-ReLU layers of 32 and one output, predicting the final disc
+ * difference for the player scored for. The first layer is shared by the whole game; the second and output
+ * layers come in NET_BUCKETS sets, picked by the number of moves played. The first layer is in 1/127ths, the
+ * second layer's weights and the output weights in 1/64ths. A file holds NET_MAGIC, then every array below in
+ * order, little-endian.
+ */
+typedef struct
+{
+	int16_t weights1[NET_INPUTS][NET_HIDDEN1] __attribute__((aligned(64))); // one cache line per input
+	int16_t bias1[NET_HIDDEN1];
+	int8_t weights2[NET_BUCKETS][NET_HIDDEN2][NET_HIDDEN1] __attribute__((aligned(32))); // by output
+	int32_t bias2[NET_BUCKETS][NET_HIDDEN2];
+	int16_t weights3[NET_BUCKETS][NET_HIDDEN2];
+	int32_t bias3[NET_BUCKETS];
+} Network;
+
+int net_load(Network *net, const char *path);
+int net_save(const Network *net, const char *path);
+void net_refresh(const Network *net, const Position *pos, NetAccumulator *acc);
+void net_update(const Network *net, const NetAccumulator *from, const Position *before, const Position *after,
+				NetAccumulator *to);
+int net_evaluate(const Network *net, const NetAccumulator *acc, const Position *pos, int player);
+int net_evaluate_children(const Network *net, const NetAccumulator *acc, const Position *pos, int player, int *moves,
+						  int amount_of_moves, int *scores);
+int net_bucket(int empties);
+const char *net_kernel(void);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef _OTHELLO_H
+#define _OTHELLO_H
+
+/*
+ * Public header of libothello, the Othello core shared by the players, the
+ * benchmarks and the tools:
+ *     board.h   positions, move generation, Zobrist hashing, move strings
+ *     mailbox.h boards of sizes other than 8x8, with their own search and solver
+ *     eval.h    static evaluation, one position at a time or in batches
+ *     net.h     quantised network evaluation with incremental accumulators
+ *     stability.h stable discs, frontier and potential mobility on bitboards
+ *     search.h  Alpha/Beta MiniMax search with node counting
+ *     solve.h   exact and win/loss/draw endgame solver
+ *     tt.h      lockless transposition table on caller-provided memory
+ *     mcts.h    Monte Carlo Tree Search with a preallocated node pool
+ *     gamerec.h compact binary game records with an index
+ *     perf.h    hardware performance counters per search phase
+ *     arena.h   memory reserved at start-up and handed out in blocks
+ *     match.h   the match settings of Othello.json
+ */
+
+#include "board.h"
+#include "mailbox.h"
+#include "eval.h"
+#include "net.h"
+#include "stability.h"
+#include "tt.h"
+#include "search.h"
+#include "solve.h"
+#include "mcts.h"
+#include "gamerec.h"
+#include "perf.h"
+#include "arena.h"
+#include "match.h"
+
+#endif
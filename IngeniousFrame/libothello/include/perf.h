@@ -0,0 +1,52 @@
+#ifndef _PERF_H
+#define _PERF_H
+
+#include <stdint.h>
+
+#define PERF_MOVEGEN 0 // legal move generation
+#define PERF_MAKE 1	   // making moves and passes, including the hash update
+#define PERF_EVAL 2	   // static evaluation and final scores
+#define PERF_HASH 3	   // transposition table probes and stores, local and remote
+#define PERF_MPI 4	   // waiting for and exchanging MPI messages
+#define PERF_PHASES 5
+#define PERF_TOTAL PERF_PHASES // row of the counts taken over the whole run
+
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_BRANCHMISSES 2
+#define PERF_L1DMISSES 3
+#define PERF_LLCMISSES 4
+#define PERF_EVENTS 5
+
+/**
+ * Hardware events counted per phase, and how often each phase was entered. Row PERF_TOTAL holds the events
+ * since perf_open, so that the time outside the phases can be told apart.
+ */
+typedef struct
+{
+	uint64_t events[PERF_PHASES + 1][PERF_EVENTS];
+	uint64_t calls[PERF_PHASES];
+} PerfCounts;
+
+extern const char *PERF_PHASENAMES[PERF_PHASES];
+extern const char *PERF_EVENTNAMES[PERF_EVENTS];
+
+/*
+ * The phase markers cost nothing unless the player is built with -DPERF_COUNTERS (make release-perf). Phases
+ * must not nest.
+ */
+#ifdef PERF_COUNTERS
+#define PERF_BEGIN(phase) perf_begin(phase)
+#define PERF_END(phase) perf_end(phase)
+#else
+#define PERF_BEGIN(phase)
+#define PERF_END(phase)
+#endif
+
+int perf_open(void);
+void perf_close(void);
+void perf_begin(int phase);
+void perf_end(int phase);
+int perf_counts(PerfCounts *counts);
+
+#endif
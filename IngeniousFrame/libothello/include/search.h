@@ -0,0 +1,25 @@
+#ifndef _SEARCH_H
+#define _SEARCH_H
+
+#include "board.h"
+#include "net.h"
+#include "tt.h"
+
+extern long long nodes_searched;
+extern long long node_limit;
+extern int search_aborted;
+extern void (*search_poll)(void);
+extern long long poll_interval;
+extern long long next_poll;
+extern TranspositionTable *search_table;
+extern int (*remote_probe)(uint64_t hash, int player, TTData *data);
+extern void (*remote_store)(uint64_t hash, int player, const TTData *data);
+extern int remote_depth;
+extern const Network *search_network;
+
+int minimax(const Position *pos, int player, int depth, int alpha, int beta);
+int search_pv(const Position *pos, int player, int *pv, int max_length);
+int max(int value1, int value2);
+int min(int value1, int value2);
+
+#endif
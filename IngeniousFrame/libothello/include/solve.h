@@ -0,0 +1,17 @@
+#ifndef _SOLVE_H
+#define _SOLVE_H
+
+#include "board.h"
+
+#define SOLVE_MAXSCORE 64	 // largest disc difference
+#define SOLVE_KEY 0x5f1e9d3c7a2b4e61ULL // XORed into table keys, so solver entries never match search entries
+#define SOLVE_TTEMPTIES 7	 // fewest empties at which the table is used
+#define SOLVE_ETCEMPTIES 10	 // fewest empties at which every child is looked up before any is searched
+#define SOLVE_ORDEREMPTIES 6 // fewest empties at which moves are ordered fastest-first
+#define SOLVE_STABLEEMPTIES 5 // fewest empties at which the stability cutoff is tried
+
+int solve(const Position *pos, int alpha, int beta);
+int solve_order(const Position *pos, int *moves, int amount_of_moves);
+int disc_difference(const Position *pos);
+
+#endif
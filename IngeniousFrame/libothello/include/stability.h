@@ -0,0 +1,21 @@
+#ifndef _STABILITY_H
+#define _STABILITY_H
+
+#include <stdint.h>
+#include "board.h"
+
+#define RANK_1 0x00000000000000ffULL // row "0", squares "00" to "07"
+#define RANK_8 0xff00000000000000ULL // row "7", squares "70" to "77"
+#define EDGES (RANK_1 | RANK_8 | FILE_A | FILE_H)
+
+extern uint8_t EDGE_STABILITY[256][256];
+
+void initialise_stability();
+uint64_t neighbours(uint64_t discs);
+uint64_t full_lines(uint64_t filled, int dir);
+uint64_t edge_stable(uint64_t own, uint64_t opp);
+uint64_t stable_discs(uint64_t own, uint64_t opp);
+uint64_t frontier(uint64_t own, uint64_t opp);
+int potential_mobility(uint64_t own, uint64_t opp);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef _TT_H
+#define _TT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TT_BUCKETSIZE 4	// entries per bucket, one 64-byte cache line
+#define TT_MINDEPTH 2	// shallowest remaining depth that is probed and stored
+#define TT_NOMOVE 0xff	// move of an entry without a best move
+
+#define TT_EXACT 0 // the score is exact
+#define TT_LOWER 1 // the score is a lower bound (the search failed high)
+#define TT_UPPER 2 // the score is an upper bound (the search failed low)
+
+/**
+ * A table entry. The key is stored XORed with the data, so an entry torn by two ranks writing it at the same
+ * time no longer matches any position and is simply ignored; no locks are needed.
+ */
+typedef struct
+{
+	uint64_t key;  // Zobrist key of the position XOR data
+	uint64_t data; // packed score, depth, bound, player, move and generation
+} TTEntry;
+
+/**
+ * What the table knows about a position.
+ */
+typedef struct
+{
+	int score; // score for the maximised player
+	int depth; // remaining depth the score was searched to
+	int bound; // TT_EXACT, TT_LOWER or TT_UPPER
+	int move;  // best or refuting move, TT_NOMOVE if unknown
+} TTData;
+
+/**
+ * A view of a table held in memory the caller provides, which may be shared with other processes.
+ */
+typedef struct
+{
+	TTEntry *entries;	 // first entry, aligned to a cache line
+	uint64_t mask;		 // number of buckets minus one
+	uint8_t generation;	 // age of the current search, entries of older searches are replaced first
+} TranspositionTable;
+
+size_t tt_attach(TranspositionTable *tt, void *memory, size_t bytes);
+void tt_clear(TranspositionTable *tt);
+void tt_new_search(TranspositionTable *tt);
+int tt_probe(const TranspositionTable *tt, uint64_t hash, int player, TTData *data);
+void tt_store(TranspositionTable *tt, uint64_t hash, int player, const TTData *data);
+void tt_make_entry(TTEntry *entry, uint64_t hash, int player, const TTData *data, uint8_t generation);
+int tt_read_entry(const TTEntry *entry, uint64_t hash, int player, TTData *data);
+
+#endif
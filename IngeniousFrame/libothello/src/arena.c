@@ -0,0 +1,131 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Arenas: one mmap per arena at start-up, handed out in cache-line
+ *    aligned blocks, so that nothing is allocated while a game is played
+ *    and the memory a rank uses is known up front. The pages are touched
+ *    when the arena is created, so that they count against the process at
+ *    once rather than at the first search that needs them.
+ *
+ *H***********************************************************************/
+
+#include <string.h>
+#include <sys/mman.h>
+#include "board.h"
+#include "arena.h"
+
+/**
+ * @brief Reserves an arena. With huge pages it first tries the reserved huge page pool, then asks for
+ * 		  transparent huge pages, and otherwise settles for ordinary pages.
+ *
+ * @param arena The arena to create.
+ * @param bytes The bytes to reserve.
+ * @param huge_pages 1 to back the arena with huge pages where the system allows it.
+ * @return SUCCESS, or FAILURE if the memory could not be mapped.
+ */
+int arena_create(Arena *arena, size_t bytes, int huge_pages)
+{
+	void *memory = MAP_FAILED;
+
+	arena->base = NULL;
+	arena->size = 0;
+	arena->used = 0;
+	arena->pages = ARENA_SMALLPAGES;
+	if (bytes == 0)
+	{
+		return SUCCESS;
+	}
+#ifdef MAP_HUGETLB
+	if (huge_pages)
+	{
+		size_t huge = (bytes + (2 << 20) - 1) & ~(size_t)((2 << 20) - 1); // Whole 2 MB pages
+		memory = mmap(NULL, huge, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (memory != MAP_FAILED)
+		{
+			bytes = huge;
+			arena->pages = ARENA_HUGETLB;
+		}
+	}
+#endif
+	if (memory == MAP_FAILED)
+	{
+		memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED)
+		{
+			return FAILURE;
+		}
+		if (huge_pages)
+		{
+			arena_advise_huge(memory, bytes);
+			arena->pages = ARENA_TRANSPARENT;
+		}
+	}
+	memset(memory, 0, bytes); // Faults every page in now
+	arena->base = (char *)memory;
+	arena->size = bytes;
+	return SUCCESS;
+}
+/**
+ * @brief Hands out the next block of an arena.
+ *
+ * @param arena The arena.
+ * @param bytes The size of the block.
+ * @return The block, zeroed and aligned to ARENA_ALIGN, or NULL if the arena has no room left.
+ */
+void *arena_alloc(Arena *arena, size_t bytes)
+{
+	size_t block = arena_block_size(bytes);
+
+	if (arena->base == NULL || block > arena->size - arena->used)
+	{
+		return NULL;
+	}
+	void *memory = arena->base + arena->used;
+	arena->used += block;
+	return memory;
+}
+/**
+ * @brief Returns an arena's memory to the system. Every block handed out goes with it.
+ *
+ * @param arena The arena.
+ */
+void arena_destroy(Arena *arena)
+{
+	if (arena->base != NULL)
+	{
+		munmap(arena->base, arena->size);
+	}
+	arena->base = NULL;
+	arena->size = 0;
+	arena->used = 0;
+}
+/**
+ * @brief Asks the kernel to back memory with transparent huge pages, for memory not taken from an arena such
+ * 		  as an MPI window. Only the whole pages inside the range are advised; failures are ignored.
+ *
+ * @param memory The memory.
+ * @param bytes Its size.
+ */
+void arena_advise_huge(void *memory, size_t bytes)
+{
+#ifdef MADV_HUGEPAGE
+	size_t page = 4096;
+	char *start = (char *)(((size_t)memory + page - 1) & ~(page - 1));
+	char *end = (char *)(((size_t)memory + bytes) & ~(page - 1));
+	if (end > start)
+	{
+		madvise(start, end - start, MADV_HUGEPAGE);
+	}
+#endif
+}
+/**
+ * @brief The room a block takes in an arena, so that callers can size an arena for the blocks they need.
+ *
+ * @param bytes The size of the block.
+ * @return The size rounded up to ARENA_ALIGN.
+ */
+size_t arena_block_size(size_t bytes)
+{
+	return (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
@@ -0,0 +1,555 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Board representation shared by the players: positions, move
+ *    generation, hashing, move strings and printing.
+ *
+ *H***********************************************************************/
+
+#include <stdio.h>
+#include <assert.h>
+#include "board.h"
+
+const int EMPTY = 0;
+const int BLACK = 1;
+const int WHITE = 2;
+const int ALLDIRECTIONS[8] = {-9, -8, -7, -1, 1, 7, 8, 9};
+const char piecenames[4] = {'.', 'b', 'w', '?'};
+
+uint64_t ZOBRIST[2][64]; // Zobrist keys per colour and square
+uint64_t ZOBRIST_SIDE;	 // Zobrist key toggled when white is to move
+uint64_t ZOBRIST_PASSED; // Zobrist key toggled when the previous move was a pass
+
+/**
+ * @brief Returns the next number from a splitmix64 generator.
+ *
+ * @param state The generator state.
+ * @return A uniformly distributed 64-bit number.
+ */
+uint64_t rng_next(uint64_t *state)
+{
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+/**
+ * @brief Fills the Zobrist key tables from a fixed seed so that every rank computes the same keys.
+ */
+void initialise_zobrist()
+{
+	uint64_t state = 0x9E3779B97F4A7C15ULL;
+	for (int i = 0; i < 2 * 64; i++)
+	{
+		ZOBRIST[i / 64][i % 64] = rng_next(&state);
+	}
+	ZOBRIST_SIDE = rng_next(&state);
+	ZOBRIST_PASSED = rng_next(&state); // Drawn last, so the other keys are unchanged
+}
+/**
+ * @brief Initilizes a position to the starting gameboard with black to move.
+ *
+ * @param pos The position to initialise.
+ */
+void initialise_position(Position *pos)
+{
+	pos->discs[BLACK - 1] = (1ULL << 28) | (1ULL << 35); // "34" and "43"
+	pos->discs[WHITE - 1] = (1ULL << 27) | (1ULL << 36); // "33" and "44"
+	pos->to_move = BLACK;
+	pos->empties = 60;
+	pos->passed = 0;
+	pos->hash = hash_position(pos);
+}
+/**
+ * @brief Computes the Zobrist hash of a position from scratch.
+ *
+ * @param pos The position to hash.
+ * @return The hash key.
+ */
+uint64_t hash_position(const Position *pos)
+{
+	uint64_t hash = 0;
+	for (int colour = 0; colour < 2; colour++)
+	{
+		uint64_t discs = pos->discs[colour];
+		while (discs)
+		{
+			hash ^= ZOBRIST[colour][__builtin_ctzll(discs)];
+			discs &= discs - 1;
+		}
+	}
+	if (pos->to_move == WHITE)
+	{
+		hash ^= ZOBRIST_SIDE;
+	}
+	if (pos->passed) // After a pass the game ends if this side cannot move either
+	{
+		hash ^= ZOBRIST_PASSED;
+	}
+	return hash;
+}
+/**
+ * @brief Serialises a position for logs and books: 64 square characters in row order, a space and the
+ * 		  side to move, e.g. "...........................wb......bw........................... b".
+ *
+ * @param pos The position to serialise.
+ * @param str The output string of at least POSITIONSTRLEN characters.
+ */
+void position_to_string(const Position *pos, char *str)
+{
+	for (int sq = 0; sq < 64; sq++)
+	{
+		if (pos->discs[BLACK - 1] >> sq & 1)
+			str[sq] = nameof(BLACK);
+		else if (pos->discs[WHITE - 1] >> sq & 1)
+			str[sq] = nameof(WHITE);
+		else
+			str[sq] = nameof(EMPTY);
+	}
+	str[64] = ' ';
+	str[65] = nameof(pos->to_move);
+	str[66] = 0;
+}
+/**
+ * @brief Parses a position written by position_to_string.
+ *
+ * @param str The serialised position.
+ * @param pos The position to fill in.
+ * @return SUCCESS, or FAILURE if the string is malformed.
+ */
+int position_from_string(const char *str, Position *pos)
+{
+	pos->discs[0] = 0;
+	pos->discs[1] = 0;
+	for (int sq = 0; sq < 64; sq++)
+	{
+		if (str[sq] == nameof(BLACK))
+			pos->discs[BLACK - 1] |= 1ULL << sq;
+		else if (str[sq] == nameof(WHITE))
+			pos->discs[WHITE - 1] |= 1ULL << sq;
+		else if (str[sq] != nameof(EMPTY))
+			return FAILURE;
+	}
+	if (str[64] != ' ' || (str[65] != nameof(BLACK) && str[65] != nameof(WHITE)))
+	{
+		return FAILURE;
+	}
+	pos->to_move = (str[65] == nameof(BLACK)) ? BLACK : WHITE;
+	pos->empties = 64 - __builtin_popcountll(pos->discs[0] | pos->discs[1]);
+	pos->passed = 0;
+	pos->hash = hash_position(pos);
+	return SUCCESS;
+}
+/**
+ * @brief Sets a location on the game board to its corresponding move string.
+ *
+ * @param loc The location on the game board.
+ * @param ms The output string to store the move string.
+ */
+void get_move_string(int loc, char *ms)
+{
+	move_to_string(loc, BOARDSIDE, ms);
+}
+/**
+ * @brief Converts a move string to its corresponding location on the game board.
+ *
+ * @param movestring The move string.
+ * @return The location on the game board, -1 if the string is not a square.
+ */
+int get_loc(char *movestring)
+{
+	return move_from_string(movestring, BOARDSIDE);
+}
+/**
+ * @brief Writes the move string of a square on a board of any size: the row and then the column, counted from
+ * 		  0 at the top left, each with as many digits as the largest coordinate needs. Boards of up to 10x10
+ * 		  keep the single-digit "xy" form; larger ones write e.g. "0311" for row 3, column 11.
+ *
+ * @param loc The square, row * size + column.
+ * @param size The squares per side.
+ * @param ms The output string of at least 6 characters, ending in a newline.
+ */
+void move_to_string(int loc, int size, char *ms)
+{
+	int width = (size > 10) ? 2 : 1;
+
+	sprintf(ms, "%0*d%0*d\n", width, loc / size, width, loc % size);
+}
+/**
+ * @brief Reads a move string written by move_to_string for the same board size.
+ *
+ * @param movestring The move string; anything after the digits is ignored.
+ * @param size The squares per side.
+ * @return The square, row * size + column, or -1 if the string is not a square of the board.
+ */
+int move_from_string(const char *movestring, int size)
+{
+	int width = (size > 10) ? 2 : 1;
+	int coordinates[2] = {0, 0};
+
+	for (int i = 0; i < 2 * width; i++)
+	{
+		if (movestring[i] < '0' || movestring[i] > '9')
+		{
+			return -1;
+		}
+		coordinates[i / width] = 10 * coordinates[i / width] + movestring[i] - '0';
+	}
+	if (coordinates[0] >= size || coordinates[1] >= size)
+	{
+		return -1;
+	}
+	return size * coordinates[0] + coordinates[1];
+}
+/**
+ * @brief Shifts every disc of a bitboard one square in a direction, dropping discs that would wrap
+ * 		  around the edge of the board.
+ *
+ * @param discs The bitboard to shift.
+ * @param dir The direction, one of ALLDIRECTIONS.
+ * @return The shifted bitboard.
+ */
+uint64_t shift(uint64_t discs, int dir)
+{
+	uint64_t shifted = (dir > 0) ? discs << dir : discs >> -dir;
+	if (dir == 1 || dir == 9 || dir == -7)
+		return shifted & ~FILE_A;
+	if (dir == -1 || dir == -9 || dir == 7)
+		return shifted & ~FILE_H;
+	return shifted;
+}
+/**
+ * @brief Computes every square where a player may move, for all directions at once.
+ *
+ * @param own The bitboard of the player to move.
+ * @param opp The bitboard of the opponent.
+ * @return The bitboard of legal moves.
+ */
+uint64_t mobility(uint64_t own, uint64_t opp)
+{
+	uint64_t empty = ~(own | opp);
+	uint64_t moves = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		uint64_t line = shift(own, ALLDIRECTIONS[i]) & opp;
+		for (int j = 0; j < 5; j++)
+		{
+			line |= shift(line, ALLDIRECTIONS[i]) & opp; // Extends the line of opponent discs
+		}
+		moves |= shift(line, ALLDIRECTIONS[i]) & empty;
+	}
+	return moves;
+}
+/**
+ * @brief Generate an array of legal moves for the player to move.
+ *
+ * @param pos The position.
+ * @param moves The output array to store the legal moves.
+ * @return The number of legal moves.
+ */
+int legal_moves(const Position *pos, int *moves)
+{
+	uint64_t mask = mobility(pos->discs[pos->to_move - 1], pos->discs[opponent(pos->to_move) - 1]);
+	int i = 0;
+	while (mask)
+	{
+		moves[i++] = __builtin_ctzll(mask);
+		mask &= mask - 1;
+	}
+	return i;
+}
+/**
+ * @brief Check if a move is legal for the player to move.
+ *
+ * @param pos The position.
+ * @param move The move to check.
+ * @return Returns 1 if the move is legal, 0 otherwise.
+ */
+int legalp(const Position *pos, int move)
+{
+	if (!validp(move))
+		return 0;
+	return (mobility(pos->discs[pos->to_move - 1], pos->discs[opponent(pos->to_move) - 1]) >> move) & 1;
+}
+/**
+ * @brief Check if a move is valid.
+ *
+ * @param move The move to check.
+ * @return Returns 1 if the move is valid, 0 otherwise.
+ */
+int validp(int move)
+{
+	if ((move >= 0) && (move <= 63))
+		return 1;
+	else
+		return 0;
+}
+/**
+ * @brief Finds the discs a move would flip for the player to move.
+ *
+ * @param pos The position.
+ * @param move The move to check.
+ * @return Returns the bitboard of flipped discs, 0 if the move flips nothing.
+ */
+uint64_t would_flip(const Position *pos, int move)
+{
+	uint64_t own = pos->discs[pos->to_move - 1];
+	uint64_t opp = pos->discs[opponent(pos->to_move) - 1];
+	uint64_t flips = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		uint64_t line = 0;
+		uint64_t square = shift(1ULL << move, ALLDIRECTIONS[i]);
+		while (square & opp)
+		{
+			line |= square;
+			square = shift(square, ALLDIRECTIONS[i]);
+		}
+		if (square & own) // Line is bracketed by one of our discs
+		{
+			flips |= line;
+		}
+	}
+	return flips;
+}
+/**
+ * @brief Get the opponent player.
+ *
+ * @param player The player.
+ * @return Returns the opponent player.
+ */
+int opponent(int player)
+{
+	assert(player == BLACK || player == WHITE);
+	return BLACK + WHITE - player;
+}
+/**
+Makes a move for the player to move and hands the turn to the opponent. The hash is updated incrementally.
+
+- @param pos The position to play the move on.
+- @param move The move to be made.
+*/
+void make_move(Position *pos, int move)
+{
+	int me = pos->to_move - 1;
+	int opp = opponent(pos->to_move) - 1;
+	uint64_t flips = would_flip(pos, move);
+
+	pos->discs[me] |= flips | (1ULL << move);
+	pos->discs[opp] &= ~flips;
+	pos->hash ^= ZOBRIST[me][move] ^ ZOBRIST_SIDE;
+	while (flips)
+	{
+		int sq = __builtin_ctzll(flips);
+		pos->hash ^= ZOBRIST[me][sq] ^ ZOBRIST[opp][sq];
+		flips &= flips - 1;
+	}
+	if (pos->passed)
+	{
+		pos->hash ^= ZOBRIST_PASSED;
+	}
+	pos->to_move = opponent(pos->to_move);
+	pos->empties--;
+	pos->passed = 0;
+}
+/**
+Passes the turn to the opponent.
+
+- @param pos The position to pass in.
+*/
+void make_pass(Position *pos)
+{
+	pos->to_move = opponent(pos->to_move);
+	pos->hash ^= ZOBRIST_SIDE ^ (pos->passed ? 0 : ZOBRIST_PASSED);
+	pos->passed = 1;
+}
+/**
+* @brief Prints the game board to a file.
+*
+* @param fp The file pointer for output.
+* @param pos The position to print.
+*/
+void print_board(FILE *fp, const Position *pos)
+{
+	int row, col;
+	fprintf(fp, "   1 2 3 4 5 6 7 8 [%c=%d %c=%d]\n",
+			nameof(BLACK), count(pos, BLACK), nameof(WHITE), count(pos, WHITE));
+	for (row = 0; row < 8; row++)
+	{
+		fprintf(fp, "%d  ", row + 1);
+		for (col = 0; col < 8; col++)
+		{
+			int sq = 8 * row + col;
+			if (pos->discs[BLACK - 1] >> sq & 1)
+				fprintf(fp, "%c ", nameof(BLACK));
+			else if (pos->discs[WHITE - 1] >> sq & 1)
+				fprintf(fp, "%c ", nameof(WHITE));
+			else
+				fprintf(fp, "%c ", nameof(EMPTY));
+		}
+		fprintf(fp, "\n");
+	}
+	fflush(fp);
+}
+/**
+* @brief Returns the name of a game piece.
+*
+* @param piece The game piece identifier.
+* @return The name of the game piece.
+*/
+char nameof(int piece)
+{
+	assert(0 <= piece && piece < 5);
+	return (piecenames[piece]);
+}
+/**
+* @brief Counts the number of game pieces for a player on the game board.
+*
+* @param pos The position.
+* @param player The player identifier.
+* @return The count of game pieces for the player.
+*/
+int count(const Position *pos, int player)
+{
+	return __builtin_popcountll(pos->discs[player - 1]);
+}
+/**
+ * @brief Maps a bitboard onto itself by one of the eight board symmetries: the rows and columns are swapped
+ * 		  when the SYMMETRY_TRANSPOSE bit is set, then the rows reversed for SYMMETRY_FLIP and the columns
+ * 		  for SYMMETRY_MIRROR.
+ *
+ * @param discs The bitboard.
+ * @param symmetry The symmetry, 0 to SYMMETRIES - 1.
+ * @return The transformed bitboard.
+ */
+uint64_t transform_discs(uint64_t discs, int symmetry)
+{
+	uint64_t t;
+	if (symmetry & SYMMETRY_TRANSPOSE) // Swaps 4x4 blocks, then 2x2 blocks, then squares across the diagonal
+	{
+		t = 0x0f0f0f0f00000000ULL & (discs ^ (discs << 28));
+		discs ^= t ^ (t >> 28);
+		t = 0x3333000033330000ULL & (discs ^ (discs << 14));
+		discs ^= t ^ (t >> 14);
+		t = 0x5500550055005500ULL & (discs ^ (discs << 7));
+		discs ^= t ^ (t >> 7);
+	}
+	if (symmetry & SYMMETRY_FLIP)
+	{
+		discs = __builtin_bswap64(discs);
+	}
+	if (symmetry & SYMMETRY_MIRROR) // Reverses the bits of every byte
+	{
+		discs = ((discs >> 1) & 0x5555555555555555ULL) | ((discs & 0x5555555555555555ULL) << 1);
+		discs = ((discs >> 2) & 0x3333333333333333ULL) | ((discs & 0x3333333333333333ULL) << 2);
+		discs = ((discs >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((discs & 0x0f0f0f0f0f0f0f0fULL) << 4);
+	}
+	return discs;
+}
+/**
+ * @brief Maps a square onto itself by one of the board symmetries, as transform_discs does.
+ *
+ * @param move The square.
+ * @param symmetry The symmetry.
+ * @return The transformed square.
+ */
+int transform_move(int move, int symmetry)
+{
+	int row = move / 8;
+	int col = move % 8;
+	if (symmetry & SYMMETRY_TRANSPOSE)
+	{
+		int swap = row;
+		row = col;
+		col = swap;
+	}
+	if (symmetry & SYMMETRY_FLIP)
+	{
+		row = 7 - row;
+	}
+	if (symmetry & SYMMETRY_MIRROR)
+	{
+		col = 7 - col;
+	}
+	return 8 * row + col;
+}
+/**
+ * @brief Finds the symmetry that undoes another. Reflections undo themselves; after a transpose the row and
+ * 		  column reversals trade places.
+ *
+ * @param symmetry The symmetry.
+ * @return The inverse symmetry.
+ */
+int inverse_symmetry(int symmetry)
+{
+	if (symmetry & SYMMETRY_TRANSPOSE)
+	{
+		return SYMMETRY_TRANSPOSE | ((symmetry & SYMMETRY_MIRROR) ? SYMMETRY_FLIP : 0) |
+			   ((symmetry & SYMMETRY_FLIP) ? SYMMETRY_MIRROR : 0);
+	}
+	return symmetry;
+}
+/**
+ * @brief Maps a position onto itself by one of the board symmetries. The side to move and the pass flag are
+ * 		  kept and the hash is recomputed.
+ *
+ * @param pos The position.
+ * @param symmetry The symmetry.
+ * @param out The transformed position.
+ */
+void transform_position(const Position *pos, int symmetry, Position *out)
+{
+	*out = *pos;
+	out->discs[0] = transform_discs(pos->discs[0], symmetry);
+	out->discs[1] = transform_discs(pos->discs[1], symmetry);
+	out->hash = hash_position(out);
+}
+/**
+ * @brief Finds the representative of a position among its eight orientations: the one with the smallest
+ * 		  black bitboard, then the smallest white bitboard. Positions that are rotations or reflections of
+ * 		  each other have the same representative. A move m of the representative is the move
+ * 		  transform_move(m, inverse_symmetry(s)) of the position, where s is the symmetry returned.
+ *
+ * @param pos The position.
+ * @param canonical The representative, with its hash.
+ * @return The symmetry that maps pos onto canonical.
+ */
+int canonical_position(const Position *pos, Position *canonical)
+{
+	uint64_t best_black = pos->discs[BLACK - 1];
+	uint64_t best_white = pos->discs[WHITE - 1];
+	int best = 0;
+
+	for (int symmetry = 1; symmetry < SYMMETRIES; symmetry++)
+	{
+		uint64_t black = transform_discs(pos->discs[BLACK - 1], symmetry);
+		if (black > best_black)
+		{
+			continue;
+		}
+		uint64_t white = transform_discs(pos->discs[WHITE - 1], symmetry);
+		if (black < best_black || white < best_white)
+		{
+			best_black = black;
+			best_white = white;
+			best = symmetry;
+		}
+	}
+	transform_position(pos, best, canonical);
+	return best;
+}
+/**
+ * @brief Computes a hash that is the same for all eight orientations of a position: the Zobrist key of its
+ * 		  canonical representative. Use it to key caches of whole positions, such as books; the search keys
+ * 		  its tables on the plain hash, which is updated incrementally.
+ *
+ * @param pos The position.
+ * @return The hash key.
+ */
+uint64_t canonical_hash(const Position *pos)
+{
+	Position canonical;
+	canonical_position(pos, &canonical);
+	return canonical.hash;
+}
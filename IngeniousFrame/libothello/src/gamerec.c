@@ -0,0 +1,300 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Compact binary game records. Games are appended to <prefix>.ogr, and
+ *    the offset of every record is appended to <prefix>.ogi so that a
+ *    reader can jump straight to any game. Both files are only ever
+ *    appended to, so several runs can add to the same collection.
+ *
+ *H***********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "board.h"
+#include "gamerec.h"
+
+#define GAMEREC_HEADERSIZE 4
+
+FILE *open_with_suffix(const char *prefix, const char *suffix, const char *mode);
+void put_offset(FILE *index, uint64_t offset);
+int get_offset(FILE *index, uint64_t *offset);
+
+/**
+ * @brief Opens (or creates) the record file and index of a collection for appending.
+ *
+ * @param writer The writer to set up.
+ * @param prefix The path of the collection without the suffixes.
+ * @return SUCCESS, or FAILURE if the files could not be opened or are not game records.
+ */
+int gamerec_open_writer(GameWriter *writer, const char *prefix)
+{
+	char magic[GAMEREC_HEADERSIZE];
+
+	writer->data = open_with_suffix(prefix, GAMEREC_DATA, "ab+");
+	writer->index = open_with_suffix(prefix, GAMEREC_INDEX, "ab");
+	if (writer->data == NULL || writer->index == NULL)
+	{
+		gamerec_close_writer(writer);
+		return FAILURE;
+	}
+
+	fseek(writer->data, 0, SEEK_END);
+	if (ftell(writer->data) == 0) // A new file starts with the magic number
+	{
+		fwrite(GAMEREC_MAGIC, 1, GAMEREC_HEADERSIZE, writer->data);
+	}
+	else
+	{
+		rewind(writer->data);
+		if (fread(magic, 1, GAMEREC_HEADERSIZE, writer->data) != GAMEREC_HEADERSIZE ||
+			memcmp(magic, GAMEREC_MAGIC, GAMEREC_HEADERSIZE) != 0)
+		{
+			gamerec_close_writer(writer);
+			return FAILURE;
+		}
+	}
+	fseek(writer->index, 0, SEEK_END);
+	writer->games = ftell(writer->index) / sizeof(uint64_t);
+	return SUCCESS;
+}
+/**
+ * @brief Appends a game to the record file and its offset to the index.
+ *
+ * @param writer The writer.
+ * @param game The game to store.
+ * @return SUCCESS, or FAILURE on a write error.
+ */
+int gamerec_append(GameWriter *writer, const GameRecord *game)
+{
+	uint8_t buffer[GAMEREC_HEADERSIZE + 3 * GAMEREC_MAXPLIES];
+	int n = game->num_plies;
+	int size = GAMEREC_HEADERSIZE + 3 * n;
+
+	if (n > GAMEREC_MAXPLIES)
+	{
+		return FAILURE;
+	}
+	buffer[0] = game->num_plies;
+	buffer[1] = game->opening_plies;
+	buffer[2] = (uint8_t)game->result;
+	buffer[3] = 0;
+	memcpy(buffer + GAMEREC_HEADERSIZE, game->moves, n);
+	for (int i = 0; i < n; i++)
+	{
+		uint16_t score = (uint16_t)game->scores[i];
+		buffer[GAMEREC_HEADERSIZE + n + 2 * i] = score & 0xff;
+		buffer[GAMEREC_HEADERSIZE + n + 2 * i + 1] = score >> 8;
+	}
+
+	fseek(writer->data, 0, SEEK_END); // "a" mode appends anyway, this only gives the offset
+	uint64_t offset = ftell(writer->data);
+	if (fwrite(buffer, 1, size, writer->data) != (size_t)size)
+	{
+		return FAILURE;
+	}
+	put_offset(writer->index, offset);
+	writer->games++;
+	return SUCCESS;
+}
+/**
+ * @brief Flushes and closes the files of a writer.
+ *
+ * @param writer The writer.
+ */
+void gamerec_close_writer(GameWriter *writer)
+{
+	if (writer->data != NULL)
+	{
+		fclose(writer->data);
+	}
+	if (writer->index != NULL)
+	{
+		fclose(writer->index);
+	}
+	writer->data = NULL;
+	writer->index = NULL;
+}
+/**
+ * @brief Opens a collection for reading, positioned at the first game.
+ *
+ * @param reader The reader to set up.
+ * @param prefix The path of the collection without the suffixes.
+ * @return SUCCESS, or FAILURE if the record file is missing or is not a game record. A missing index only
+ * 		   disables gamerec_seek.
+ */
+int gamerec_open_reader(GameReader *reader, const char *prefix)
+{
+	char magic[GAMEREC_HEADERSIZE];
+
+	reader->data = open_with_suffix(prefix, GAMEREC_DATA, "rb");
+	reader->index = open_with_suffix(prefix, GAMEREC_INDEX, "rb");
+	reader->games = 0;
+	if (reader->data == NULL || fread(magic, 1, GAMEREC_HEADERSIZE, reader->data) != GAMEREC_HEADERSIZE ||
+		memcmp(magic, GAMEREC_MAGIC, GAMEREC_HEADERSIZE) != 0)
+	{
+		gamerec_close_reader(reader);
+		return FAILURE;
+	}
+	if (reader->index != NULL)
+	{
+		fseek(reader->index, 0, SEEK_END);
+		reader->games = ftell(reader->index) / sizeof(uint64_t);
+	}
+	return SUCCESS;
+}
+/**
+ * @brief Reads the next game.
+ *
+ * @param reader The reader.
+ * @param game The game read.
+ * @return SUCCESS, or FAILURE at the end of the file or on a truncated or corrupt record.
+ */
+int gamerec_read(GameReader *reader, GameRecord *game)
+{
+	uint8_t buffer[GAMEREC_HEADERSIZE + 3 * GAMEREC_MAXPLIES];
+	int n;
+
+	if (fread(buffer, 1, GAMEREC_HEADERSIZE, reader->data) != GAMEREC_HEADERSIZE)
+	{
+		return FAILURE;
+	}
+	n = buffer[0];
+	if (n > GAMEREC_MAXPLIES || buffer[1] > n ||
+		fread(buffer + GAMEREC_HEADERSIZE, 1, 3 * n, reader->data) != (size_t)(3 * n))
+	{
+		return FAILURE;
+	}
+	game->num_plies = n;
+	game->opening_plies = buffer[1];
+	game->result = (int8_t)buffer[2];
+	memcpy(game->moves, buffer + GAMEREC_HEADERSIZE, n);
+	for (int i = 0; i < n; i++)
+	{
+		game->scores[i] = (int16_t)(buffer[GAMEREC_HEADERSIZE + n + 2 * i] |
+									buffer[GAMEREC_HEADERSIZE + n + 2 * i + 1] << 8);
+	}
+	return SUCCESS;
+}
+/**
+ * @brief Positions the reader at a game, so that the next gamerec_read returns it.
+ *
+ * @param reader The reader.
+ * @param game_number The game, counted from 0.
+ * @return SUCCESS, or FAILURE if there is no index or no such game.
+ */
+int gamerec_seek(GameReader *reader, long long game_number)
+{
+	uint64_t offset;
+
+	if (reader->index == NULL || game_number < 0 || game_number >= reader->games)
+	{
+		return FAILURE;
+	}
+	fseek(reader->index, game_number * sizeof(uint64_t), SEEK_SET);
+	if (get_offset(reader->index, &offset) == FAILURE)
+	{
+		return FAILURE;
+	}
+	return fseek(reader->data, offset, SEEK_SET) == 0 ? SUCCESS : FAILURE;
+}
+/**
+ * @brief Closes the files of a reader.
+ *
+ * @param reader The reader.
+ */
+void gamerec_close_reader(GameReader *reader)
+{
+	if (reader->data != NULL)
+	{
+		fclose(reader->data);
+	}
+	if (reader->index != NULL)
+	{
+		fclose(reader->index);
+	}
+	reader->data = NULL;
+	reader->index = NULL;
+}
+/**
+ * @brief Replays the first moves of a game.
+ *
+ * @param game The game.
+ * @param ply The number of moves to play, at most game->num_plies.
+ * @param pos The position before move number ply.
+ * @return SUCCESS, or FAILURE if the record holds an illegal move or pass.
+ */
+int gamerec_replay(const GameRecord *game, int ply, Position *pos)
+{
+	int moves[LEGALMOVSBUFSIZE];
+
+	initialise_position(pos);
+	for (int i = 0; i < ply && i < game->num_plies; i++)
+	{
+		if (game->moves[i] == GAMEREC_PASS)
+		{
+			if (legal_moves(pos, moves) != 0)
+			{
+				return FAILURE;
+			}
+			make_pass(pos);
+		}
+		else
+		{
+			if (!legalp(pos, game->moves[i]))
+			{
+				return FAILURE;
+			}
+			make_move(pos, game->moves[i]);
+		}
+	}
+	return SUCCESS;
+}
+/**
+ * @brief Opens prefix + suffix.
+ *
+ * @return The file, or NULL if it could not be opened or the path is too long.
+ */
+FILE *open_with_suffix(const char *prefix, const char *suffix, const char *mode)
+{
+	char path[GAMEREC_PATHBUFSIZE];
+
+	if (snprintf(path, GAMEREC_PATHBUFSIZE, "%s%s", prefix, suffix) >= GAMEREC_PATHBUFSIZE)
+	{
+		return NULL;
+	}
+	return fopen(path, mode);
+}
+/**
+ * @brief Appends a record offset to an index as 8 little-endian bytes.
+ */
+void put_offset(FILE *index, uint64_t offset)
+{
+	uint8_t bytes[sizeof(uint64_t)];
+
+	for (int i = 0; i < (int)sizeof(uint64_t); i++)
+	{
+		bytes[i] = offset >> (8 * i) & 0xff;
+	}
+	fwrite(bytes, 1, sizeof(uint64_t), index);
+}
+/**
+ * @brief Reads a record offset written by put_offset.
+ *
+ * @return SUCCESS, or FAILURE at the end of the index.
+ */
+int get_offset(FILE *index, uint64_t *offset)
+{
+	uint8_t bytes[sizeof(uint64_t)];
+
+	if (fread(bytes, 1, sizeof(uint64_t), index) != sizeof(uint64_t))
+	{
+		return FAILURE;
+	}
+	*offset = 0;
+	for (int i = 0; i < (int)sizeof(uint64_t); i++)
+	{
+		*offset |= (uint64_t)bytes[i] << (8 * i);
+	}
+	return SUCCESS;
+}
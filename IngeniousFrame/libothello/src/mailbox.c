@@ -0,0 +1,567 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Othello on a board of any even side, for the sizes other than the
+ *    8x8 of the bitboard (board.h). Squares are cells of a padded
+ *    mailbox, and moves are found by walking the eight directions from
+ *    each empty cell. This is slower than the bitboard, which stays
+ *    the path for 8x8.
+ *
+ *    The search is the same MiniMax as minimax(), without a table, and
+ *    the solver the same NegaScout as solve(), without the table or the
+ *    stability cut. Both count nodes and honour search_poll, node_limit
+ *    and search_aborted. The evaluation scales the 8x8 square weights to
+ *    the board by each square's place relative to the corners and edges,
+ *    and adds mobility.
+ *
+ *H***********************************************************************/
+
+#include <limits.h>
+#include "board.h"
+#include "eval.h"
+#include "mailbox.h"
+#include "search.h"
+
+int mailbox_cell(int size, int move);
+void mailbox_directions(int size, int *directions);
+const int8_t *mailbox_weights(int size);
+int mailbox_final_score(const MailboxPosition *pos, int player);
+int mailbox_disc_difference(const MailboxPosition *pos);
+void mailbox_order(const MailboxPosition *pos, int *moves, int amount_of_moves);
+
+int8_t mailbox_square_weights[MAILBOX_MAXSIZE + 1][MAILBOX_CELLS]; // per size, filled by mailbox_initialise
+
+/**
+ * @brief Sets up the starting position of a board: the four centre squares, white on the diagonal, black to
+ * 		  move, as initialise_position does for 8x8.
+ *
+ * @param pos The position to initialise.
+ * @param size The squares per side.
+ * @return SUCCESS, or FAILURE if the size is odd or out of range.
+ */
+int mailbox_initialise(MailboxPosition *pos, int size)
+{
+	int half = size / 2;
+
+	if (size % 2 != 0 || size < MAILBOX_MINSIZE || size > MAILBOX_MAXSIZE)
+	{
+		return FAILURE;
+	}
+	for (int i = 0; i < MAILBOX_CELLS; i++)
+	{
+		pos->cells[i] = MAILBOX_OUTSIDE;
+	}
+	for (int move = 0; move < size * size; move++)
+	{
+		pos->cells[mailbox_cell(size, move)] = EMPTY;
+	}
+	pos->cells[mailbox_cell(size, (half - 1) * size + half - 1)] = WHITE;
+	pos->cells[mailbox_cell(size, half * size + half)] = WHITE;
+	pos->cells[mailbox_cell(size, (half - 1) * size + half)] = BLACK;
+	pos->cells[mailbox_cell(size, half * size + half - 1)] = BLACK;
+	pos->size = size;
+	pos->to_move = BLACK;
+	pos->passed = 0;
+	pos->empties = size * size - 4;
+	mailbox_weights(size);
+	return SUCCESS;
+}
+/**
+ * @brief Finds the cell of a square.
+ *
+ * @param size The squares per side.
+ * @param move The square, row * size + column.
+ * @return The index into MailboxPosition.cells.
+ */
+int mailbox_cell(int size, int move)
+{
+	return (move / size + 1) * (size + 2) + move % size + 1;
+}
+/**
+ * @brief Fills in the cell offsets of the eight directions, which depend on the width of a row.
+ *
+ * @param size The squares per side.
+ * @param directions The eight offsets.
+ */
+void mailbox_directions(int size, int *directions)
+{
+	int width = size + 2;
+
+	directions[0] = -width - 1;
+	directions[1] = -width;
+	directions[2] = -width + 1;
+	directions[3] = -1;
+	directions[4] = 1;
+	directions[5] = width - 1;
+	directions[6] = width;
+	directions[7] = width + 1;
+}
+/**
+ * @brief Finds the moves of the player to move, in row order.
+ *
+ * @param pos The position.
+ * @param moves The output array of at least MAILBOX_MOVESBUFSIZE moves.
+ * @return The number of moves.
+ */
+int mailbox_legal_moves(const MailboxPosition *pos, int *moves)
+{
+	int amount_of_moves = 0;
+
+	for (int move = 0; move < pos->size * pos->size; move++)
+	{
+		if (mailbox_flips(pos, move) > 0)
+		{
+			moves[amount_of_moves++] = move;
+		}
+	}
+	return amount_of_moves;
+}
+/**
+ * @brief Counts the discs a move would flip for the player to move.
+ *
+ * @param pos The position.
+ * @param move The square.
+ * @return The number of flipped discs, 0 if the move is not legal.
+ */
+int mailbox_flips(const MailboxPosition *pos, int move)
+{
+	int directions[8];
+	int cell = mailbox_cell(pos->size, move);
+	int opp = opponent(pos->to_move);
+	int flips = 0;
+
+	if (pos->cells[cell] != EMPTY)
+	{
+		return 0;
+	}
+	mailbox_directions(pos->size, directions);
+	for (int i = 0; i < 8; i++)
+	{
+		int c = cell + directions[i];
+		int line = 0;
+		for (; pos->cells[c] == opp; c += directions[i])
+		{
+			line++;
+		}
+		if (pos->cells[c] == pos->to_move)
+		{
+			flips += line;
+		}
+	}
+	return flips;
+}
+/**
+ * @brief Plays a legal move for the player to move and hands the move to the opponent.
+ *
+ * @param pos The position.
+ * @param move The square.
+ */
+void mailbox_make_move(MailboxPosition *pos, int move)
+{
+	int directions[8];
+	int cell = mailbox_cell(pos->size, move);
+	int opp = opponent(pos->to_move);
+
+	mailbox_directions(pos->size, directions);
+	for (int i = 0; i < 8; i++)
+	{
+		int c = cell + directions[i];
+		for (; pos->cells[c] == opp; c += directions[i])
+			;
+		if (pos->cells[c] != pos->to_move)
+		{
+			continue;
+		}
+		for (c -= directions[i]; c != cell; c -= directions[i])
+		{
+			pos->cells[c] = pos->to_move;
+		}
+	}
+	pos->cells[cell] = pos->to_move;
+	pos->empties--;
+	pos->passed = 0;
+	pos->to_move = opp;
+}
+/**
+ * @brief Passes: the opponent is to move and nothing else changes.
+ *
+ * @param pos The position.
+ */
+void mailbox_make_pass(MailboxPosition *pos)
+{
+	pos->to_move = opponent(pos->to_move);
+	pos->passed = 1;
+}
+/**
+ * @brief Counts a player's discs.
+ *
+ * @param pos The position.
+ * @param player The player identifier.
+ * @return The number of discs.
+ */
+int mailbox_count(const MailboxPosition *pos, int player)
+{
+	int discs = 0;
+
+	for (int move = 0; move < pos->size * pos->size; move++)
+	{
+		discs += pos->cells[mailbox_cell(pos->size, move)] == player;
+	}
+	return discs;
+}
+/**
+ * @brief Returns the square weights of a board size, working them out the first time. Each square takes the
+ * 		  8x8 weight of the square as far from the nearest edges, counting anything three or more squares in
+ * 		  as three: corners, the squares next to them and the edges keep their weights on every size.
+ *
+ * @param size The squares per side.
+ * @return The weights, indexed by cell.
+ */
+const int8_t *mailbox_weights(int size)
+{
+	int8_t *weights = mailbox_square_weights[size];
+
+	if (weights[mailbox_cell(size, 0)] != 0) // The corners are never 0 once filled in
+	{
+		return weights;
+	}
+	for (int move = 0; move < size * size; move++)
+	{
+		int row = min(min(move / size, size - 1 - move / size), 3); // from the nearest edge, at most 3
+		int col = min(min(move % size, size - 1 - move % size), 3);
+		weights[mailbox_cell(size, move)] = SQUARE_WEIGHTS[8 * row + col];
+	}
+	return weights;
+}
+/**
+ * @brief Scores a position for a player by its square weights and the difference in mobility.
+ *
+ * @param pos The position.
+ * @param player The player scored for.
+ * @return The score for the player.
+ */
+int mailbox_evaluate(const MailboxPosition *pos, int player)
+{
+	const int8_t *weights = mailbox_weights(pos->size);
+	int moves[MAILBOX_MOVESBUFSIZE];
+	MailboxPosition other = *pos;
+	int score = 0;
+
+	for (int move = 0; move < pos->size * pos->size; move++)
+	{
+		int cell = mailbox_cell(pos->size, move);
+		if (pos->cells[cell] == player)
+			score += weights[cell];
+		else if (pos->cells[cell] == opponent(player))
+			score -= weights[cell];
+	}
+	other.to_move = opponent(pos->to_move);
+	int mobility = mailbox_legal_moves(pos, moves) - mailbox_legal_moves(&other, moves);
+	return score + MAILBOX_MOBILITYWEIGHT * ((pos->to_move == player) ? mobility : -mobility);
+}
+/**
+ * @brief Scores a finished game as final_score does: the disc difference with the empty squares going to the
+ * 		  winner, and WINSCORE added for a win.
+ *
+ * @param pos The final position.
+ * @param player The player scored for.
+ * @return The score for the player.
+ */
+int mailbox_final_score(const MailboxPosition *pos, int player)
+{
+	int diff = mailbox_count(pos, player) - mailbox_count(pos, opponent(player));
+
+	if (diff > 0)
+	{
+		return WINSCORE + diff + pos->empties;
+	}
+	if (diff < 0)
+	{
+		return -WINSCORE + diff - pos->empties;
+	}
+	return 0;
+}
+/**
+ * @brief The minimax search of minimax() on a mailbox board: a player with no moves passes without using up
+ * 		  depth, and finished games are scored exactly. Moves are searched best square first.
+ *
+ * @param pos The position.
+ * @param player The player the score is maximised for.
+ * @param depth The remaining depth.
+ * @param alpha The best score the maximising player is sure of.
+ * @param beta The best score the minimising player is sure of.
+ * @return The score for the player; 0 and meaningless once search_aborted is set.
+ */
+int mailbox_minimax(const MailboxPosition *pos, int player, int depth, int alpha, int beta)
+{
+	nodes_searched++;
+	if (search_poll != NULL && nodes_searched >= next_poll) // Time to check for messages
+	{
+		next_poll = nodes_searched + poll_interval;
+		search_poll();
+	}
+	if (search_aborted || (node_limit && nodes_searched > node_limit))
+	{
+		search_aborted = 1;
+		return 0;
+	}
+	if (pos->empties == 0)
+	{
+		return mailbox_final_score(pos, player);
+	}
+	if (depth == 0)
+	{
+		return mailbox_evaluate(pos, player);
+	}
+
+	int moves[MAILBOX_MOVESBUFSIZE];
+	int amount_of_moves = mailbox_legal_moves(pos, moves);
+	if (amount_of_moves == 0)
+	{
+		if (pos->passed) // Neither player can move
+		{
+			return mailbox_final_score(pos, player);
+		}
+		MailboxPosition child = *pos;
+		mailbox_make_pass(&child);
+		return mailbox_minimax(&child, player, depth, alpha, beta);
+	}
+	mailbox_order(pos, moves, amount_of_moves);
+
+	int best = (pos->to_move == player) ? INT_MIN : INT_MAX;
+	for (int i = 0; i < amount_of_moves; i++)
+	{
+		MailboxPosition child = *pos;
+		mailbox_make_move(&child, moves[i]);
+		int score = mailbox_minimax(&child, player, depth - 1, alpha, beta);
+		if (search_aborted)
+		{
+			return 0;
+		}
+		if (pos->to_move == player) // Maximising Player
+		{
+			best = max(best, score);
+			alpha = max(alpha, score);
+		}
+		else // Minimising Player
+		{
+			best = min(best, score);
+			beta = min(beta, score);
+		}
+		if (beta <= alpha)
+		{
+			break;
+		}
+	}
+	return best;
+}
+/**
+ * @brief Solves a position exactly within a window, fail-soft, as solve() does on the bitboard.
+ *
+ * @param pos The position.
+ * @param alpha The lower end of the window.
+ * @param beta The upper end of the window.
+ * @return The final disc difference for the player to move, empties counted for the winner; 0 and meaningless
+ * 		   once search_aborted is set.
+ */
+int mailbox_solve(const MailboxPosition *pos, int alpha, int beta)
+{
+	nodes_searched++;
+	if (search_poll != NULL && nodes_searched >= next_poll) // Time to check for messages
+	{
+		next_poll = nodes_searched + poll_interval;
+		search_poll();
+	}
+	if (search_aborted || (node_limit && nodes_searched > node_limit))
+	{
+		search_aborted = 1;
+		return 0;
+	}
+	if (pos->empties == 0)
+	{
+		return mailbox_disc_difference(pos);
+	}
+
+	int moves[MAILBOX_MOVESBUFSIZE];
+	int amount_of_moves = mailbox_legal_moves(pos, moves);
+	if (amount_of_moves == 0)
+	{
+		if (pos->passed) // Neither player can move
+		{
+			return mailbox_disc_difference(pos);
+		}
+		MailboxPosition child = *pos;
+		mailbox_make_pass(&child);
+		return -mailbox_solve(&child, -beta, -alpha);
+	}
+	mailbox_order(pos, moves, amount_of_moves);
+
+	int best = INT_MIN + 1;
+	for (int i = 0; i < amount_of_moves; i++)
+	{
+		MailboxPosition child = *pos;
+		int score;
+		mailbox_make_move(&child, moves[i]);
+		if (i == 0)
+		{
+			score = -mailbox_solve(&child, -beta, -alpha);
+		}
+		else // Proves the move is no better with a null window first
+		{
+			score = -mailbox_solve(&child, -alpha - 1, -alpha);
+			if (score > alpha && score < beta && !search_aborted)
+			{
+				score = -mailbox_solve(&child, -beta, -score);
+			}
+		}
+		if (search_aborted)
+		{
+			return 0;
+		}
+		if (score > best)
+		{
+			best = score;
+			alpha = max(alpha, score);
+			if (alpha >= beta)
+			{
+				break;
+			}
+		}
+	}
+	return best;
+}
+/**
+ * @brief Scores a finished game for the player to move, as disc_difference does.
+ *
+ * @param pos The final position.
+ * @return The disc difference, empty squares going to the winner.
+ */
+int mailbox_disc_difference(const MailboxPosition *pos)
+{
+	int diff = mailbox_count(pos, pos->to_move) - mailbox_count(pos, opponent(pos->to_move));
+
+	if (diff > 0)
+	{
+		return diff + pos->empties;
+	}
+	if (diff < 0)
+	{
+		return diff - pos->empties;
+	}
+	return 0;
+}
+/**
+ * @brief Orders moves by the weight of their square, best first, keeping row order between equal weights.
+ *
+ * @param pos The position.
+ * @param moves The moves, reordered in place.
+ * @param amount_of_moves The number of moves.
+ */
+void mailbox_order(const MailboxPosition *pos, int *moves, int amount_of_moves)
+{
+	const int8_t *weights = mailbox_weights(pos->size);
+
+	for (int i = 1; i < amount_of_moves; i++) // Insertion sort
+	{
+		int move = moves[i];
+		int key = weights[mailbox_cell(pos->size, move)];
+		int j = i;
+		for (; j > 0 && weights[mailbox_cell(pos->size, moves[j - 1])] < key; j--)
+		{
+			moves[j] = moves[j - 1];
+		}
+		moves[j] = move;
+	}
+}
+/**
+ * @brief Serialises a position as position_to_string does: the squares in row order, a space and the side to
+ * 		  move. The size is the square root of the number of squares.
+ *
+ * @param pos The position.
+ * @param str The output string of at least MAILBOX_STRLEN characters.
+ */
+void mailbox_to_string(const MailboxPosition *pos, char *str)
+{
+	int squares = pos->size * pos->size;
+
+	for (int move = 0; move < squares; move++)
+	{
+		str[move] = nameof(pos->cells[mailbox_cell(pos->size, move)]);
+	}
+	str[squares] = ' ';
+	str[squares + 1] = nameof(pos->to_move);
+	str[squares + 2] = 0;
+}
+/**
+ * @brief Parses a position written by mailbox_to_string, or by position_to_string for 8x8.
+ *
+ * @param str The serialised position.
+ * @param pos The position to fill in.
+ * @return SUCCESS, or FAILURE if the string is malformed or its size not supported.
+ */
+int mailbox_from_string(const char *str, MailboxPosition *pos)
+{
+	int squares = 0;
+	int size = MAILBOX_MINSIZE;
+
+	while (str[squares] != 0 && str[squares] != ' ')
+	{
+		squares++;
+	}
+	while (size * size < squares)
+	{
+		size += 2;
+	}
+	if (size * size != squares || mailbox_initialise(pos, size) == FAILURE)
+	{
+		return FAILURE;
+	}
+	pos->empties = 0;
+	for (int move = 0; move < squares; move++)
+	{
+		int cell = mailbox_cell(size, move);
+		if (str[move] == nameof(BLACK))
+			pos->cells[cell] = BLACK;
+		else if (str[move] == nameof(WHITE))
+			pos->cells[cell] = WHITE;
+		else if (str[move] == nameof(EMPTY))
+		{
+			pos->cells[cell] = EMPTY;
+			pos->empties++;
+		}
+		else
+			return FAILURE;
+	}
+	if (str[squares] != ' ' || (str[squares + 1] != nameof(BLACK) && str[squares + 1] != nameof(WHITE)))
+	{
+		return FAILURE;
+	}
+	pos->to_move = (str[squares + 1] == nameof(BLACK)) ? BLACK : WHITE;
+	return SUCCESS;
+}
+/**
+ * @brief Prints a position as print_board does, with the disc counts.
+ *
+ * @param fp The file to print to.
+ * @param pos The position.
+ */
+void mailbox_print(FILE *fp, const MailboxPosition *pos)
+{
+	fprintf(fp, "   ");
+	for (int col = 0; col < pos->size; col++)
+	{
+		fprintf(fp, "%-2d", col + 1);
+	}
+	fprintf(fp, "[%c=%d %c=%d]\n", nameof(BLACK), mailbox_count(pos, BLACK), nameof(WHITE), mailbox_count(pos, WHITE));
+	for (int row = 0; row < pos->size; row++)
+	{
+		fprintf(fp, "%-3d", row + 1);
+		for (int col = 0; col < pos->size; col++)
+		{
+			fprintf(fp, "%c ", nameof(pos->cells[mailbox_cell(pos->size, row * pos->size + col)]));
+		}
+		fprintf(fp, "\n");
+	}
+	fflush(fp);
+}
@@ -0,0 +1,43 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    The match settings the scripts write for the referee (Othello.json),
+ *    which the players read too: the board size and the memory budget.
+ *    The file is a flat JSON object, so a setting is found by its quoted
+ *    name and read as the number after the colon.
+ *
+ *H***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "match.h"
+
+/**
+ * @brief Reads a whole-number setting from the match settings.
+ *
+ * @param path The settings file.
+ * @param name The name of the member, without quotes.
+ * @param fallback The value when the file or the member is missing.
+ * @return The value of the member, or fallback.
+ */
+int match_setting(const char *path, const char *name, int fallback)
+{
+	char text[MATCHCONFIGBUFSIZE];
+	char key[MATCHNAMEBUFSIZE];
+	FILE *in = fopen(path, "r");
+	size_t length;
+
+	if (in == NULL)
+	{
+		return fallback;
+	}
+	length = fread(text, 1, MATCHCONFIGBUFSIZE - 1, in);
+	fclose(in);
+	text[length] = 0;
+	snprintf(key, MATCHNAMEBUFSIZE, "\"%s\"", name);
+	char *member = strstr(text, key);
+	char *colon = (member != NULL) ? strchr(member, ':') : NULL;
+	return (colon != NULL) ? atoi(colon + 1) : fallback;
+}
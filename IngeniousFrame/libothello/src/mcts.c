@@ -0,0 +1,459 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Monte Carlo Tree Search over positions: UCT or PUCT selection, random
+ *    playouts on the bitboards, a preallocated node pool and tree reuse
+ *    between moves.
+ *
+ *H***********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "board.h"
+#include "eval.h"
+#include "mcts.h"
+
+void mcts_reset(MCTSTree *tree, const Position *pos);
+int mcts_reroot(MCTSTree *tree, int new_root);
+int mcts_expand(MCTSTree *tree, int index, const Position *pos);
+int mcts_select(const MCTSTree *tree, int parent);
+void play_node_move(Position *pos, int move);
+
+/**
+ * @brief Sets up a tree on memory the caller provides, holding both node pools, and sets it to the starting
+ * 		  position.
+ *
+ * @param tree The tree to create.
+ * @param memory At least mcts_pool_bytes(capacity) bytes, or NULL if they could not be had.
+ * @param capacity The number of nodes in each pool.
+ * @param exploration The exploration constant of the selection rule.
+ * @param use_puct 1 for PUCT selection, 0 for UCT.
+ * @param seed The seed of the playout random number generator.
+ * @return SUCCESS, or FAILURE if there is no memory.
+ */
+int mcts_create(MCTSTree *tree, void *memory, int capacity, double exploration, int use_puct, uint64_t seed)
+{
+	Position start;
+
+	tree->nodes = (MCTSNode *)memory;
+	tree->spare = (memory == NULL) ? NULL : tree->nodes + capacity;
+	if (memory == NULL)
+	{
+		return FAILURE;
+	}
+	tree->capacity = capacity;
+	tree->exploration = exploration;
+	tree->use_puct = use_puct;
+	tree->rng = seed;
+	initialise_position(&start);
+	mcts_reset(tree, &start);
+	return SUCCESS;
+}
+/**
+ * @brief The memory the node pools of a tree take.
+ *
+ * @param capacity The number of nodes in each pool.
+ * @return The bytes to give mcts_create.
+ */
+size_t mcts_pool_bytes(int capacity)
+{
+	return 2 * (size_t)capacity * sizeof(MCTSNode);
+}
+/**
+ * @brief Empties a tree and puts a new position at its root.
+ *
+ * @param tree The tree.
+ * @param pos The new root position.
+ */
+void mcts_reset(MCTSTree *tree, const Position *pos)
+{
+	MCTSNode *root = &tree->nodes[0];
+
+	root->first_child = MCTS_UNEXPANDED;
+	root->visits = 0;
+	root->wins = 0;
+	root->prior = 1;
+	root->move = MCTS_PASS;
+	root->num_children = 0;
+	root->player = opponent(pos->to_move);
+	tree->used = 1;
+	tree->root_position = *pos;
+	tree->playouts = 0;
+}
+/**
+ * @brief Moves the root of a tree to a new position. If the position is a child or grandchild of the
+ * 		  current root, i.e. our last move and the opponent's reply, its subtree is kept; otherwise the tree
+ * 		  starts again from scratch.
+ *
+ * @param tree The tree.
+ * @param pos The new root position.
+ */
+void mcts_set_root(MCTSTree *tree, const Position *pos)
+{
+	MCTSNode *nodes = tree->nodes;
+	MCTSNode *root = &nodes[0];
+
+	if (root->first_child >= 0)
+	{
+		for (int i = root->first_child; i < root->first_child + root->num_children; i++)
+		{
+			Position child = tree->root_position;
+			play_node_move(&child, nodes[i].move);
+			if (child.hash == pos->hash && child.discs[0] == pos->discs[0] && child.discs[1] == pos->discs[1])
+			{
+				tree->root_position = *pos;
+				mcts_reroot(tree, i);
+				return;
+			}
+			if (nodes[i].first_child < 0)
+			{
+				continue;
+			}
+			for (int j = nodes[i].first_child; j < nodes[i].first_child + nodes[i].num_children; j++)
+			{
+				Position grandchild = child;
+				play_node_move(&grandchild, nodes[j].move);
+				if (grandchild.hash == pos->hash && grandchild.discs[0] == pos->discs[0] &&
+					grandchild.discs[1] == pos->discs[1])
+				{
+					tree->root_position = *pos;
+					mcts_reroot(tree, j);
+					return;
+				}
+			}
+		}
+	}
+	mcts_reset(tree, pos);
+}
+/**
+ * @brief Copies the subtree below a node into the spare pool, breadth first, and makes it the tree. The
+ * 		  copied nodes double as the queue: each one's block of children is appended when it is reached.
+ *
+ * @param tree The tree.
+ * @param new_root The pool index of the node that becomes the root.
+ * @return The number of nodes kept.
+ */
+int mcts_reroot(MCTSTree *tree, int new_root)
+{
+	MCTSNode *src = tree->nodes;
+	MCTSNode *dst = tree->spare;
+	int used = 1;
+
+	dst[0] = src[new_root];
+	for (int i = 0; i < used; i++)
+	{
+		MCTSNode *node = &dst[i];
+		if (node->first_child < 0)
+		{
+			continue;
+		}
+		memcpy(&dst[used], &src[node->first_child], node->num_children * sizeof(MCTSNode));
+		node->first_child = used;
+		used += node->num_children;
+	}
+
+	tree->spare = src;
+	tree->nodes = dst;
+	tree->used = used;
+	tree->playouts = 0;
+	return used;
+}
+/**
+ * @brief Generates the children of a leaf as one block from the pool. A player without moves gets a single
+ * 		  pass child; a leaf where neither player can move is marked terminal. Priors are a softmax over the
+ * 		  square weights of the moves.
+ *
+ * @param tree The tree.
+ * @param index The pool index of the leaf.
+ * @param pos The position at the leaf.
+ * @return The number of children, 0 if the leaf is terminal or the pool is full.
+ */
+int mcts_expand(MCTSTree *tree, int index, const Position *pos)
+{
+	MCTSNode *leaf = &tree->nodes[index];
+	int moves[LEGALMOVSBUFSIZE];
+	int n = legal_moves(pos, moves);
+
+	if (n == 0)
+	{
+		if (pos->passed || pos->empties == 0)
+		{
+			leaf->first_child = MCTS_TERMINAL;
+			return 0;
+		}
+		moves[0] = MCTS_PASS;
+		n = 1;
+	}
+	if (tree->used + n > tree->capacity)
+	{
+		return 0; // Pool is full: the leaf keeps being sampled by playouts
+	}
+
+	MCTSNode *children = &tree->nodes[tree->used];
+	double total = 0;
+	for (int i = 0; i < n; i++)
+	{
+		children[i].first_child = MCTS_UNEXPANDED;
+		children[i].visits = 0;
+		children[i].wins = 0;
+		children[i].move = moves[i];
+		children[i].num_children = 0;
+		children[i].player = pos->to_move;
+		children[i].prior = (moves[i] == MCTS_PASS) ? 1 : exp(SQUARE_WEIGHTS[moves[i]] / 2.0);
+		total += children[i].prior;
+	}
+	for (int i = 0; i < n; i++)
+	{
+		children[i].prior /= total;
+	}
+	leaf->first_child = tree->used;
+	leaf->num_children = n;
+	tree->used += n;
+	return n;
+}
+/**
+ * @brief Picks the child to descend into. Unvisited children are tried first under UCT; PUCT scores them
+ * 		  with a neutral value of one half and lets the prior decide.
+ *
+ * @param tree The tree.
+ * @param parent The pool index of an expanded node.
+ * @return The pool index of the selected child.
+ */
+int mcts_select(const MCTSTree *tree, int parent)
+{
+	const MCTSNode *nodes = tree->nodes;
+	int first = nodes[parent].first_child;
+	int best = first;
+	double best_value = -1;
+	double log_visits = log(nodes[parent].visits + 1);
+	double sqrt_visits = sqrt(nodes[parent].visits + 1);
+
+	for (int i = first; i < first + nodes[parent].num_children; i++)
+	{
+		double value;
+		if (tree->use_puct)
+		{
+			double q = nodes[i].visits ? nodes[i].wins / nodes[i].visits : 0.5;
+			value = q + tree->exploration * nodes[i].prior * sqrt_visits / (1 + nodes[i].visits);
+		}
+		else
+		{
+			if (nodes[i].visits == 0)
+			{
+				return i;
+			}
+			value = nodes[i].wins / nodes[i].visits + tree->exploration * sqrt(log_visits / nodes[i].visits);
+		}
+		if (value > best_value)
+		{
+			best_value = value;
+			best = i;
+		}
+	}
+	return best;
+}
+/**
+ * @brief Runs one iteration: selects a path to a leaf, expands it if it has been visited before, plays the
+ * 		  game out at random and adds the result to every node on the path.
+ *
+ * @param tree The tree.
+ */
+void mcts_iterate(MCTSTree *tree)
+{
+	int path[MCTS_MAXPATH];
+	int length = 0;
+	int index = 0;
+	Position pos = tree->root_position;
+
+	path[length++] = index;
+	while (tree->nodes[index].first_child >= 0)
+	{
+		index = mcts_select(tree, index);
+		play_node_move(&pos, tree->nodes[index].move);
+		path[length++] = index;
+	}
+	if (tree->nodes[index].first_child == MCTS_UNEXPANDED && tree->nodes[index].visits > 0 &&
+		mcts_expand(tree, index, &pos) > 0)
+	{
+		index = mcts_select(tree, index);
+		play_node_move(&pos, tree->nodes[index].move);
+		path[length++] = index;
+	}
+
+	int winner = playout(pos, &tree->rng);
+	for (int i = 0; i < length; i++)
+	{
+		MCTSNode *node = &tree->nodes[path[i]];
+		node->visits++;
+		if (winner == node->player)
+			node->wins += 1;
+		else if (winner == EMPTY)
+			node->wins += 0.5f;
+	}
+	tree->playouts++;
+}
+/**
+ * @brief The most visited move at the root.
+ *
+ * @param tree The tree.
+ * @return The best square, or -1 to pass.
+ */
+int mcts_best_move(const MCTSTree *tree)
+{
+	const MCTSNode *nodes = tree->nodes;
+	int best = -1;
+	uint32_t best_visits = 0;
+
+	if (nodes[0].first_child < 0)
+	{
+		int moves[LEGALMOVSBUFSIZE];
+		return legal_moves(&tree->root_position, moves) ? moves[0] : -1;
+	}
+	for (int i = nodes[0].first_child; i < nodes[0].first_child + nodes[0].num_children; i++)
+	{
+		if (best == -1 || nodes[i].visits > best_visits)
+		{
+			best = i;
+			best_visits = nodes[i].visits;
+		}
+	}
+	return nodes[best].move == MCTS_PASS ? -1 : nodes[best].move;
+}
+/**
+ * @brief The number of statistics slots for the top levels of a tree: MCTS_SLOTS for the root's children,
+ * 		  and MCTS_SLOTS per root child for the grandchildren. Slots are addressed by move, so they mean the
+ * 		  same on every rank whatever order the nodes were expanded in.
+ *
+ * @param levels 1 for the root's children, 2 to include the grandchildren.
+ * @return The number of slots.
+ */
+int mcts_statistics_size(int levels)
+{
+	return (levels >= 2) ? MCTS_SLOTS + MCTS_SLOTS * MCTS_SLOTS : MCTS_SLOTS;
+}
+/**
+ * @brief Copies the visits and wins of the top levels of a tree into slot arrays; missing nodes read as 0.
+ *
+ * @param tree The tree.
+ * @param levels 1 or 2, see mcts_statistics_size.
+ * @param visits The output visit counts.
+ * @param wins The output win counts.
+ */
+void mcts_gather(const MCTSTree *tree, int levels, double *visits, double *wins)
+{
+	const MCTSNode *nodes = tree->nodes;
+	int size = mcts_statistics_size(levels);
+
+	memset(visits, 0, size * sizeof(double));
+	memset(wins, 0, size * sizeof(double));
+	if (nodes[0].first_child < 0)
+	{
+		return;
+	}
+	for (int i = nodes[0].first_child; i < nodes[0].first_child + nodes[0].num_children; i++)
+	{
+		visits[nodes[i].move] = nodes[i].visits;
+		wins[nodes[i].move] = nodes[i].wins;
+		if (levels < 2 || nodes[i].first_child < 0)
+		{
+			continue;
+		}
+		for (int j = nodes[i].first_child; j < nodes[i].first_child + nodes[i].num_children; j++)
+		{
+			int slot = MCTS_SLOTS + MCTS_SLOTS * nodes[i].move + nodes[j].move;
+			visits[slot] = nodes[j].visits;
+			wins[slot] = nodes[j].wins;
+		}
+	}
+}
+/**
+ * @brief Adds visits and wins gathered elsewhere to the top levels of a tree. Slots without a node in this
+ * 		  tree are dropped. The visits added to the root's children are added to the root as well, so the
+ * 		  selection rule sees a consistent parent count.
+ *
+ * @param tree The tree.
+ * @param levels 1 or 2, see mcts_statistics_size.
+ * @param visits The visit counts to add.
+ * @param wins The win counts to add.
+ */
+void mcts_add(MCTSTree *tree, int levels, const double *visits, const double *wins)
+{
+	MCTSNode *nodes = tree->nodes;
+
+	if (nodes[0].first_child < 0)
+	{
+		return;
+	}
+	for (int i = nodes[0].first_child; i < nodes[0].first_child + nodes[0].num_children; i++)
+	{
+		nodes[i].visits += (uint32_t)visits[nodes[i].move];
+		nodes[i].wins += (float)wins[nodes[i].move];
+		nodes[0].visits += (uint32_t)visits[nodes[i].move];
+		if (levels < 2 || nodes[i].first_child < 0)
+		{
+			continue;
+		}
+		for (int j = nodes[i].first_child; j < nodes[i].first_child + nodes[i].num_children; j++)
+		{
+			int slot = MCTS_SLOTS + MCTS_SLOTS * nodes[i].move + nodes[j].move;
+			nodes[j].visits += (uint32_t)visits[slot];
+			nodes[j].wins += (float)wins[slot];
+		}
+	}
+}
+/**
+ * @brief Plays the move stored in a node, which may be a pass.
+ *
+ * @param pos The position.
+ * @param move The square, or MCTS_PASS.
+ */
+void play_node_move(Position *pos, int move)
+{
+	if (move == MCTS_PASS)
+		make_pass(pos);
+	else
+		make_move(pos, move);
+}
+/**
+ * @brief Plays uniformly random moves until the game is over. Moves are drawn straight from the mobility
+ * 		  bitboard without building a move list.
+ *
+ * @param pos The position to play out (a copy).
+ * @param rng The random number generator state.
+ * @return The winner, or EMPTY for a draw.
+ */
+int playout(Position pos, uint64_t *rng)
+{
+	int passes = pos.passed;
+
+	while (pos.empties > 0)
+	{
+		uint64_t moves = mobility(pos.discs[pos.to_move - 1], pos.discs[opponent(pos.to_move) - 1]);
+		if (moves == 0)
+		{
+			if (passes)
+			{
+				break; // Neither player can move
+			}
+			make_pass(&pos);
+			passes = 1;
+			continue;
+		}
+		for (int k = rng_next(rng) % __builtin_popcountll(moves); k > 0; k--)
+		{
+			moves &= moves - 1; // Drops the lowest moves until the chosen one is lowest
+		}
+		make_move(&pos, __builtin_ctzll(moves));
+		passes = 0;
+	}
+
+	int black = count(&pos, BLACK);
+	int white = count(&pos, WHITE);
+	if (black > white)
+		return BLACK;
+	if (white > black)
+		return WHITE;
+	return EMPTY;
+}
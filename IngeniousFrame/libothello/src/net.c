@@ -0,0 +1,447 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Quantised network evaluation. The first layer is an accumulator
+ *    (NetAccumulator) that a search keeps per position and updates by the
+ *    discs a move places and flips, in both players' views. The layers
+ *    after it run on 8-bit activations: with AVX2 where the processor has
+ *    it, picked at the first evaluation, and otherwise in plain C that
+ *    gives exactly the same scores.
+ *
+ *    Networks are trained in floating point by tools/src/nettrain.c on
+ *    self-play games and written here with net_save.
+ *
+ *H***********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "board.h"
+#include "eval.h"
+#include "net.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define NET_AVX2 1
+#endif
+
+#define NET_MAGICSIZE 4
+
+int net_layers_first(const Network *net, const int16_t *acc, int bucket);
+int net_layers_generic(const Network *net, const int16_t *acc, int bucket);
+int net_layers_avx2(const Network *net, const int16_t *acc, int bucket);
+void net_choose_kernel(void);
+int net_score(int output);
+void net_add_rows(const Network *net, NetAccumulator *acc, int colour, uint64_t discs, int sign);
+int put_values(FILE *file, const void *values, int count, int size);
+int get_values(FILE *file, void *values, int count, int size);
+
+int (*net_layers)(const Network *net, const int16_t *acc, int bucket) = net_layers_first; // chosen at the first evaluation
+
+/**
+ * @brief Reads a network written by net_save.
+ *
+ * @param net The network to fill in.
+ * @param path The file.
+ * @return SUCCESS, or FAILURE if the file is missing, is not a network or is too short.
+ */
+int net_load(Network *net, const char *path)
+{
+	char magic[NET_MAGICSIZE];
+	FILE *file = fopen(path, "rb");
+	int ok;
+
+	if (file == NULL)
+	{
+		return FAILURE;
+	}
+	ok = fread(magic, 1, NET_MAGICSIZE, file) == NET_MAGICSIZE && memcmp(magic, NET_MAGIC, NET_MAGICSIZE) == 0 &&
+		 get_values(file, net->weights1, NET_INPUTS * NET_HIDDEN1, sizeof(int16_t)) &&
+		 get_values(file, net->bias1, NET_HIDDEN1, sizeof(int16_t)) &&
+		 get_values(file, net->weights2, NET_BUCKETS * NET_HIDDEN2 * NET_HIDDEN1, sizeof(int8_t)) &&
+		 get_values(file, net->bias2, NET_BUCKETS * NET_HIDDEN2, sizeof(int32_t)) &&
+		 get_values(file, net->weights3, NET_BUCKETS * NET_HIDDEN2, sizeof(int16_t)) &&
+		 get_values(file, net->bias3, NET_BUCKETS, sizeof(int32_t));
+	fclose(file);
+	return ok ? SUCCESS : FAILURE;
+}
+/**
+ * @brief Writes a network for net_load.
+ *
+ * @param net The network.
+ * @param path The file, replaced if it exists.
+ * @return SUCCESS, or FAILURE on a write error.
+ */
+int net_save(const Network *net, const char *path)
+{
+	FILE *file = fopen(path, "wb");
+	int ok;
+
+	if (file == NULL)
+	{
+		return FAILURE;
+	}
+	ok = fwrite(NET_MAGIC, 1, NET_MAGICSIZE, file) == NET_MAGICSIZE &&
+		 put_values(file, net->weights1, NET_INPUTS * NET_HIDDEN1, sizeof(int16_t)) &&
+		 put_values(file, net->bias1, NET_HIDDEN1, sizeof(int16_t)) &&
+		 put_values(file, net->weights2, NET_BUCKETS * NET_HIDDEN2 * NET_HIDDEN1, sizeof(int8_t)) &&
+		 put_values(file, net->bias2, NET_BUCKETS * NET_HIDDEN2, sizeof(int32_t)) &&
+		 put_values(file, net->weights3, NET_BUCKETS * NET_HIDDEN2, sizeof(int16_t)) &&
+		 put_values(file, net->bias3, NET_BUCKETS, sizeof(int32_t));
+	return (fclose(file) == 0 && ok) ? SUCCESS : FAILURE;
+}
+/**
+ * @brief Computes the accumulator of a position from scratch, as a search does at its root.
+ *
+ * @param net The network.
+ * @param pos The position.
+ * @param acc The accumulator.
+ */
+void net_refresh(const Network *net, const Position *pos, NetAccumulator *acc)
+{
+	for (int c = 0; c < 2; c++)
+	{
+		memcpy(acc->values[c], net->bias1, sizeof(net->bias1));
+	}
+	for (int c = 0; c < 2; c++)
+	{
+		net_add_rows(net, acc, c, pos->discs[c], 1);
+	}
+}
+/**
+ * @brief Derives the accumulator of a position from that of another a move or pass away, by the discs that
+ * 		  appeared and disappeared: the square played, the flipped discs in both colours, nothing for a pass.
+ *
+ * @param net The network.
+ * @param from The accumulator of the position before.
+ * @param before The position before.
+ * @param after The position after.
+ * @param to The accumulator of the position after; may be from.
+ */
+void net_update(const Network *net, const NetAccumulator *from, const Position *before, const Position *after,
+				NetAccumulator *to)
+{
+	if (to != from)
+	{
+		*to = *from;
+	}
+	for (int c = 0; c < 2; c++)
+	{
+		net_add_rows(net, to, c, after->discs[c] & ~before->discs[c], 1);
+		net_add_rows(net, to, c, before->discs[c] & ~after->discs[c], -1);
+	}
+}
+/**
+ * @brief Scores a position from its accumulator.
+ *
+ * @param net The network.
+ * @param acc The accumulator of the position.
+ * @param pos The position, for its stage.
+ * @param player The player scored for.
+ * @return The predicted final disc difference for the player, in 1/NET_SCORESCALE discs.
+ */
+int net_evaluate(const Network *net, const NetAccumulator *acc, const Position *pos, int player)
+{
+	return net_score(net_layers(net, acc->values[player - 1], net_bucket(pos->empties)));
+}
+/**
+ * @brief Picks the second and output layers for a stage of the game.
+ *
+ * @param empties The empty squares.
+ * @return The bucket, 0 for the first NET_BUCKETMOVES moves.
+ */
+int net_bucket(int empties)
+{
+	int bucket = (PLAYABLESQUARES - 4 - empties) / NET_BUCKETMOVES;
+
+	return (bucket < 0) ? 0 : (bucket >= NET_BUCKETS) ? NET_BUCKETS - 1 : bucket;
+}
+/**
+ * @brief Plays every move and scores each child from the parent's accumulator, updating only the player's view.
+ * 		  Full boards are scored exactly, as by evaluate_children.
+ *
+ * @param net The network.
+ * @param acc The accumulator of the frontier node.
+ * @param pos The position of the frontier node.
+ * @param player The player the children are scored for.
+ * @param moves The moves to play.
+ * @param amount_of_moves The number of moves.
+ * @param scores The output array receiving the score of each child.
+ * @return The number of children scored.
+ */
+int net_evaluate_children(const Network *net, const NetAccumulator *acc, const Position *pos, int player, int *moves,
+						  int amount_of_moves, int *scores)
+{
+	int own = player - 1;
+	int16_t values[NET_HIDDEN1] __attribute__((aligned(32)));
+
+	for (int m = 0; m < amount_of_moves; m++)
+	{
+		Position child = *pos;
+		make_move(&child, moves[m]);
+		if (child.empties == 0) // Full boards are scored exactly
+		{
+			scores[m] = final_score(&child, player);
+			continue;
+		}
+		memcpy(values, acc->values[own], sizeof(values));
+		for (int c = 0; c < 2; c++)
+		{
+			int offset = (c == own) ? 0 : PLAYABLESQUARES; // The player's discs come first
+			uint64_t added = child.discs[c] & ~pos->discs[c];
+			uint64_t removed = pos->discs[c] & ~child.discs[c];
+			for (; added; added &= added - 1)
+			{
+				const int16_t *row = net->weights1[offset + __builtin_ctzll(added)];
+				for (int i = 0; i < NET_HIDDEN1; i++)
+				{
+					values[i] += row[i];
+				}
+			}
+			for (; removed; removed &= removed - 1)
+			{
+				const int16_t *row = net->weights1[offset + __builtin_ctzll(removed)];
+				for (int i = 0; i < NET_HIDDEN1; i++)
+				{
+					values[i] -= row[i];
+				}
+			}
+		}
+		scores[m] = net_score(net_layers(net, values, net_bucket(child.empties)));
+	}
+	return amount_of_moves;
+}
+/**
+ * @brief Names the kernel that runs the layers after the accumulator, picking it if no evaluation has yet.
+ *
+ * @return "avx2" or "generic".
+ */
+const char *net_kernel(void)
+{
+	if (net_layers == net_layers_first)
+	{
+		net_choose_kernel();
+	}
+	return (net_layers == net_layers_generic) ? "generic" : "avx2";
+}
+/**
+ * @brief Picks the kernel and runs it; net_layers points here until the first evaluation.
+ */
+int net_layers_first(const Network *net, const int16_t *acc, int bucket)
+{
+	net_choose_kernel();
+	return net_layers(net, acc, bucket);
+}
+/**
+ * @brief Points net_layers at the AVX2 kernel when this build and processor have it, at the plain C one otherwise.
+ */
+void net_choose_kernel(void)
+{
+	net_layers = net_layers_generic;
+#ifdef NET_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		net_layers = net_layers_avx2;
+	}
+#endif
+}
+/**
+ * @brief Runs the layers after the accumulator in plain C: clips the accumulator to 0..NET_ONE, then the second
+ * 		  layer, clipped the same way after dropping its weight scale, then the output.
+ *
+ * @param net The network.
+ * @param acc The accumulator values of the player scored for.
+ * @param bucket The set of second and output layers.
+ * @return The output, in 1/(NET_ONE * NET_WEIGHTSCALE) discs.
+ */
+int net_layers_generic(const Network *net, const int16_t *acc, int bucket)
+{
+	uint8_t hidden1[NET_HIDDEN1];
+	int32_t output = net->bias3[bucket];
+
+	for (int i = 0; i < NET_HIDDEN1; i++)
+	{
+		hidden1[i] = (acc[i] < 0) ? 0 : (acc[i] > NET_ONE) ? NET_ONE : acc[i];
+	}
+	for (int j = 0; j < NET_HIDDEN2; j++)
+	{
+		int32_t sum = net->bias2[bucket][j];
+		for (int i = 0; i < NET_HIDDEN1; i++)
+		{
+			sum += hidden1[i] * net->weights2[bucket][j][i];
+		}
+		sum >>= NET_WEIGHTSHIFT;
+		output += ((sum < 0) ? 0 : (sum > NET_ONE) ? NET_ONE : sum) * net->weights3[bucket][j];
+	}
+	return output;
+}
+#ifdef NET_AVX2
+/**
+ * @brief Runs the layers after the accumulator with AVX2, as net_layers_generic does. The 32 clipped
+ * 		  activations fill one register of bytes; each second-layer output is one multiply-add of bytes
+ * 		  (maddubs, which cannot saturate since both factors are at most 127) and one of 16-bit pairs, and
+ * 		  eight outputs are summed across their registers at a time.
+ *
+ * @param net The network.
+ * @param acc The accumulator values of the player scored for.
+ * @param bucket The set of second and output layers.
+ * @return The output, in 1/(NET_ONE * NET_WEIGHTSCALE) discs.
+ */
+__attribute__((target("avx2"))) int net_layers_avx2(const Network *net, const int16_t *acc, int bucket)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i one = _mm256_set1_epi32(NET_ONE);
+	__m256i pairs = _mm256_set1_epi16(1);
+	__m256i output = _mm256_setzero_si256();
+	__m256i sums[8];
+
+	__m256i low = _mm256_loadu_si256((const __m256i *)acc);
+	__m256i high = _mm256_loadu_si256((const __m256i *)(acc + 16));
+	__m256i hidden1 = _mm256_max_epi8(_mm256_packs_epi16(low, high), zero); // Saturates to 127, then clips at 0
+	hidden1 = _mm256_permute4x64_epi64(hidden1, 0xd8);						 // packs works within 128-bit lanes
+
+	for (int j = 0; j < NET_HIDDEN2; j += 8)
+	{
+		for (int k = 0; k < 8; k++)
+		{
+			__m256i weights = _mm256_loadu_si256((const __m256i *)net->weights2[bucket][j + k]);
+			sums[k] = _mm256_madd_epi16(_mm256_maddubs_epi16(hidden1, weights), pairs);
+		}
+		__m256i sum01 = _mm256_hadd_epi32(sums[0], sums[1]);
+		__m256i sum23 = _mm256_hadd_epi32(sums[2], sums[3]);
+		__m256i sum45 = _mm256_hadd_epi32(sums[4], sums[5]);
+		__m256i sum67 = _mm256_hadd_epi32(sums[6], sums[7]);
+		__m256i sum0123 = _mm256_hadd_epi32(sum01, sum23);
+		__m256i sum4567 = _mm256_hadd_epi32(sum45, sum67);
+		__m256i hidden2 = _mm256_add_epi32(_mm256_permute2x128_si256(sum0123, sum4567, 0x20),
+										   _mm256_permute2x128_si256(sum0123, sum4567, 0x31));
+		hidden2 = _mm256_add_epi32(hidden2, _mm256_loadu_si256((const __m256i *)&net->bias2[bucket][j]));
+		hidden2 = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(hidden2, NET_WEIGHTSHIFT), zero), one);
+		__m256i weights3 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)&net->weights3[bucket][j]));
+		output = _mm256_add_epi32(output, _mm256_mullo_epi32(hidden2, weights3));
+	}
+	__m128i total = _mm_add_epi32(_mm256_castsi256_si128(output), _mm256_extracti128_si256(output, 1));
+	total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0x4e));
+	total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0xb1));
+	return net->bias3[bucket] + _mm_cvtsi128_si32(total);
+}
+#else
+int net_layers_avx2(const Network *net, const int16_t *acc, int bucket)
+{
+	return net_layers_generic(net, acc, bucket);
+}
+#endif
+/**
+ * @brief Converts the output of the layers to evaluation units, within the largest possible disc difference.
+ *
+ * @param output The output of the layers.
+ * @return The score.
+ */
+int net_score(int output)
+{
+	int score = output / (NET_ONE * NET_WEIGHTSCALE / NET_SCORESCALE);
+	int limit = PLAYABLESQUARES * NET_SCORESCALE;
+
+	return (score > limit) ? limit : (score < -limit) ? -limit : score;
+}
+/**
+ * @brief Adds or subtracts the first-layer rows of some discs of one colour in both players' views: the
+ * 		  colour's own view reads its discs as its own, the other as the opponent's.
+ *
+ * @param net The network.
+ * @param acc The accumulator.
+ * @param colour The colour of the discs, 0 for black and 1 for white.
+ * @param discs The discs.
+ * @param sign 1 to add, -1 to subtract.
+ */
+void net_add_rows(const Network *net, NetAccumulator *acc, int colour, uint64_t discs, int sign)
+{
+	int16_t *own = acc->values[colour];
+	int16_t *opp = acc->values[1 - colour];
+
+	for (; discs; discs &= discs - 1)
+	{
+		int square = __builtin_ctzll(discs);
+		const int16_t *own_row = net->weights1[square];
+		const int16_t *opp_row = net->weights1[PLAYABLESQUARES + square];
+		if (sign > 0)
+		{
+			for (int i = 0; i < NET_HIDDEN1; i++)
+			{
+				own[i] += own_row[i];
+				opp[i] += opp_row[i];
+			}
+		}
+		else
+		{
+			for (int i = 0; i < NET_HIDDEN1; i++)
+			{
+				own[i] -= own_row[i];
+				opp[i] -= opp_row[i];
+			}
+		}
+	}
+}
+/**
+ * @brief Writes integers of one size as little-endian bytes.
+ *
+ * @return 1 on success, 0 on a write error.
+ */
+int put_values(FILE *file, const void *values, int count, int size)
+{
+	const uint8_t *bytes = (const uint8_t *)values;
+
+	for (int i = 0; i < count; i++)
+	{
+		uint8_t out[sizeof(uint32_t)];
+		uint32_t value = (size == sizeof(int8_t))	 ? bytes[i]
+						 : (size == sizeof(int16_t)) ? *(const uint16_t *)(bytes + i * size)
+													 : *(const uint32_t *)(bytes + i * size);
+		for (int b = 0; b < size; b++)
+		{
+			out[b] = value >> (8 * b) & 0xff;
+		}
+		if (fwrite(out, 1, size, file) != (size_t)size)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+/**
+ * @brief Reads integers of one size written by put_values.
+ *
+ * @return 1 on success, 0 if the file ends first.
+ */
+int get_values(FILE *file, void *values, int count, int size)
+{
+	uint8_t *bytes = (uint8_t *)values;
+
+	for (int i = 0; i < count; i++)
+	{
+		uint8_t in[sizeof(uint32_t)];
+		uint32_t value = 0;
+		if (fread(in, 1, size, file) != (size_t)size)
+		{
+			return 0;
+		}
+		for (int b = 0; b < size; b++)
+		{
+			value |= (uint32_t)in[b] << (8 * b);
+		}
+		if (size == sizeof(int8_t))
+		{
+			bytes[i] = (uint8_t)value;
+		}
+		else if (size == sizeof(int16_t))
+		{
+			*(uint16_t *)(bytes + i * size) = (uint16_t)value;
+		}
+		else
+		{
+			*(uint32_t *)(bytes + i * size) = value;
+		}
+	}
+	return 1;
+}
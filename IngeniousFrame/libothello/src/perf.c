@@ -0,0 +1,223 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Hardware performance counters per search phase, read through
+ *    perf_event_open. Each event is a counter of this thread in user
+ *    space. Where the kernel allows it the counters are read with rdpmc
+ *    from their mapped pages, which costs a few dozen cycles; otherwise
+ *    with read(). Events the processor or the kernel (perf_event_paranoid,
+ *    virtual machines) do not offer are left at zero.
+ *
+ *H***********************************************************************/
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "board.h"
+#include "perf.h"
+
+const char *PERF_PHASENAMES[PERF_PHASES] = {"movegen", "make", "eval", "hash", "mpi"};
+const char *PERF_EVENTNAMES[PERF_EVENTS] = {"cycles", "instructions", "branch-misses", "l1d-misses",
+											"llc-misses"};
+
+int perf_fds[PERF_EVENTS] = {-1, -1, -1, -1, -1};	   // event file descriptors, -1 if not counted
+struct perf_event_mmap_page *perf_pages[PERF_EVENTS]; // mapped pages for rdpmc, NULL if not mapped
+uint64_t perf_base[PERF_EVENTS];					   // counts at perf_open
+uint64_t perf_start[PERF_EVENTS];					   // counts when the current phase began
+PerfCounts perf_totals;
+
+uint64_t perf_read(int event);
+void perf_attr(struct perf_event_attr *attr, int event);
+
+/**
+ * @brief Opens every event for the calling thread and starts counting. Safe to call when the events cannot be
+ * 		  opened; they then read as zero.
+ *
+ * @return SUCCESS if at least the cycle counter is open, FAILURE otherwise.
+ */
+int perf_open(void)
+{
+	long page_size = sysconf(_SC_PAGESIZE);
+
+	memset(&perf_totals, 0, sizeof(perf_totals));
+	for (int i = 0; i < PERF_EVENTS; i++)
+	{
+		struct perf_event_attr attr;
+		perf_attr(&attr, i);
+		perf_fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0); // This thread, any CPU
+		perf_pages[i] = NULL;
+		if (perf_fds[i] < 0)
+		{
+			perf_fds[i] = -1;
+			continue;
+		}
+		void *page = mmap(NULL, page_size, PROT_READ, MAP_SHARED, perf_fds[i], 0);
+		if (page != MAP_FAILED)
+		{
+			perf_pages[i] = (struct perf_event_mmap_page *)page;
+		}
+		ioctl(perf_fds[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(perf_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+	for (int i = 0; i < PERF_EVENTS; i++)
+	{
+		perf_base[i] = perf_read(i);
+	}
+	return (perf_fds[PERF_CYCLES] == -1) ? FAILURE : SUCCESS;
+}
+/**
+ * @brief Stops counting and closes the events. The counts taken so far remain readable with perf_counts.
+ */
+void perf_close(void)
+{
+	long page_size = sysconf(_SC_PAGESIZE);
+
+	perf_counts(&perf_totals); // Keeps the run total
+	for (int i = 0; i < PERF_EVENTS; i++)
+	{
+		if (perf_pages[i] != NULL)
+		{
+			munmap(perf_pages[i], page_size);
+			perf_pages[i] = NULL;
+		}
+		if (perf_fds[i] != -1)
+		{
+			close(perf_fds[i]);
+			perf_fds[i] = -1;
+		}
+	}
+}
+/**
+ * @brief Marks the start of a phase.
+ *
+ * @param phase The phase, one of PERF_MOVEGEN to PERF_MPI.
+ */
+void perf_begin(int phase)
+{
+	for (int i = 0; i < PERF_EVENTS; i++)
+	{
+		perf_start[i] = perf_read(i);
+	}
+}
+/**
+ * @brief Marks the end of a phase and adds the events since perf_begin to it.
+ *
+ * @param phase The phase, as given to perf_begin.
+ */
+void perf_end(int phase)
+{
+	for (int i = 0; i < PERF_EVENTS; i++)
+	{
+		perf_totals.events[phase][i] += perf_read(i) - perf_start[i];
+	}
+	perf_totals.calls[phase]++;
+}
+/**
+ * @brief Copies out the counts per phase, and the counts since perf_open into row PERF_TOTAL.
+ *
+ * @param counts The counts.
+ * @return SUCCESS if the cycle counter is or was open, FAILURE if nothing was counted.
+ */
+int perf_counts(PerfCounts *counts)
+{
+	if (perf_fds[PERF_CYCLES] != -1)
+	{
+		for (int i = 0; i < PERF_EVENTS; i++)
+		{
+			perf_totals.events[PERF_TOTAL][i] = perf_read(i) - perf_base[i];
+		}
+	}
+	*counts = perf_totals;
+	return (counts->events[PERF_TOTAL][PERF_CYCLES] == 0) ? FAILURE : SUCCESS;
+}
+/**
+ * @brief Reads the current count of an event: with rdpmc when the kernel has enabled it for the counter and the
+ * 		  counter is on the processor, otherwise with read().
+ *
+ * @param event The event.
+ * @return The count, 0 if the event is not open.
+ */
+uint64_t perf_read(int event)
+{
+	uint64_t count = 0;
+
+	if (perf_fds[event] == -1)
+	{
+		return 0;
+	}
+#if defined(__x86_64__) || defined(__i386__)
+	struct perf_event_mmap_page *page = perf_pages[event];
+	if (page != NULL && page->cap_user_rdpmc)
+	{
+		uint32_t sequence;
+		uint32_t index;
+		do // The kernel bumps lock while it updates the page
+		{
+			sequence = page->lock;
+			__asm__ volatile("" ::: "memory");
+			index = page->index;
+			count = page->offset;
+			if (index != 0) // 0 while the counter is not scheduled
+			{
+				uint32_t low;
+				uint32_t high;
+				__asm__ volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(index - 1));
+				int shift = 64 - page->pmc_width;
+				count += (uint64_t)((int64_t)(((uint64_t)high << 32 | low) << shift) >> shift); // Sign extends
+			}
+			__asm__ volatile("" ::: "memory");
+		} while (page->lock != sequence);
+		if (index != 0)
+		{
+			return count;
+		}
+	}
+#endif
+	if (read(perf_fds[event], &count, sizeof(count)) != sizeof(count))
+	{
+		return 0;
+	}
+	return count;
+}
+/**
+ * @brief Describes an event to perf_event_open: counted in user space only and enabled once opened.
+ *
+ * @param attr The description to fill in.
+ * @param event The event.
+ */
+void perf_attr(struct perf_event_attr *attr, int event)
+{
+	memset(attr, 0, sizeof(*attr));
+	attr->size = sizeof(*attr);
+	attr->disabled = 1;
+	attr->exclude_kernel = 1;
+	attr->exclude_hv = 1;
+	switch (event)
+	{
+	case PERF_CYCLES:
+		attr->type = PERF_TYPE_HARDWARE;
+		attr->config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case PERF_INSTRUCTIONS:
+		attr->type = PERF_TYPE_HARDWARE;
+		attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case PERF_BRANCHMISSES:
+		attr->type = PERF_TYPE_HARDWARE;
+		attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	case PERF_L1DMISSES:
+		attr->type = PERF_TYPE_HW_CACHE;
+		attr->config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+					   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	default:
+		attr->type = PERF_TYPE_HARDWARE;
+		attr->config = PERF_COUNT_HW_CACHE_MISSES; // Last level cache
+		break;
+	}
+}
@@ -0,0 +1,356 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Alpha/Beta MiniMax search over positions.
+ *
+ *H***********************************************************************/
+
+#include <limits.h>
+#include "board.h"
+#include "eval.h"
+#include "net.h"
+#include "perf.h"
+#include "search.h"
+#include "tt.h"
+
+long long nodes_searched; // nodes visited by the current search
+long long node_limit;	  // nodes the current search may visit, 0 for no limit
+int search_aborted;		  // set once the node limit is hit or the poll hook cancels the search
+void (*search_poll)(void);	  // called every poll_interval nodes, may set search_aborted; NULL for none
+long long poll_interval;  // nodes between calls of search_poll
+long long next_poll;	  // node count at which search_poll is called next
+TranspositionTable *search_table; // table used by minimax, NULL for none
+int (*remote_probe)(uint64_t hash, int player, TTData *data);		// second table for nodes near the root, or NULL
+void (*remote_store)(uint64_t hash, int player, const TTData *data); // stores into the second table
+int remote_depth;													 // shallowest remaining depth using the second table
+const Network *search_network;	// network minimax evaluates with, NULL for the square weights
+NetAccumulator net_stack[NET_MAXPLY + 1]; // accumulator of every position on the line being searched
+int search_ply;					// moves and passes from the root of the search to the current node
+
+int search_child(const Position *pos, const Position *child, int player, int depth, int alpha, int beta);
+
+/**
+ * @brief The minimax algorithm for determining the best move. Every child is searched on its own copy
+ * 		  of the position. A player with no moves passes; the pass does not use up depth. The game is over
+ * 		  when the board is full or a player cannot move right after a pass, and is then scored exactly.
+ * 		  When search_table is set, nodes at least TT_MINDEPTH from the frontier are looked up before they
+ * 		  are searched and stored afterwards, and the stored best move is searched first. Nodes at least
+ * 		  remote_depth from the frontier also use the slower remote table when one is set, when the
+ * 		  local table has nothing deep enough. With search_network set, positions are scored by the network,
+ * 		  whose accumulator is computed at the root and updated by each move on the way down. Once
+ * 		  search_aborted is set every node returns at once, and the caller must ignore the score.
+ *
+ * @param pos The position to search.
+ * @param player The player the score is maximised for.
+ * @param depth The depth of the search tree (depth = 6).
+ * @param alpha The alpha value for alpha-beta pruning.
+ * @param beta The beta value for alpha-beta pruning.
+ * @return int The evaluation score for the current board position.
+ */
+int minimax(const Position *pos, int player, int depth, int alpha, int beta)
+{
+	nodes_searched++;
+	if (search_poll != NULL && nodes_searched >= next_poll) // Time to check for messages
+	{
+		next_poll = nodes_searched + poll_interval;
+		search_poll();
+	}
+	if (search_aborted || (node_limit && nodes_searched > node_limit)) // Cancelled, or node budget spent
+	{
+		search_aborted = 1;
+		return 0;
+	}
+	if (search_network != NULL && search_ply == 0) // The root of a search
+	{
+		PERF_BEGIN(PERF_EVAL);
+		net_refresh(search_network, pos, &net_stack[0]);
+		PERF_END(PERF_EVAL);
+	}
+	if (pos->empties == 0) // Board is full
+	{
+		PERF_BEGIN(PERF_EVAL);
+		int score = final_score(pos, player);
+		PERF_END(PERF_EVAL);
+		return score;
+	}
+	if (depth == 0) // if depth reached
+	{
+		PERF_BEGIN(PERF_EVAL);
+		int score = (search_network != NULL) ? net_evaluate(search_network, &net_stack[search_ply], pos, player)
+											 : evaluate(pos, player); // Evaluates the position on the board
+		PERF_END(PERF_EVAL);
+		return score;
+	}
+
+	int moves[LEGALMOVSBUFSIZE];
+	PERF_BEGIN(PERF_MOVEGEN);
+	int size = legal_moves(pos, moves);
+	PERF_END(PERF_MOVEGEN);
+
+	if (size == 0)
+	{
+		if (pos->passed) // Neither player can move
+		{
+			PERF_BEGIN(PERF_EVAL);
+			int score = final_score(pos, player);
+			PERF_END(PERF_EVAL);
+			return score;
+		}
+		Position child = *pos;
+		PERF_BEGIN(PERF_MAKE);
+		make_pass(&child);
+		PERF_END(PERF_MAKE);
+		return search_child(pos, &child, player, depth, alpha, beta);
+	}
+
+	if (depth == 1)  // Frontier node: score all children in one batch
+	{
+		int scores[MAXBATCH];
+		int best = (pos->to_move == player) ? INT_MIN : INT_MAX;
+		PERF_BEGIN(PERF_EVAL); // Includes making the children
+		if (search_network != NULL)
+		{
+			net_evaluate_children(search_network, &net_stack[search_ply], pos, player, moves, size, scores);
+		}
+		else
+		{
+			evaluate_children(pos, player, moves, size, scores);
+		}
+		PERF_END(PERF_EVAL);
+		nodes_searched += size;
+		for (int i = 0; i < size; i++)
+		{
+			if (pos->to_move == player)  // Maximising Player
+			{
+				best = max(best, scores[i]);
+				alpha = max(alpha, scores[i]);
+			}
+			else  // Minimising Player
+			{
+				best = min(best, scores[i]);
+				beta = min(beta, scores[i]);
+			}
+			if (beta <= alpha)
+			{
+				break;
+			}
+		}
+		return best;
+	}
+
+	TTData entry;
+	TTData remote;
+	int use_table = search_table != NULL && depth >= TT_MINDEPTH;
+	int use_remote = remote_probe != NULL && depth >= max(remote_depth, TT_MINDEPTH);
+	PERF_BEGIN(PERF_HASH);
+	int found = use_table && tt_probe(search_table, pos->hash, player, &entry);
+	if (use_remote && (!found || entry.depth < depth) && remote_probe(pos->hash, player, &remote) &&
+		(!found || remote.depth > entry.depth))
+	{
+		entry = remote;
+		found = 1;
+	}
+	PERF_END(PERF_HASH);
+	if (found)
+	{
+		if (entry.depth >= depth && (entry.bound == TT_EXACT || (entry.bound == TT_LOWER && entry.score >= beta) ||
+									 (entry.bound == TT_UPPER && entry.score <= alpha)))
+		{
+			return entry.score; // Already searched deep enough
+		}
+		for (int i = 1; i < size; i++)
+		{
+			if (moves[i] == entry.move) // Search the remembered best move first
+			{
+				moves[i] = moves[0];
+				moves[0] = entry.move;
+				break;
+			}
+		}
+	}
+
+	int alpha_in = alpha;
+	int beta_in = beta;
+	int best_move = moves[0];
+	int best;
+	if (pos->to_move == player)  // Maximising Player
+	{
+		best = INT_MIN;
+		for (int i = 0; i < size; i++)
+		{
+			Position child = *pos;
+			PERF_BEGIN(PERF_MAKE);
+			make_move(&child, moves[i]);
+			PERF_END(PERF_MAKE);
+			int eval = search_child(pos, &child, player, depth - 1, alpha, beta);
+			if (search_aborted)
+			{
+				break;
+			}
+			if (eval > best)
+			{
+				best = eval; // Finds highest evaluation of every move
+				best_move = moves[i];
+			}
+			alpha = max(alpha, eval);     // Adjusts Alpha value
+			if (beta <= alpha)			  // Prunes if needed
+			{
+				break;
+			}
+		}
+	}
+	else  // Minimising Player
+	{
+		best = INT_MAX;
+		for (int i = 0; i < size; i++)
+		{
+			Position child = *pos;
+			PERF_BEGIN(PERF_MAKE);
+			make_move(&child, moves[i]);
+			PERF_END(PERF_MAKE);
+			int eval = search_child(pos, &child, player, depth - 1, alpha, beta);
+			if (search_aborted)
+			{
+				break;
+			}
+			if (eval < best)
+			{
+				best = eval;   // Finds lowest evaluation of every move
+				best_move = moves[i];
+			}
+			beta = min(beta, eval);			// Adjust Beta values
+			if (beta <= alpha)				// Prunes if needed
+			{
+				break;
+			}
+		}
+	}
+
+	if ((use_table || use_remote) && !search_aborted)
+	{
+		entry.score = best;
+		entry.depth = depth;
+		entry.bound = (best <= alpha_in) ? TT_UPPER : (best >= beta_in) ? TT_LOWER : TT_EXACT;
+		entry.move = best_move;
+		PERF_BEGIN(PERF_HASH);
+		if (use_table)
+		{
+			tt_store(search_table, pos->hash, player, &entry);
+		}
+		if (use_remote)
+		{
+			remote_store(pos->hash, player, &entry);
+		}
+		PERF_END(PERF_HASH);
+	}
+	return best;
+}
+/**
+ * @brief Searches a child of a node one ply further from the root, first deriving the child's accumulator
+ * 		  from the node's when positions are scored by a network.
+ *
+ * @param pos The position of the node.
+ * @param child The position after a move or pass.
+ * @param player The player the score is maximised for.
+ * @param depth The depth left for the child.
+ * @param alpha The alpha value for alpha-beta pruning.
+ * @param beta The beta value for alpha-beta pruning.
+ * @return The evaluation score of the child.
+ */
+int search_child(const Position *pos, const Position *child, int player, int depth, int alpha, int beta)
+{
+	if (search_network != NULL)
+	{
+		PERF_BEGIN(PERF_EVAL);
+		net_update(search_network, &net_stack[search_ply], pos, child, &net_stack[search_ply + 1]);
+		PERF_END(PERF_EVAL);
+	}
+	search_ply++;
+	int score = minimax(child, player, depth, alpha, beta);
+	search_ply--;
+	return score;
+}
+/**
+ * @brief Reads a principal variation out of the transposition tables after a search: the best move stored for
+ * 		  each position in turn, with the passes in between, until a position is missing. Nodes within
+ * 		  TT_MINDEPTH of the frontier are never stored, so the line ends a little short of the search depth.
+ *
+ * @param pos The position the line starts from.
+ * @param player The player the search maximised for.
+ * @param pv The moves, -1 for a pass.
+ * @param max_length The most moves to return.
+ * @return The number of moves in pv.
+ */
+int search_pv(const Position *pos, int player, int *pv, int max_length)
+{
+	Position current = *pos;
+	int moves[LEGALMOVSBUFSIZE];
+	int length = 0;
+	TTData entry;
+
+	while (length < max_length)
+	{
+		if (legal_moves(&current, moves) == 0)
+		{
+			if (current.passed || current.empties == 0) // Game over
+			{
+				break;
+			}
+			make_pass(&current);
+			pv[length++] = -1;
+			continue;
+		}
+		int found = (search_table != NULL && tt_probe(search_table, current.hash, player, &entry)) ||
+					(remote_probe != NULL && remote_probe(current.hash, player, &entry));
+		if (!found || entry.move == TT_NOMOVE || !legalp(&current, entry.move)) // Missing, or another position's key
+		{
+			break;
+		}
+		make_move(&current, entry.move);
+		pv[length++] = entry.move;
+	}
+	while (length > 0 && pv[length - 1] == -1) // A line does not end in a pass
+	{
+		length--;
+	}
+	return length;
+}
+/**
+ * @brief the maximum value between two integers.
+ *
+ * @param value1 The first value.
+ * @param value2 The second value.
+ * @return The maximum value.
+ */
+int max(int value1, int value2)
+{
+	// Max Function
+	if (value1 > value2)
+	{
+		return value1;
+	}
+	else
+	{
+		return value2;
+	}
+}
+/**
+ * @brief the minimum value between two integers.
+ *
+ * @param value1 The first value.
+ * @param value2 The second value.
+ * @return The minimum value.
+ */
+int min(int value1, int value2)
+{
+	// Min Function
+	if (value1 > value2)
+	{
+		return value2;
+	}
+	else
+	{
+		return value1;
+	}
+}
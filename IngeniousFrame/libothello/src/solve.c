@@ -0,0 +1,296 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Exact endgame solver: a NegaScout search to the end of the game
+ *    that scores positions by their final disc difference, for the side
+ *    to move. Called with the window (-1, 1) it only proves a win, loss
+ *    or draw, which is much faster.
+ *
+ *    It shares the search's transposition table (search_table), keying
+ *    its entries with SOLVE_KEY so that they never answer a MiniMax
+ *    probe. Near the root every child is looked up before any is searched
+ *    (enhanced transposition cutoffs), and a position whose opponent
+ *    already has enough stable discs is cut without a search. It counts
+ *    nodes and honours search_poll and search_aborted like minimax.
+ *
+ *H***********************************************************************/
+
+#include "board.h"
+#include "eval.h"
+#include "search.h"
+#include "solve.h"
+#include "stability.h"
+#include "tt.h"
+
+int solve_last(const Position *pos);
+int solve_table_cut(const Position *pos, int *alpha, int *beta, int *score, int *best_move);
+void solve_store(const Position *pos, int alpha, int beta, int score, int move);
+
+/**
+ * @brief Solves a position exactly within a window, fail-soft: a score at or below alpha is an upper bound on
+ * 		  the true score, one at or above beta a lower bound, and one in between exact. Once search_aborted is
+ * 		  set every node returns at once, and the caller must ignore the score.
+ *
+ * @param pos The position.
+ * @param alpha The lower end of the window, at least -SOLVE_MAXSCORE - 1.
+ * @param beta The upper end of the window, at most SOLVE_MAXSCORE + 1.
+ * @return The final disc difference for the player to move, empties counted for the winner.
+ */
+int solve(const Position *pos, int alpha, int beta)
+{
+	nodes_searched++;
+	if (search_poll != NULL && nodes_searched >= next_poll) // Time to check for messages
+	{
+		next_poll = nodes_searched + poll_interval;
+		search_poll();
+	}
+	if (search_aborted || (node_limit && nodes_searched > node_limit))
+	{
+		search_aborted = 1;
+		return 0;
+	}
+	if (pos->empties == 0)
+	{
+		return disc_difference(pos);
+	}
+	if (pos->empties == 1)
+	{
+		return solve_last(pos);
+	}
+
+	uint64_t own = pos->discs[pos->to_move - 1];
+	uint64_t opp = pos->discs[opponent(pos->to_move) - 1];
+	if (pos->empties >= SOLVE_STABLEEMPTIES) // The opponent keeps its stable discs whatever happens
+	{
+		int upper = SOLVE_MAXSCORE - 2 * __builtin_popcountll(stable_discs(opp, own));
+		if (upper <= alpha)
+		{
+			return upper;
+		}
+	}
+
+	int moves[LEGALMOVSBUFSIZE];
+	int size = legal_moves(pos, moves);
+	if (size == 0)
+	{
+		if (mobility(opp, own) == 0) // Neither player can move
+		{
+			return disc_difference(pos);
+		}
+		Position child = *pos;
+		make_pass(&child);
+		return -solve(&child, -beta, -alpha);
+	}
+
+	int score;
+	int best_move = TT_NOMOVE;
+	if (search_table != NULL && pos->empties >= SOLVE_TTEMPTIES && solve_table_cut(pos, &alpha, &beta, &score, &best_move))
+	{
+		return score;
+	}
+	int alpha_in = alpha; // The window after the table narrowed it, which the stored bound refers to
+	if (pos->empties >= SOLVE_ORDEREMPTIES)
+	{
+		solve_order(pos, moves, size);
+	}
+	for (int i = 1; i < size && best_move != TT_NOMOVE; i++)
+	{
+		if (moves[i] == best_move) // The stored best move goes first
+		{
+			moves[i] = moves[0];
+			moves[0] = best_move;
+			break;
+		}
+	}
+	if (search_table != NULL && pos->empties >= SOLVE_ETCEMPTIES) // Enhanced transposition cutoffs
+	{
+		for (int i = 0; i < size; i++)
+		{
+			TTData entry;
+			Position child = *pos;
+			make_move(&child, moves[i]);
+			if (tt_probe(search_table, child.hash ^ SOLVE_KEY, child.to_move, &entry) &&
+				entry.bound != TT_LOWER && -entry.score >= beta) // The child is at most entry.score for the opponent
+			{
+				solve_store(pos, alpha_in, beta, -entry.score, moves[i]);
+				return -entry.score;
+			}
+		}
+	}
+
+	int best = -SOLVE_MAXSCORE - 1;
+	best_move = moves[0];
+	for (int i = 0; i < size; i++)
+	{
+		Position child = *pos;
+		make_move(&child, moves[i]);
+		if (i == 0)
+		{
+			score = -solve(&child, -beta, -alpha);
+		}
+		else // Proves the move is no better with a null window first
+		{
+			score = -solve(&child, -alpha - 1, -alpha);
+			if (score > alpha && score < beta && !search_aborted)
+			{
+				score = -solve(&child, -beta, -score);
+			}
+		}
+		if (search_aborted)
+		{
+			return 0;
+		}
+		if (score > best)
+		{
+			best = score;
+			best_move = moves[i];
+			alpha = max(alpha, score);
+			if (alpha >= beta)
+			{
+				break;
+			}
+		}
+	}
+	solve_store(pos, alpha_in, beta, best, best_move);
+	return best;
+}
+/**
+ * @brief Solves a position with one empty square: whoever can play there does, the player to move first.
+ *
+ * @param pos The position.
+ * @return The final disc difference for the player to move.
+ */
+int solve_last(const Position *pos)
+{
+	int square = __builtin_ctzll(~(pos->discs[0] | pos->discs[1]));
+	Position child = *pos;
+
+	nodes_searched++;
+	if (would_flip(pos, square))
+	{
+		make_move(&child, square);
+		return -disc_difference(&child);
+	}
+	make_pass(&child);
+	if (would_flip(&child, square))
+	{
+		make_move(&child, square);
+		return disc_difference(&child);
+	}
+	return disc_difference(pos);
+}
+/**
+ * @brief Looks a position up in the table and narrows the window by what is stored.
+ *
+ * @param pos The position.
+ * @param alpha The lower end of the window, raised by a stored lower bound.
+ * @param beta The upper end of the window, lowered by a stored upper bound.
+ * @param score The stored score when the position is cut.
+ * @param best_move The stored best move, left alone when there is none.
+ * @return 1 if the stored result settles the position, 0 otherwise.
+ */
+int solve_table_cut(const Position *pos, int *alpha, int *beta, int *score, int *best_move)
+{
+	TTData entry;
+
+	if (!tt_probe(search_table, pos->hash ^ SOLVE_KEY, pos->to_move, &entry))
+	{
+		return 0;
+	}
+	*best_move = entry.move;
+	if (entry.bound == TT_EXACT)
+	{
+		*score = entry.score;
+		return 1;
+	}
+	if (entry.bound == TT_LOWER)
+	{
+		*alpha = max(*alpha, entry.score);
+	}
+	else
+	{
+		*beta = min(*beta, entry.score);
+	}
+	*score = entry.score;
+	return *alpha >= *beta;
+}
+/**
+ * @brief Stores the result of solving a position, with its bound, when it is deep enough to be worth it.
+ *
+ * @param pos The position.
+ * @param alpha The lower end of the window it was searched with.
+ * @param beta The upper end.
+ * @param score The result.
+ * @param move The best or refuting move.
+ */
+void solve_store(const Position *pos, int alpha, int beta, int score, int move)
+{
+	TTData entry;
+
+	if (search_table == NULL || pos->empties < SOLVE_TTEMPTIES)
+	{
+		return;
+	}
+	entry.score = score;
+	entry.depth = pos->empties;
+	entry.bound = (score <= alpha) ? TT_UPPER : (score >= beta) ? TT_LOWER : TT_EXACT;
+	entry.move = move;
+	tt_store(search_table, pos->hash ^ SOLVE_KEY, pos->to_move, &entry);
+}
+/**
+ * @brief Orders moves fastest-first: the move that leaves the opponent the fewest replies goes first, and
+ * 		  corners are tried before other moves with as few replies.
+ *
+ * @param pos The position.
+ * @param moves The moves, reordered in place.
+ * @param amount_of_moves The number of moves.
+ * @return The number of moves.
+ */
+int solve_order(const Position *pos, int *moves, int amount_of_moves)
+{
+	int keys[LEGALMOVSBUFSIZE];
+
+	for (int i = 0; i < amount_of_moves; i++)
+	{
+		Position child = *pos;
+		make_move(&child, moves[i]);
+		uint64_t replies = mobility(child.discs[child.to_move - 1], child.discs[opponent(child.to_move) - 1]);
+		keys[i] = 2 * __builtin_popcountll(replies) - (int)(CORNERS >> moves[i] & 1);
+	}
+	for (int i = 1; i < amount_of_moves; i++) // Insertion sort, stable for equal keys
+	{
+		int move = moves[i];
+		int key = keys[i];
+		int j = i;
+		for (; j > 0 && keys[j - 1] > key; j--)
+		{
+			moves[j] = moves[j - 1];
+			keys[j] = keys[j - 1];
+		}
+		moves[j] = move;
+		keys[j] = key;
+	}
+	return amount_of_moves;
+}
+/**
+ * @brief Scores a finished game for the player to move: the disc difference, with the empty squares going
+ * 		  to the winner.
+ *
+ * @param pos The final position.
+ * @return The disc difference.
+ */
+int disc_difference(const Position *pos)
+{
+	int diff = count(pos, pos->to_move) - count(pos, opponent(pos->to_move));
+
+	if (diff > 0)
+	{
+		return diff + pos->empties;
+	}
+	if (diff < 0)
+	{
+		return diff - pos->empties;
+	}
+	return 0;
+}
@@ -0,0 +1,254 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Bitboard features of a position for the evaluation and the endgame
+ *    solver: stable discs, frontier discs and potential mobility.
+ *
+ *    A disc is stable when no sequence of moves can flip it. stable_discs
+ *    finds a safe subset: edge discs from a table of every edge pattern,
+ *    then discs that, along each of the four lines through them, either
+ *    lie on a full line, touch the board edge or touch a stable disc of
+ *    their own colour, repeated until nothing is added.
+ *
+ *H***********************************************************************/
+
+#include "board.h"
+#include "stability.h"
+
+#define FILE_TO_BYTE 0x0102040810204080ULL // multiplier gathering file A into the top byte, rank r at bit r
+
+uint8_t EDGE_STABILITY[256][256]; // stable discs of an edge, by the edge's own and opponent discs
+uint64_t BYTE_TO_FILE[256];		  // file A with rank r set for bit r of the index
+
+int find_edge_stable(int own, int opp, int stable);
+int flip_edge(int *own, int *opp, int x);
+uint64_t smear(uint64_t discs, int dir);
+
+/**
+ * @brief Fills the edge stability table. Must be called once before stable_discs, like initialise_zobrist;
+ * 		  until then no edge disc counts as stable.
+ */
+void initialise_stability()
+{
+	for (int own = 0; own < 256; own++)
+	{
+		for (int opp = 0; opp < 256; opp++)
+		{
+			EDGE_STABILITY[own][opp] = (own & opp) ? 0 : find_edge_stable(own, opp, own);
+		}
+		BYTE_TO_FILE[own] = 0;
+		for (int rank = 0; rank < 8; rank++)
+		{
+			BYTE_TO_FILE[own] |= (uint64_t)(own >> rank & 1) << (8 * rank);
+		}
+	}
+}
+/**
+ * @brief Finds the discs of one player on an edge that stay theirs whatever is played on the edge: each
+ * 		  empty square is filled by either player in turn, flipping along the edge, and any disc that
+ * 		  changes is struck off. Moves need not be legal, which only makes the answer safer.
+ *
+ * @param own The player's discs on the edge, bit 0 at one corner.
+ * @param opp The opponent's discs on the edge.
+ * @param stable The discs still believed stable.
+ * @return The stable discs.
+ */
+int find_edge_stable(int own, int opp, int stable)
+{
+	int empty = ~(own | opp) & 0xff;
+
+	stable &= own;
+	if (stable == 0 || empty == 0)
+	{
+		return stable;
+	}
+	for (int x = 0; x < 8 && stable; x++)
+	{
+		if (!(empty >> x & 1))
+		{
+			continue;
+		}
+		int new_own = own | 1 << x; // The player fills the square
+		int new_opp = opp;
+		flip_edge(&new_own, &new_opp, x);
+		stable = find_edge_stable(new_own, new_opp, stable);
+
+		new_own = own; // The opponent fills it
+		new_opp = opp | 1 << x;
+		flip_edge(&new_opp, &new_own, x);
+		stable = find_edge_stable(new_own, new_opp, stable);
+	}
+	return stable;
+}
+/**
+ * @brief Flips the discs a disc just placed on an edge brackets along the edge.
+ *
+ * @param mover The discs of the player who placed it, including it.
+ * @param other The discs of the other player.
+ * @param x The square it was placed on.
+ * @return The number of discs flipped.
+ */
+int flip_edge(int *mover, int *other, int x)
+{
+	int flipped = 0;
+	int dirs[2] = {-1, 1};
+
+	for (int d = 0; d < 2; d++)
+	{
+		int line = 0;
+		int y = x + dirs[d];
+		while (y >= 0 && y < 8 && (*other >> y & 1))
+		{
+			line |= 1 << y;
+			y += dirs[d];
+		}
+		if (y >= 0 && y < 8 && (*mover >> y & 1) && line)
+		{
+			*mover |= line;
+			*other &= ~line;
+			flipped += __builtin_popcount(line);
+		}
+	}
+	return flipped;
+}
+/**
+ * @brief Computes the squares next to any of a set of discs, in all eight directions.
+ *
+ * @param discs The discs.
+ * @return The neighbouring squares, which may include the discs themselves.
+ */
+uint64_t neighbours(uint64_t discs)
+{
+	uint64_t result = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		result |= shift(discs, ALLDIRECTIONS[i]);
+	}
+	return result;
+}
+/**
+ * @brief Spreads discs along a diagonal to the edge of the board in three doubling steps (a Kogge-Stone fill
+ * 		  that nothing blocks).
+ *
+ * @param discs The discs.
+ * @param dir The direction, 7, 9, -7 or -9.
+ * @return The discs and every square beyond them in that direction.
+ */
+uint64_t smear(uint64_t discs, int dir)
+{
+	uint64_t open = (dir == 9 || dir == -7) ? ~FILE_A : ~FILE_H; // Squares a one-step shift may land on
+	int step = (dir > 0) ? dir : -dir;
+
+	if (dir > 0)
+	{
+		discs |= open & (discs << step);
+		open &= open << step;
+		discs |= open & (discs << 2 * step);
+		open &= open << 2 * step;
+		discs |= open & (discs << 4 * step);
+	}
+	else
+	{
+		discs |= open & (discs >> step);
+		open &= open >> step;
+		discs |= open & (discs >> 2 * step);
+		open &= open >> 2 * step;
+		discs |= open & (discs >> 4 * step);
+	}
+	return discs;
+}
+/**
+ * @brief Finds the squares whose whole line in one direction and its opposite is filled, edge to edge.
+ *
+ * @param filled The occupied squares.
+ * @param dir The direction, one of ALLDIRECTIONS; dir and -dir give the same lines.
+ * @return The squares on full lines.
+ */
+uint64_t full_lines(uint64_t filled, int dir)
+{
+	switch ((dir > 0) ? dir : -dir)
+	{
+	case 1: // A rank is full when its eight bits are, folded onto file A
+		filled &= filled >> 4;
+		filled &= filled >> 2;
+		filled &= filled >> 1;
+		return (filled & FILE_A) * 0xff;
+	case 8: // A file likewise, folded onto rank 1
+		filled &= filled >> 32;
+		filled &= filled >> 16;
+		filled &= filled >> 8;
+		return (filled & RANK_1) * FILE_A;
+	default: // A diagonal when no empty square smears onto it from either side
+		return ~(smear(~filled, dir) | smear(~filled, -dir));
+	}
+}
+/**
+ * @brief Looks up the stable discs on the four edges of the board.
+ *
+ * @param own The player's discs.
+ * @param opp The opponent's discs.
+ * @return The player's stable edge discs.
+ */
+uint64_t edge_stable(uint64_t own, uint64_t opp)
+{
+	int own_a = ((own & FILE_A) * FILE_TO_BYTE) >> 56;
+	int opp_a = ((opp & FILE_A) * FILE_TO_BYTE) >> 56;
+	int own_h = (((own & FILE_H) >> 7) * FILE_TO_BYTE) >> 56;
+	int opp_h = (((opp & FILE_H) >> 7) * FILE_TO_BYTE) >> 56;
+
+	return (uint64_t)EDGE_STABILITY[own & 0xff][opp & 0xff] | (uint64_t)EDGE_STABILITY[own >> 56][opp >> 56] << 56 |
+		   BYTE_TO_FILE[EDGE_STABILITY[own_a][opp_a]] | BYTE_TO_FILE[EDGE_STABILITY[own_h][opp_h]] << 7;
+}
+/**
+ * @brief Finds discs of a player that can never be flipped (see the file header). The answer is a lower bound
+ * 		  on the truly stable discs, and never includes a disc that could be flipped.
+ *
+ * @param own The player's discs.
+ * @param opp The opponent's discs.
+ * @return The player's stable discs.
+ */
+uint64_t stable_discs(uint64_t own, uint64_t opp)
+{
+	uint64_t filled = own | opp;
+	uint64_t full_h = full_lines(filled, 1) | FILE_A | FILE_H; // A line direction is safe on a full line or at the edge
+	uint64_t full_v = full_lines(filled, 8) | RANK_1 | RANK_8;
+	uint64_t full_d9 = full_lines(filled, 9) | EDGES;
+	uint64_t full_d7 = full_lines(filled, 7) | EDGES;
+	uint64_t stable = edge_stable(own, opp) | (own & full_h & full_v & full_d9 & full_d7);
+	uint64_t previous = 0;
+
+	while (stable != previous)
+	{
+		previous = stable;
+		uint64_t safe_h = full_h | shift(stable, 1) | shift(stable, -1);
+		uint64_t safe_v = full_v | shift(stable, 8) | shift(stable, -8);
+		uint64_t safe_d9 = full_d9 | shift(stable, 9) | shift(stable, -9);
+		uint64_t safe_d7 = full_d7 | shift(stable, 7) | shift(stable, -7);
+		stable |= own & safe_h & safe_v & safe_d9 & safe_d7;
+	}
+	return stable;
+}
+/**
+ * @brief Finds the frontier discs of a player: those next to an empty square, which give the opponent moves.
+ *
+ * @param own The player's discs.
+ * @param opp The opponent's discs.
+ * @return The player's frontier discs.
+ */
+uint64_t frontier(uint64_t own, uint64_t opp)
+{
+	return own & neighbours(~(own | opp));
+}
+/**
+ * @brief Counts the potential mobility of a player: the empty squares next to an opponent disc, where moves
+ * 		  may open up later.
+ *
+ * @param own The player's discs.
+ * @param opp The opponent's discs.
+ * @return The number of such squares.
+ */
+int potential_mobility(uint64_t own, uint64_t opp)
+{
+	return __builtin_popcountll(~(own | opp) & neighbours(opp));
+}
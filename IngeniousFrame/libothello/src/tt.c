@@ -0,0 +1,192 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Transposition table on memory handed in by the caller, so that all
+ *    the ranks of a node can use one table in an MPI shared-memory window.
+ *    Entries are read and written without locks; every access is a
+ *    relaxed atomic 64-bit load or store, and the XOR of key and data
+ *    rejects entries that were torn by concurrent writers.
+ *
+ *H***********************************************************************/
+
+#include <string.h>
+#include "tt.h"
+
+#define TT_ALIGNMENT 64
+
+uint64_t tt_pack(int player, const TTData *data, uint8_t generation);
+int tt_player(uint64_t packed);
+int tt_depth(uint64_t packed);
+uint8_t tt_generation(uint64_t packed);
+
+/**
+ * @brief Lays a table over a block of memory: the largest power of two of buckets that fits after aligning the
+ * 		  start to a cache line. The memory is not cleared.
+ *
+ * @param tt The table to set up.
+ * @param memory The memory to use.
+ * @param bytes The size of the memory.
+ * @return The bytes the table uses, 0 if the memory is too small for one bucket.
+ */
+size_t tt_attach(TranspositionTable *tt, void *memory, size_t bytes)
+{
+	uintptr_t start = ((uintptr_t)memory + TT_ALIGNMENT - 1) & ~(uintptr_t)(TT_ALIGNMENT - 1);
+	size_t usable = bytes - (start - (uintptr_t)memory);
+	size_t bucket_bytes = TT_BUCKETSIZE * sizeof(TTEntry);
+	uint64_t buckets = 1;
+
+	if (memory == NULL || bytes < start - (uintptr_t)memory + bucket_bytes)
+	{
+		tt->entries = NULL;
+		tt->mask = 0;
+		return 0;
+	}
+	while (2 * buckets * bucket_bytes <= usable)
+	{
+		buckets *= 2;
+	}
+	tt->entries = (TTEntry *)start;
+	tt->mask = buckets - 1;
+	tt->generation = 0;
+	return buckets * bucket_bytes;
+}
+/**
+ * @brief Empties the table. Only one of the processes sharing a table should do this.
+ *
+ * @param tt The table.
+ */
+void tt_clear(TranspositionTable *tt)
+{
+	if (tt->entries != NULL)
+	{
+		memset(tt->entries, 0, (tt->mask + 1) * TT_BUCKETSIZE * sizeof(TTEntry));
+	}
+}
+/**
+ * @brief Starts a new search, so that the entries of earlier searches are the first to be replaced. Every
+ * 		  process sharing the table keeps its own generation and calls this once per move.
+ *
+ * @param tt The table.
+ */
+void tt_new_search(TranspositionTable *tt)
+{
+	tt->generation++;
+}
+/**
+ * @brief Looks a position up.
+ *
+ * @param tt The table.
+ * @param hash The Zobrist key of the position.
+ * @param player The player the scores are maximised for.
+ * @param data What the table knows, filled in on a hit.
+ * @return 1 on a hit, 0 otherwise.
+ */
+int tt_probe(const TranspositionTable *tt, uint64_t hash, int player, TTData *data)
+{
+	TTEntry *bucket = tt->entries + (hash & tt->mask) * TT_BUCKETSIZE;
+
+	for (int i = 0; i < TT_BUCKETSIZE; i++)
+	{
+		if (tt_read_entry(&bucket[i], hash, player, data))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+/**
+ * @brief Stores the result of a search. An entry for the same position is overwritten; otherwise the entry
+ * 		  replaced is the one with the lowest depth, counting entries of earlier searches as shallower.
+ *
+ * @param tt The table.
+ * @param hash The Zobrist key of the position.
+ * @param player The player the score is maximised for.
+ * @param data The score, its bound, the depth searched and the best move.
+ */
+void tt_store(TranspositionTable *tt, uint64_t hash, int player, const TTData *data)
+{
+	TTEntry *bucket = tt->entries + (hash & tt->mask) * TT_BUCKETSIZE;
+	TTEntry *victim = bucket;
+	int victim_worth = INT32_MAX;
+
+	for (int i = 0; i < TT_BUCKETSIZE; i++)
+	{
+		uint64_t key = __atomic_load_n(&bucket[i].key, __ATOMIC_RELAXED);
+		uint64_t packed = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+		if ((key ^ packed) == hash && tt_player(packed) == player)
+		{
+			victim = &bucket[i];
+			break;
+		}
+		int worth = tt_depth(packed) - ((tt_generation(packed) != tt->generation) ? 256 : 0);
+		if (worth < victim_worth)
+		{
+			victim_worth = worth;
+			victim = &bucket[i];
+		}
+	}
+
+	tt_make_entry(victim, hash, player, data, tt->generation);
+}
+/**
+ * @brief Fills in an entry, with relaxed atomic stores so that it may live in shared memory.
+ *
+ * @param entry The entry to write.
+ * @param hash The Zobrist key of the position.
+ * @param player The player the score is maximised for.
+ * @param data The score, its bound, the depth searched and the best move.
+ * @param generation The age of the search storing it.
+ */
+void tt_make_entry(TTEntry *entry, uint64_t hash, int player, const TTData *data, uint8_t generation)
+{
+	uint64_t packed = tt_pack(player, data, generation);
+	__atomic_store_n(&entry->key, hash ^ packed, __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->data, packed, __ATOMIC_RELAXED);
+}
+/**
+ * @brief Reads an entry if it holds the given position and player, and is not torn.
+ *
+ * @param entry The entry to read.
+ * @param hash The Zobrist key of the position.
+ * @param player The player the scores are maximised for.
+ * @param data What the entry knows, filled in on a match.
+ * @return 1 on a match, 0 otherwise.
+ */
+int tt_read_entry(const TTEntry *entry, uint64_t hash, int player, TTData *data)
+{
+	uint64_t key = __atomic_load_n(&entry->key, __ATOMIC_RELAXED);
+	uint64_t packed = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+
+	if ((key ^ packed) != hash || tt_player(packed) != player)
+	{
+		return 0;
+	}
+	data->score = (int32_t)(uint32_t)packed;
+	data->depth = tt_depth(packed);
+	data->bound = packed >> 40 & 3;
+	data->move = packed >> 44 & 0xff;
+	return 1;
+}
+/**
+ * @brief Packs an entry: score in bits 0-31, depth 32-39, bound 40-41, player 42-43, move 44-51 and
+ * 		  generation 52-59.
+ */
+uint64_t tt_pack(int player, const TTData *data, uint8_t generation)
+{
+	return (uint64_t)(uint32_t)data->score | (uint64_t)(data->depth & 0xff) << 32 |
+		   (uint64_t)(data->bound & 3) << 40 | (uint64_t)(player & 3) << 42 | (uint64_t)(data->move & 0xff) << 44 |
+		   (uint64_t)generation << 52;
+}
+int tt_player(uint64_t packed)
+{
+	return packed >> 42 & 3;
+}
+int tt_depth(uint64_t packed)
+{
+	return packed >> 32 & 0xff;
+}
+uint8_t tt_generation(uint64_t packed)
+{
+	return packed >> 52 & 0xff;
+}
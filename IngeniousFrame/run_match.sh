@@ -1,5 +1,5 @@
 if [ -z "$1" ] || [ -z "$2" ]|| [ -z "$3" ]|| [ -z "$4" ]; then
-echo "Usage: ./run.sh player1 player2 int_val_time_out_in_seconds num_processes"
+echo "Usage: ./run.sh player1 player2 int_val_time_out_in_seconds num_processes [memory_mb_per_process]"
 #exit
 else
 echo "Piping defaults to game.json"
@@ -8,7 +8,8 @@ echo "{
 	\"threads\": $4,
 	\"time\": $3,
 	\"path1\": \"$1\",
-	\"path2\": \"$2\"
+	\"path2\": \"$2\"${5:+,
+	\"memory\": $5}
 }" > Othello.json
 fi
 
@@ -0,0 +1,130 @@
+"""Strong and weak scaling benchmark of the distributed Alpha/Beta search.
+
+Runs players/my_player in analysis mode on a fixed suite of positions at a
+series of rank counts and reports, per rank count, the wall time, nodes,
+speedup, efficiency and search overhead against the single-rank run, and
+how each rank's time splits into searching, communication and waiting.
+
+Strong scaling searches every position to a fixed depth, so the work is
+fixed and more ranks should finish sooner; the extra nodes they search are
+the search overhead. Weak scaling gives every worker a fixed node budget
+(deterministic mode), so the work grows with the ranks and the time should
+stay flat.
+
+    python3 run_scaling.py --ranks 1,2,4,8 --depth 8 --csv scaling.csv
+    python3 run_scaling.py --weak --nodes 200000 --rank-csv ranks.csv
+"""
+
+import argparse
+import csv
+import os
+import re
+import subprocess
+import sys
+
+PLAYER = "players/my_player"
+POSITIONS = "bench/positions.txt"
+
+regexresult = re.compile(r" nodes (?P<nodes>\d+) time (?P<time>[\d.]+) ")
+regexrank = re.compile(r"^# rank (?P<rank>\d+) search (?P<search>[\d.]+) comm (?P<comm>[\d.]+) "
+                       r"idle (?P<idle>[\d.]+) nodes (?P<nodes>[\d.]+)")
+
+SUMMARY_FIELDS = ["mode", "ranks", "time", "nodes", "nodes_per_second", "speedup", "efficiency",
+                  "search_overhead", "search", "comm", "idle"]
+RANK_FIELDS = ["mode", "ranks", "rank", "search", "comm", "idle", "nodes"]
+
+
+def run_suite(ranks, args):
+    """Runs the suite once at the given rank count and returns the summed per-position times and nodes and the
+    per-rank statistics."""
+    command = args.mpirun.split() + ["-np", str(ranks), PLAYER, "--analyse", args.positions, "--rank-stats",
+                                     "--tt-mb", str(args.tt_mb), "--depth", str(args.depth),
+                                     "--solve-empties", "0", "--wld-empties", "0"]  # Measures the search alone
+    if args.weak:
+        command += ["--deterministic", "--nodes", str(args.nodes)]
+    command += args.options.split()
+    output = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+    if output.returncode != 0:
+        sys.exit("%s failed:\n%s" % (" ".join(command), output.stderr))
+
+    time = 0.0
+    nodes = 0
+    rank_stats = []
+    for line in output.stdout.splitlines():
+        match = regexrank.match(line)
+        if match:
+            rank_stats.append({key: float(value) for key, value in match.groupdict().items()})
+            continue
+        match = regexresult.search(line)
+        if match:
+            time += float(match.group("time"))
+            nodes += int(match.group("nodes"))
+    return time, nodes, rank_stats
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Scaling benchmark of the distributed search")
+    parser.add_argument("--ranks", default="1,2,4,8", help="comma-separated rank counts, 1 first (default 1,2,4,8)")
+    parser.add_argument("--positions", default=POSITIONS, help="position suite (default %s)" % POSITIONS)
+    parser.add_argument("--depth", type=int, default=8, help="search depth of strong scaling (default 8)")
+    parser.add_argument("--weak", action="store_true", help="weak scaling: a fixed node budget per worker")
+    parser.add_argument("--nodes", type=int, default=200000, help="node budget per worker of weak scaling")
+    parser.add_argument("--tt-mb", type=int, default=64, help="transposition table per node (default 64)")
+    parser.add_argument("--repeat", type=int, default=1, help="runs per rank count, the fastest is kept")
+    parser.add_argument("--mpirun", default="mpirun", help="launcher and its options (default mpirun)")
+    parser.add_argument("--options", default="", help="further player options")
+    parser.add_argument("--csv", help="summary CSV file (default standard output)")
+    parser.add_argument("--rank-csv", help="per-rank CSV file")
+    args = parser.parse_args()
+    if args.weak:
+        args.depth = 60  # Deterministic runs deepen until the budget is spent
+
+    if not os.path.isfile(PLAYER):
+        sys.exit("%s not found, run make in src_my_player first" % PLAYER)
+    mode = "weak" if args.weak else "strong"
+    rank_counts = [int(ranks) for ranks in args.ranks.split(",")]
+
+    summary = []
+    per_rank = []
+    base = None
+    for ranks in rank_counts:
+        runs = [run_suite(ranks, args) for _ in range(args.repeat)]
+        time, nodes, rank_stats = min(runs, key=lambda run: run[0])
+        if base is None:
+            base = (ranks, time, nodes)
+        base_ranks, base_time, base_nodes = base
+        speedup = base_time / time if time > 0 else 0.0
+        if args.weak:  # Work grows with the workers, so the ideal is a flat time
+            efficiency = speedup
+            overhead = 0.0
+        else:
+            efficiency = speedup * base_ranks / ranks
+            overhead = nodes / base_nodes - 1 if base_nodes > 0 else 0.0
+        row = {"mode": mode, "ranks": ranks, "time": "%.3f" % time, "nodes": nodes,
+               "nodes_per_second": "%.0f" % (nodes / time if time > 0 else 0.0), "speedup": "%.3f" % speedup,
+               "efficiency": "%.3f" % efficiency, "search_overhead": "%.3f" % overhead}
+        for key in ("search", "comm", "idle"):
+            row[key] = "%.3f" % sum(stats[key] for stats in rank_stats)
+        summary.append(row)
+        for stats in rank_stats:
+            per_rank.append({"mode": mode, "ranks": ranks, "rank": int(stats["rank"]),
+                             "search": "%.3f" % stats["search"], "comm": "%.3f" % stats["comm"],
+                             "idle": "%.3f" % stats["idle"], "nodes": int(stats["nodes"])})
+        print("%s %3d ranks: %8.3fs %12d nodes  speedup %6.2f  efficiency %5.2f  overhead %6.2f" %
+              (mode, ranks, time, nodes, speedup, efficiency, overhead), file=sys.stderr)
+
+    out = open(args.csv, "w", newline="") if args.csv else sys.stdout
+    writer = csv.DictWriter(out, fieldnames=SUMMARY_FIELDS)
+    writer.writeheader()
+    writer.writerows(summary)
+    if args.csv:
+        out.close()
+    if args.rank_csv:
+        with open(args.rank_csv, "w", newline="") as rank_out:
+            writer = csv.DictWriter(rank_out, fieldnames=RANK_FIELDS)
+            writer.writeheader()
+            writer.writerows(per_rank)
+
+
+if __name__ == "__main__":
+    main()
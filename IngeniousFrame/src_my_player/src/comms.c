@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include "comms.h" 
@@ -46,8 +47,59 @@ int comms_init_network(int* my_colour, unsigned long ip, int port) {
  * Creates socket, connects to remote server, and calls comms_get_colour 
  */
 int comms_get_colour(int* my_colour) {
+	return comms_get_colour_fd(socket_desc, my_colour);
+}
+
+/**
+ * Receives message from server, which includes a cmd 
+ * and, if cmd == play_move, also the opponent's move 
+ */
+int comms_get_cmd(char cmd[], char move[]) {
+	return comms_get_cmd_fd(socket_desc, cmd, move);
+}
+
+/**
+ * Sends a message to the server, which includes my_move 
+ * and, if cmd == play_move, also the opponent's move 
+ */
+int comms_send_move(char my_move[]) {
+	return comms_send_move_fd(socket_desc, my_move);
+}
+
+/**
+ * Creates a socket listening on all interfaces, for referees that
+ * connect to the engine (server mode). Returns the socket or FAILURE.
+ */
+int comms_listen(int port) {
+	struct sockaddr_in server;
+	int reuse = 1;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (fd == -1) {
+		return FAILURE;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	server.sin_addr.s_addr = htonl(INADDR_ANY);
+	server.sin_family = AF_INET;
+	server.sin_port = htons(port);
+
+	if (bind(fd, (struct sockaddr *)&server, sizeof(server)) < 0 || listen(fd, SOMAXCONN) < 0) {
+		#ifdef DEBUG
+		printf("Comms error: Could not listen on port %d\n", port);
+		#endif
+		close(fd);
+		return FAILURE;
+	}
+	return fd;
+}
+
+/**
+ * Receives the colour, the first byte a referee sends, on a connection 
+ */
+int comms_get_colour_fd(int fd, int* my_colour) {
 	char tempColour[2]; tempColour[1] = 0;
-	if(recv(socket_desc, tempColour , 1, 0) < 0){
+	if(recv(fd, tempColour , 1, 0) <= 0){
 		#ifdef DEBUG
 		printf("Comms error: Could not receive colour\n");
 		#endif
@@ -58,29 +110,29 @@ int comms_get_colour(int* my_colour) {
 }
 
 /**
- * Receives message from server, which includes a cmd 
- * and, if cmd == play_move, also the opponent's move 
+ * Receives a cmd, and for play_move the opponent's move, on a connection.
+ * Waits for the whole message; a closed connection is a FAILURE 
  */
-int comms_get_cmd(char cmd[], char move[]) {
+int comms_get_cmd_fd(int fd, char cmd[], char move[]) {
 	int result = SUCCESS;
 	int msg_len;
 
 	char* tmp_cmd;
 	char* tmp_move;
 
-	char* len_buf = malloc(LENBUFSIZE*sizeof(char));
-	char* msg_buf = malloc(MSGBUFSIZE*sizeof(char)); 
+	char len_buf[LENBUFSIZE]; // on the stack: nothing is allocated while a game is played
+	char msg_buf[MSGBUFSIZE];
 
 	memset(len_buf, 0, LENBUFSIZE);
 	memset(msg_buf, 0, MSGBUFSIZE);
 
-	if (recv(socket_desc, len_buf , 2, 0) < 0){
+	if (recv(fd, len_buf , 2, MSG_WAITALL) != 2){
 		result = FAILURE;
 	} else {
 
 		msg_len = atoi(len_buf);
 	
-		if (recv(socket_desc, msg_buf, msg_len, 0) < 0){
+		if (msg_len <= 0 || msg_len >= MSGBUFSIZE || recv(fd, msg_buf, msg_len, MSG_WAITALL) != msg_len){
 			result = FAILURE; 
 		} else {
 
@@ -100,19 +152,15 @@ int comms_get_cmd(char cmd[], char move[]) {
 		}
 	}
 
-	free(len_buf);
-	free(msg_buf);
-
 	return result;
 }
 
 /**
- * Sends a message to the server, which includes my_move 
- * and, if cmd == play_move, also the opponent's move 
+ * Sends my_move on a connection 
  */
-int comms_send_move(char my_move[]) {
+int comms_send_move_fd(int fd, char my_move[]) {
 
-	if (send(socket_desc, my_move, strlen(my_move) , 0) < 0) {
+	if (send(fd, my_move, strlen(my_move) , 0) < 0) {
 		return FAILURE;
 	}
 
@@ -4,12 +4,16 @@
 #define FAILURE -1
 #define SUCCESS 0
 
-#define MOVEBUFSIZE 6
+#define MOVEBUFSIZE 6 // "pass\n", or a row and a column of up to two digits each and "\n"
 #define CMDBUFSIZE 100
 
 int comms_init(int* my_colour);
 int comms_init_network(int* my_colour, unsigned long ip, int port);
 int comms_get_cmd(char cmd[], char move[]);
 int comms_send_move(char move[]);
+int comms_listen(int port);
+int comms_get_colour_fd(int fd, int* my_colour);
+int comms_get_cmd_fd(int fd, char cmd[], char move[]);
+int comms_send_move_fd(int fd, char move[]);
 
 #endif
@@ -0,0 +1,234 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Distributed transposition table for multi-node runs. Every rank owns
+ *    an equal partition of the table in an MPI window, and a position
+ *    lives on the rank chosen by the high bits of its Zobrist key.
+ *
+ *    Positions homed on this rank are read and written directly. Stores
+ *    for other ranks are queued per home rank and sent DTT_BATCH at a time
+ *    with MPI_Accumulate(MPI_REPLACE), so that no rank ever waits for a
+ *    store; only probes wait for a round trip (MPI_Get and MPI_Win_flush),
+ *    which is why the search only probes nodes near the root. The XOR
+ *    check of the entries (tt.h) rejects entries torn by concurrent
+ *    writers, so no locks are taken beyond one passive-target epoch.
+ *
+ *H***********************************************************************/
+
+#include <stdlib.h>
+#include <mpi.h>
+#include "arena.h"
+#include "tt.h"
+#include "search.h"
+#include "dtt.h"
+
+void dtt_send(int home);
+int dtt_home(uint64_t hash);
+
+DTTStats dtt_stats;
+MPI_Win dtt_window = MPI_WIN_NULL;	  // window holding every rank's partition
+TranspositionTable dtt_local;		  // this rank's partition
+MPI_Aint *dtt_offsets;				  // offset of the first entry in each rank's partition
+TTEntry *dtt_queue;					  // DTT_BATCH queued stores per home rank
+MPI_Aint *dtt_queue_disp;			  // where each queued store goes
+int *dtt_queued;					  // number of queued stores per home rank
+int dtt_rank;
+int dtt_size;
+
+/**
+ * @brief Creates the table, collectively on every rank of MPI_COMM_WORLD, and installs it as the remote
+ * 		  table of the search.
+ *
+ * @param bytes The size of this rank's partition.
+ * @param min_depth The shallowest remaining depth that probes and stores the table.
+ * @param arena The arena the store queues come from, with dtt_arena_bytes bytes left.
+ * @return SUCCESS, or FAILURE on every rank if any rank could not allocate its partition or the MPI library
+ * 		   cannot mix direct and one-sided access to the window (no unified memory model).
+ */
+int dtt_create(MPI_Aint bytes, int min_depth, Arena *arena)
+{
+	MPI_Info info;
+	MPI_Aint partition = TT_BUCKETSIZE * sizeof(TTEntry);
+	MPI_Aint offset;
+	void *base;
+	int *model;
+	int flag;
+	int ok;
+	int all_ok;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &dtt_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &dtt_size);
+	while (2 * partition <= bytes) // Equal power-of-two partitions address the same buckets on every rank
+	{
+		partition *= 2;
+	}
+
+	MPI_Info_create(&info);
+	MPI_Info_set(info, "accumulate_ops", "same_op_no_op");
+	MPI_Win_allocate(partition + 64, 1, info, MPI_COMM_WORLD, &base, &dtt_window); // 64 bytes to align to a cache line
+	MPI_Info_free(&info);
+
+	MPI_Win_get_attr(dtt_window, MPI_WIN_MODEL, &model, &flag);
+	dtt_offsets = (MPI_Aint *)arena_alloc(arena, dtt_size * sizeof(MPI_Aint));
+	dtt_queue = (TTEntry *)arena_alloc(arena, dtt_size * DTT_BATCH * sizeof(TTEntry));
+	dtt_queue_disp = (MPI_Aint *)arena_alloc(arena, dtt_size * DTT_BATCH * sizeof(MPI_Aint));
+	dtt_queued = (int *)arena_alloc(arena, dtt_size * sizeof(int));
+	ok = flag && *model == MPI_WIN_UNIFIED && dtt_offsets != NULL && dtt_queue != NULL && dtt_queue_disp != NULL &&
+		 dtt_queued != NULL && tt_attach(&dtt_local, base, partition + 64) == (size_t)partition;
+	MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+	if (!all_ok)
+	{
+		dtt_free();
+		return FAILURE;
+	}
+
+	offset = (char *)dtt_local.entries - (char *)base;
+	MPI_Allgather(&offset, 1, MPI_AINT, dtt_offsets, 1, MPI_AINT, MPI_COMM_WORLD);
+	tt_clear(&dtt_local);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, dtt_window);
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	remote_probe = dtt_probe;
+	remote_store = dtt_store;
+	remote_depth = min_depth;
+	return SUCCESS;
+}
+/**
+ * @brief Frees the table, collectively, and removes it from the search. Does nothing if there is none.
+ */
+void dtt_free()
+{
+	if (dtt_window == MPI_WIN_NULL)
+	{
+		return;
+	}
+	if (remote_probe == dtt_probe)
+	{
+		MPI_Win_unlock_all(dtt_window);
+	}
+	MPI_Win_free(&dtt_window);
+	dtt_offsets = NULL;
+	dtt_queue = NULL;
+	dtt_queue_disp = NULL;
+	dtt_queued = NULL;
+	remote_probe = NULL;
+	remote_store = NULL;
+}
+/**
+ * @brief The arena memory dtt_create takes for its store queues.
+ *
+ * @param ranks The number of ranks.
+ * @return The bytes, in whole arena blocks.
+ */
+size_t dtt_arena_bytes(int ranks)
+{
+	return arena_block_size(ranks * sizeof(MPI_Aint)) + arena_block_size(ranks * DTT_BATCH * sizeof(TTEntry)) +
+		   arena_block_size(ranks * DTT_BATCH * sizeof(MPI_Aint)) + arena_block_size(ranks * sizeof(int));
+}
+/**
+ * @brief Starts a new search: older entries become the first to be replaced and the statistics restart.
+ */
+void dtt_new_search()
+{
+	tt_new_search(&dtt_local);
+	dtt_stats.probes = 0;
+	dtt_stats.hits = 0;
+	dtt_stats.stores = 0;
+}
+/**
+ * @brief Sends every queued store and waits until they have reached their home ranks.
+ */
+void dtt_flush()
+{
+	for (int home = 0; home < dtt_size; home++)
+	{
+		dtt_send(home);
+	}
+	MPI_Win_flush_all(dtt_window);
+}
+/**
+ * @brief Looks a position up on its home rank.
+ *
+ * @param hash The Zobrist key of the position.
+ * @param player The player the scores are maximised for.
+ * @param data What the table knows, filled in on a hit.
+ * @return 1 on a hit, 0 otherwise.
+ */
+int dtt_probe(uint64_t hash, int player, TTData *data)
+{
+	TTEntry bucket[TT_BUCKETSIZE];
+	int home = dtt_home(hash);
+
+	if (home == dtt_rank)
+	{
+		return tt_probe(&dtt_local, hash, player, data);
+	}
+	MPI_Get(bucket, sizeof(bucket), MPI_BYTE, home, dtt_offsets[home] + (hash & dtt_local.mask) * sizeof(bucket),
+			sizeof(bucket), MPI_BYTE, dtt_window);
+	MPI_Win_flush(home, dtt_window);
+	dtt_stats.probes++;
+	for (int i = 0; i < TT_BUCKETSIZE; i++)
+	{
+		if (tt_read_entry(&bucket[i], hash, player, data))
+		{
+			dtt_stats.hits++;
+			return 1;
+		}
+	}
+	return 0;
+}
+/**
+ * @brief Stores a position on its home rank. A remote store cannot look at the bucket first, so it always
+ * 		  replaces the entry picked by bits 30-31 of the key.
+ *
+ * @param hash The Zobrist key of the position.
+ * @param player The player the score is maximised for.
+ * @param data The score, its bound, the depth searched and the best move.
+ */
+void dtt_store(uint64_t hash, int player, const TTData *data)
+{
+	int home = dtt_home(hash);
+
+	if (home == dtt_rank)
+	{
+		tt_store(&dtt_local, hash, player, data);
+		return;
+	}
+	int slot = home * DTT_BATCH + dtt_queued[home];
+	tt_make_entry(&dtt_queue[slot], hash, player, data, dtt_local.generation);
+	dtt_queue_disp[slot] = dtt_offsets[home] +
+						   ((hash & dtt_local.mask) * TT_BUCKETSIZE + (hash >> 30 & (TT_BUCKETSIZE - 1))) * sizeof(TTEntry);
+	dtt_stats.stores++;
+	if (++dtt_queued[home] == DTT_BATCH)
+	{
+		dtt_send(home);
+	}
+}
+/**
+ * @brief Sends the stores queued for a rank, each as one atomic replacement of the two words of an entry.
+ *
+ * @param home The rank.
+ */
+void dtt_send(int home)
+{
+	if (dtt_queued[home] == 0)
+	{
+		return;
+	}
+	for (int i = home * DTT_BATCH; i < home * DTT_BATCH + dtt_queued[home]; i++)
+	{
+		MPI_Accumulate(&dtt_queue[i], 2, MPI_UINT64_T, home, dtt_queue_disp[i], 2, MPI_UINT64_T, MPI_REPLACE,
+					   dtt_window);
+	}
+	MPI_Win_flush_local(home, dtt_window); // The queue may be reused once the data has left
+	dtt_queued[home] = 0;
+}
+/**
+ * @brief The rank a position lives on, chosen by the upper half of its key so that it is independent of the
+ * 		  bucket, which uses the low bits.
+ */
+int dtt_home(uint64_t hash)
+{
+	return (int)((hash >> 32) % dtt_size);
+}
@@ -0,0 +1,31 @@
+#ifndef _DTT_H
+#define _DTT_H
+
+#include <stdint.h>
+#include <mpi.h>
+#include "arena.h"
+#include "tt.h"
+
+#define DTT_BATCH 32 // stores queued per home rank before they are sent
+
+/**
+ * Traffic of the distributed table since the last dtt_new_search.
+ */
+typedef struct
+{
+	long long probes;		 // probes of positions homed on another rank
+	long long hits;			 // of those, probes that found the position
+	long long stores;		 // stores of positions homed on another rank
+} DTTStats;
+
+extern DTTStats dtt_stats;
+
+int dtt_create(MPI_Aint bytes, int min_depth, Arena *arena);
+size_t dtt_arena_bytes(int ranks);
+void dtt_free();
+void dtt_new_search();
+void dtt_flush();
+int dtt_probe(uint64_t hash, int player, TTData *data);
+void dtt_store(uint64_t hash, int player, const TTData *data);
+
+#endif
@@ -31,61 +31,414 @@
  *        	- Write a method to make this easier
  *        In a multiprocessor version
  *        	- each process should write debug info to its own file
+ *
+ *    The game state is a Position (board.h). Positions are small enough to be
+ *    copied for every move searched and are broadcast with their own MPI
+ *    datatype. The board, evaluation and search code lives in libothello,
+ *    which is shared with the baseline players in src_random_player.
+ *
+ *    Options may follow the referee arguments:
+ *        --engine <name>    "alphabeta" (default) for the distributed MiniMax
+ *                           search, or "mcts" for Monte Carlo Tree Search
+ *        --depth <n>        deepest iteration per root move (default 6); the
+ *                           search also stops when the move time is spent
+ *        --time <s>         seconds to think per move (default 0.75 of the
+ *                           referee's time limit, no limit in analysis)
+ *        --deterministic    search a fixed node budget instead of to a fixed
+ *                           depth, so that the same position and rank count
+ *                           always give the same move and node count
+ *        --nodes <n>        node budget per worker in deterministic mode
+ *                           (playouts in MCTS)
+ *        --seed <n>         seed for the random number generator
+ *        --mcts-nodes <n>   nodes in the MCTS node pool (default 1048576)
+ *        --mcts-c <x>       MCTS exploration constant (default 1.4)
+ *        --puct             PUCT selection with square-weight priors instead
+ *                           of UCT
+ *        --mcts-sync <n>    playouts each rank runs between merges of the
+ *                           root statistics (default 1024)
+ *        --mcts-share <n>   also share the statistics of the top n tree
+ *                           levels (0, 1 or 2) between ranks at every merge
+ *        --tt-mb <n>        megabytes of transposition table per node
+ *                           (default 64, 0 for none)
+ *        --tt-mode <mode>   "node" (default) for one table per node, or
+ *                           "distributed" to add a table partitioned over
+ *                           all ranks for the nodes near the root
+ *        --tt-remote-depth <n>  shallowest remaining depth that uses the
+ *                           distributed table (default 4)
+ *        --poll-nodes <n>   nodes a worker searches between checks for
+ *                           messages from the master (default 4096)
+ *        --rank-stats       print, at the end, the seconds each rank spent
+ *                           searching, communicating and idle, and its nodes
+ *                           (Alpha/Beta only; run_scaling.py reads them)
+ *        --solve-empties <n>  solve positions with at most n empty squares
+ *                           exactly (default 16, 0 for never)
+ *        --wld-empties <n>  prove a win, loss or draw with at most n empty
+ *                           squares (default 20, 0 for never)
+ *        --memory <mb>      megabytes each rank may use, or the "memory"
+ *                           setting of Othello.json in the working directory;
+ *                           sizes the tables or the MCTS node pool to fit,
+ *                           overriding --tt-mb and --mcts-nodes
+ *        --huge-pages       back the arenas, and ask for the table window to
+ *                           be backed, with huge pages
+ *        --net <file>       evaluate with the network in the file (net.h),
+ *                           as trained by tools/bin/nettrain, instead of the
+ *                           square weights
+ *        --hierarchy        hand the root moves out in two levels, through one
+ *                           coordinator rank per node (Alpha/Beta only)
+ *        --trace <file>     record where the time of every turn goes on each
+ *                           rank and write it to the file at the end, in the
+ *                           Chrome trace-event format
+ *        --board-size <n>   squares per side of the referee's board, or the
+ *                           "boardSize" setting of Othello.json; 8 (default)
+ *                           for the bitboard engine, any other even size from
+ *                           4 to 16 for the mailbox board (mailbox.h)
+ *
+ *    MCTS is root-parallel: every rank grows its own tree from the same
+ *    position, and the master sums the root statistics with MPI_Reduce.
+ *
+ *    The Alpha/Beta search uses one transposition table per node: the ranks
+ *    of a node share it through an MPI-3 shared-memory window and read and
+ *    write it without locks. In deterministic mode every rank keeps its own
+ *    part of the window instead, so that results do not depend on timing.
+ *    In distributed mode the nodes near the root are also looked up in a
+ *    table spread over every rank (dtt.h), which shares the results of the
+ *    most expensive subtrees between nodes. It also takes --tt-mb
+ *    megabytes per node, and is off in deterministic mode.
+ *
+ *    Workers deepen iteratively and check for control messages from the
+ *    master every --poll-nodes nodes with MPI_Iprobe. The master stops all
+ *    searches when the move time is up, and workers then return the best
+ *    move found so far. When a worker finishes early the master passes its
+ *    score on as a bound, which the others use to cut their own moves.
+ *    Every message names the search it belongs to, so late messages from an
+ *    earlier move are ignored. Deterministic mode uses neither.
+ *
+ *    Near the end of the game the Alpha/Beta engine first tries to solve the
+ *    position (solve.h) in half the move time, exactly or, a little earlier,
+ *    only as a win, loss or draw. The master walks the root moves itself and
+ *    splits the tree one level further down: the eldest child of each root
+ *    move is solved by one worker, and once it is back its younger brothers
+ *    go to every idle worker with the window it left. A cutoff aborts the
+ *    brothers still being solved. The workers share the node table, and
+ *    the solver looks every child up before searching any near the root.
+ *    A proven loss, or a solve that runs out of time, falls back to the
+ *    Alpha/Beta search for the rest of the move time.
+ *
+ *    Started as "my_player --bench <file> [options]" the player searches every
+ *    position in the file (see bench/positions.txt) on rank 0 without a
+ *    referee and reports nodes and time; the release-pgo build uses this to
+ *    collect its profile. In MCTS bench runs --nodes is the playouts per
+ *    position.
+ *
+ *    Started as "my_player --analyse <file|-> [options]" the player searches
+ *    every position of the file, or of standard input, on all ranks as it
+ *    would in a game and prints one line per position to standard output:
+ *        <position> move <m> score <s> depth <d> nodes <n> time <t> pv <moves>
+ *    A solved position has "solved exact" or "solved wld" before the pv; its
+ *    score is then the final disc difference, or 1, 0 and -1 for a win, draw
+ *    and loss, and its depth the empty squares. MCTS reports the win rate of its move in thousandths as the score and
+ *    searches --nodes playouts per rank unless --time is given.
+ *
+ *    With a single rank the master searches all moves itself.
+ *
+ *    With --hierarchy the Alpha/Beta search is handed out in two levels.
+ *    The ranks are grouped by node with MPI_Comm_split_type, and the first
+ *    rank of every node other than the master's is its coordinator. The
+ *    master splits the root moves between the ranks of its own node and
+ *    the coordinators, in proportion to the ranks searching behind each.
+ *    A coordinator splits its share again between the other ranks of its
+ *    node, passes the master's bounds and aborts on to them, passes a
+ *    finished rank's score on to the rest of its node as a bound, and sends
+ *    the master one result for the node: the best one, with the nodes of
+ *    all of them. A coordinator alone on its node searches its share itself.
+ *    The endgame solver and MCTS still talk to every rank directly.
+ *
+ *    On a board other than 8x8 the game is kept as a MailboxPosition and all
+ *    ranks search it with mailbox_minimax: each deepening iteration deals the
+ *    root moves out round-robin, and the ranks agree on its best move with
+ *    MPI_Allreduce. An iteration that any rank could not finish in the move
+ *    time is dropped. These boards have no table, MCTS, network or endgame
+ *    split, and the analysis and server modes stay 8x8. The bench solves
+ *    any line holding a board of another size exactly. Moves on boards
+ *    larger than 10x10 have two digits per coordinate, e.g. "0311".
+ *
+ *    Every rank reserves its memory at start-up: one arena (arena.h) holds
+ *    the MCTS node pools, the distributed table's queues, the buffers for
+ *    results and statistics and the game logs' stdio buffers, and the node
+ *    table lives in its MPI window. Nothing is allocated while a game is
+ *    played. Under a --memory budget, BASERESERVE is set aside for the
+ *    program, MPI and the stacks, the arena takes what it needs and the
+ *    rest goes to the table (half to each table in distributed mode), or
+ *    to the MCTS node pools. Each rank's node table share is the window
+ *    divided among the ranks of its node. With a budget the master prints,
+ *    at the end, what each rank reserved, its private resident memory and
+ *    its peak resident size, which counts every table page the rank touched
+ *    although the node holds them once:
+ *        # memory rank <r> arena <used>/<size> table <b> remote <b> private <b> peak <b> budget <b>
+ *    A rank whose private memory and table shares, or whose peak, exceed
+ *    the budget is marked "exceeded". The peak is what the system charges
+ *    the process, so a rank that touched more of the node table than its
+ *    share is marked even when the node as a whole stays within budget.
+ *
+ *    With --trace every rank records spans (trace.h) on its monotonic clock,
+ *    aligned at start-up with the master's by timing round trips to it. The
+ *    master records each turn from the gen_move to the move sent, split
+ *    into comms_get_cmd before it, the broadcasts, gen_move_master,
+ *    print_board and comms_send_move. Within a move it records the endgame
+ *    solve, handing the root moves out and waiting for the results. The
+ *    workers record the broadcasts, receiving work, their
+ *    search, solve jobs and sending results, and coordinators record their
+ *    part. The file opens in chrome://tracing or Perfetto with one row per
+ *    rank; each span names its turn, or the search id on the workers.
+ *
+ *    The release-perf build (make release-perf) counts cycles, instructions,
+ *    branch misses and L1 and last-level cache misses on every rank, per
+ *    phase of the search: move generation, making moves, evaluation, table
+ *    lookups and MPI, and game_over prints a summary per rank (perf.h).
+ *
+ *    Started as "my_player --serve <port> <time_limit> <log_prefix> <games>
+ *    [options]" one process group plays many games at once: referees connect
+ *    to the port and speak the usual protocol, colour first. The master
+ *    multiplexes the connections with poll(), keeps the position of every
+ *    game and logs each to <log_prefix>.<n>. All ranks search one move at a
+ *    time; waiting moves are served earliest deadline first, each with an
+ *    equal share of the time its referee has left for the waiting moves.
+ *    The server stops after <games> games, or never for 0.
  *H***********************************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <arpa/inet.h>
 #include <limits.h>
-#include </opt/homebrew/Cellar/open-mpi/4.1.5/include/mpi.h>
+#include <mpi.h>
 #include <time.h>
 #include <assert.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
 #include "comms.h"
+#include "othello.h"
+#include "dtt.h"
+#include "trace.h"
 
-const int EMPTY = 0;
-const int BLACK = 1;
-const int WHITE = 2;
 const int ROOT = 0;
-const int OUTER = 3;
-const int ALLDIRECTIONS[8] = {-11, -10, -9, -1, 1, 9, 10, 11};
-const int BOARDSIZE = 100;
-const int LEGALMOVSBUFSIZE = 65;
-const char piecenames[4] = {'.', 'b', 'w', '?'};
+const int ALPHABETA_ENGINE = 0;
+const int MCTS_ENGINE = 1;
+const int NODE_TABLE = 0;
+const int DISTRIBUTED_TABLE = 1;
+const double MOVETIMEFRACTION = 0.75; // share of the referee's time limit spent thinking
+const int WORK_TAG = 1;	   // root moves sent to a worker
+const int RESULT_TAG = 2;   // SearchResult sent back
+const int CONTROL_TAG = 3;  // control message from the master to a searching worker
+const int ABORT_SEARCH = 0; // control message: stop and report
+const int NEW_BOUND = 1;	   // control message: another worker's score
+const int ABORT_JOB = 2;	   // control message: stop solving one endgame position
+const int SOLVE_TAG = 4;	   // SolveJob sent to a worker
+const int SOLVED_TAG = 5;   // SolveReply sent back
+const int SOLVE_DONE = -1;  // job number that ends the solver's part of a move
+const int SOLVED_EXACT = 1; // SearchResult.solved: the exact disc difference
+const int SOLVED_WLD = 2;   // SearchResult.solved: only a win, draw or loss
+const int SPLITEMPTIES = 12; // fewest empties of a position whose children the solver hands to the workers
+const double SOLVETIMEFRACTION = 0.5; // share of the move time the endgame solver may use
+const long long BASERESERVE = 32LL << 20; // bytes of a --memory budget left for the program, MPI and the stacks
+const long POLLPAUSENS = 200000; // nanoseconds the master sleeps between checks for results
+const double MINMOVETIME = 0.01; // seconds a move in server mode is searched at least
+
+#define BENCHLINEBUFSIZE 512 // a 16x16 board and the side to move
+#define PVBUFSIZE 32	 // moves of the principal variation reported
+#define MAXGAMES 64		 // games a server plays at once
+#define LOGPATHBUFSIZE 4096
+#define WORKMSGSIZE 2	 // search id, number of moves
+#define CONTROLMSGSIZE 4 // type, search id, depth, score
+#define LOGBUFSIZE 65536 // bytes of stdio buffer per game log
+#define MEMSTATSIZE 7	 // doubles in a rank's memory report
+
+/**
+ * Search settings chosen on the master and broadcast to every rank.
+ */
+typedef struct
+{
+	int engine;				 // ALPHABETA_ENGINE or MCTS_ENGINE
+	double move_time;		 // seconds to think per move, 0 for no limit
+	int depth;				 // search depth per root move
+	int deterministic;		 // 1 to search a node budget with iterative deepening
+	long long node_budget;	 // nodes each worker may search per move in deterministic mode
+	unsigned long long seed; // seed for the random number generator
+	int mcts_nodes;			 // nodes in each MCTS node pool
+	double mcts_exploration; // MCTS exploration constant
+	int mcts_puct;			 // 1 for PUCT selection, 0 for UCT
+	int mcts_sync;			 // playouts per rank between merges
+	int mcts_share;			 // tree levels whose statistics are shared between ranks
+	int tt_mb;				 // megabytes of transposition table per node, 0 for none
+	int tt_mode;			 // NODE_TABLE or DISTRIBUTED_TABLE
+	int tt_remote_depth;	 // shallowest remaining depth using the distributed table
+	int poll_nodes;			 // nodes between checks for control messages
+	int rank_stats;			 // 1 to report the time breakdown of every rank at the end
+	int solve_empties;		 // most empties solved exactly, 0 for none
+	int wld_empties;		 // most empties solved as a win, loss or draw, 0 for none
+	int memory_mb;			 // megabytes each rank may use, 0 for no budget
+	int huge_pages;			 // 1 to back the arenas and the table with huge pages
+	long long table_bytes;	 // bytes of each table per rank under a budget, 0 to size them by tt_mb
+	int use_net;			 // 1 to evaluate with the network read by --net
+	int board_size;			 // squares per side, BOARDSIDE for the bitboard; 0 until the referee's is known
+	int hierarchy;			 // 1 to hand root moves out through one coordinator per node
+	int trace;				 // 1 to record spans for --trace
+} SearchConfig;
+
+/**
+ * The outcome of searching a set of root moves, sent from a worker to the master.
+ */
+typedef struct
+{
+	int move;		 // best move, -1 if there was none
+	int score;		 // score of the best move
+	int depth;		 // deepest completed iteration
+	int bounded;	 // 1 if every move failed low against another worker's bound in that iteration
+	long long nodes; // nodes searched
+	DTTStats table;	 // distributed table traffic
+	int pv_length;	 // moves in pv
+	int pv[PVBUFSIZE]; // principal variation from the best move on, -1 for a pass
+	int solved;		 // SOLVED_EXACT or SOLVED_WLD if the endgame solver found the move, 0 otherwise
+} SearchResult;
+
+/**
+ * A position one level below a root move, sent from the master to a worker to solve.
+ */
+typedef struct
+{
+	int search_id;	   // the solve it belongs to
+	int job;		   // number of the job, SOLVE_DONE when the solve is over
+	int alpha;		   // window to solve it with
+	int beta;
+	Position position; // the position, with the child's side to move
+} SolveJob;
+
+/**
+ * A worker's answer to a SolveJob.
+ */
+typedef struct
+{
+	int job;		 // number of the job
+	int score;		 // the result, for the side to move in the job's position
+	int aborted;	 // 1 if the master stopped the job and score means nothing
+	long long nodes; // nodes searched
+} SolveReply;
+
+/**
+ * Where a rank's time went, for scaling measurements. Communication is time spent in MPI calls that move work,
+ * results and control messages; idle is time spent waiting for the next piece of work or for results.
+ */
+typedef struct
+{
+	double search;	 // seconds searching
+	double comm;	 // seconds sending and receiving
+	double idle;	 // seconds waiting
+	double nodes;	 // nodes searched
+} RankStats;
+
+#define RANKSTATSIZE 4 // doubles in a RankStats
+
+/**
+ * A game played in server mode.
+ */
+typedef struct
+{
+	int fd;			   // connection to the referee, -1 for a free slot
+	int colour;		   // our colour, EMPTY until the referee has sent it
+	int number;		   // games accepted before this one
+	int waiting;	   // 1 while a gen_move is unanswered
+	double deadline;   // MPI_Wtime by which the move should be sent
+	Position position; // the game so far
+	FILE *fp;		   // log of the game
+	char *log_buffer;  // stdio buffer of the log, LOGBUFSIZE bytes from the arena
+} Game;
 
 void run_master(int argc, char *argv[]);
-int initialise_master(int argc, char *argv[], int *time_limit, int *my_colour, FILE **fp);
-void apply_opp_move(char *move, int my_colour, FILE *fp, int *active_board);
+int initialise_master(int argc, char *argv[], int *time_limit, int *my_colour, FILE **fp, SearchConfig *config);
+int parse_options(int argc, char *argv[], SearchConfig *config);
+int choose_board_size(SearchConfig *config);
+void default_config(SearchConfig *config);
+void apply_opp_move(char *move, int my_colour, FILE *fp, Position *pos);
 void game_over();
-void initialise_board();
-void free_board();
+void position_type_create(MPI_Datatype *type);
 void run_worker(int rank);
-void gen_move_master(char *move, int my_colour, FILE *fp, int *active_board);
-void legal_moves(int player, int *moves, FILE *fp, int *active_board);
-int legalp(int move, int player, FILE *fp, int *active_board);
-int validp(int move);
-int would_flip(int move, int dir, int player, FILE *fp, int *active_board);
-int opponent(int player, FILE *fp);
-int find_bracket_piece(int square, int dir, int player, FILE *fp, int *active_board);
+void search_root(const Position *pos, int *moves, int amount_of_moves, int player, SearchResult *result);
+void gen_move_master(char *move, int my_colour, FILE *fp, Position *pos);
+void gen_move_mailbox(char *move, FILE *fp, MailboxPosition *pos);
+void apply_opp_mailbox_move(char *move, FILE *fp, MailboxPosition *pos);
+int mailbox_strategy(FILE *fp);
 int bens_strategy(int my_colour, FILE *fp);
-void make_move(int move, int player, FILE *fp, int *active_board);
-void make_flips(int move, int dir, int player, FILE *fp, int *active_board);
-int get_loc(char *movestring);
-void get_move_string(int loc, char *ms);
-void print_board(FILE *fp);
-char nameof(int piece);
-int count(int player, int *board);
-int evaluate(int player, int *board);
-int minimax(int *board, int player, int depth, int rank, int alpha, int beta);
-int max(int value1, int value2);
-int min(int value1, int value2);
-void process_moves(int *moves, int amount_of_moves, int *array);
+void search_move(const Position *pos, SearchResult *best, FILE *fp);
+int distribute_search(const Position *pos, SearchResult *results, FILE *fp);
+void coordinate_search(const int *moves, int count, SearchResult *result);
+void hand_out_work(const int *moves, int count, const int *weights);
+int solve_endgame(const Position *pos, SearchResult *result, FILE *fp);
+int solve_split(const Position *pos, int alpha, int beta, double deadline, long long *nodes);
+int solve_local(const Position *pos, int alpha, int beta, double deadline, long long *nodes);
+void abort_jobs(const int *jobs);
+int serve_solve_jobs(double *wait);
+const SearchResult *best_result(const SearchResult *results, int count);
+int mcts_strategy(FILE *fp, SearchResult *result);
+int initialise_engine(int rank, FILE *fp);
+void initialise_table(FILE *fp);
+void initialise_hierarchy(FILE *fp);
+int plan_memory(int server);
+size_t arena_bytes(int master, int server, int with_pool);
+void initialise_memory(int rank, int server);
+void report_memory(void);
+long long status_bytes(const char *field);
+void share_statistics(double *base_visits, double *base_wins);
+int run_bench(int argc, char *argv[]);
+long long bench_mailbox(const MailboxPosition *pos, int number);
+int run_analysis(int argc, char *argv[]);
+int run_server(int argc, char *argv[]);
+int serve_referee(Game *game, const char *log_prefix, double move_time);
+int serve_move(Game *game, int waiting);
+void close_game(Game *game);
+void print_result(FILE *out, const Position *pos, const SearchResult *result, double elapsed);
+void poll_control(void);
+void poll_clock(void);
+void report_rank_stats(void);
+void report_perf_counters(void);
+void print_perf_row(int rank, const char *name, uint64_t calls, const uint64_t *events);
+void send_control(int type, int depth, int score, const int *finished);
 void writeToFile(char *filename, char *text);
-int is_game_over_move(int *board);
-int has_legal_moves(int *board, int player);
 
-int *current_board; // gameboard
-int MPI_SIZE;		// amount of processors
+Position current_position; // gameboard
+MailboxPosition current_mailbox; // gameboard when it is not 8x8
+SearchConfig config;	   // search settings, identical on every rank
+uint64_t rng_state;		   // random number generator state, seeded from config.seed
+MPI_Datatype position_type;	// MPI datatype describing a Position
+MCTSTree tree;				// MCTS tree, kept between moves
+TranspositionTable table;	// transposition table of the Alpha/Beta search
+Network network;			// evaluation network of --net, read on the master and broadcast
+MPI_Comm node_comm = MPI_COMM_NULL; // the ranks sharing this rank's memory
+MPI_Win table_window = MPI_WIN_NULL; // shared-memory window holding the table
+Arena arena;				// this rank's memory, reserved at start-up
+Arena bench_table;			// private table memory in bench mode
+size_t table_share;			// bytes of the node table this rank accounts for
+size_t remote_share;		// bytes of this rank's distributed table partition
+SearchResult *worker_results; // one result per worker, from the arena
+int *worker_flags;			// per rank, 1 once it has reported a search
+int *worker_jobs;			// per rank, the endgame job it is solving, 0 when idle
+int *worker_children;		// per rank, the child of that job
+int *worker_weights;		// per rank, its share of the root moves this rank hands out with --hierarchy, 0 for none
+int node_workers;			// ranks a coordinator hands root moves on to, 0 on every other rank
+int work_source;			// the rank root moves and search control messages come from: ROOT, or the coordinator
+double *share_buffer;		// MCTS statistics: the base, then this rank's and every rank's additions
+void *gather_buffer;		// every rank's statistics on the master, for the reports at the end
+char *log_buffers;			// stdio buffers of the game logs on the master
+int MPI_SIZE;				// amount of processors
+int search_id;				// number of the current search, on every rank
+int bound_depth;			// iteration depth of search_bound, 0 if there is none
+int search_bound;			// best score another worker has finished with, from NEW_BOUND
+int solve_job;				// number of the endgame position this worker is solving
+int last_job;				// number of the last endgame position the master handed out
+double search_deadline;		// MPI_Wtime at which a search on the master alone stops
+char trace_path[LOGPATHBUFSIZE]; // file of --trace, on the master
+RankStats rank_stats;		// time breakdown of this rank
 char bufferp[100];	// This defines a character array with a size of 100 that can hold the path of the file to write to.
 char bufferm[100];	// This defines a character array with a size of 100 that can hold the text to write to the file.
 
@@ -106,9 +459,30 @@ int main(int argc, char *argv[])
 	MPI_Comm_rank(MPI_COMM_WORLD, &rank); // ID of prosses
 	MPI_SIZE = size;
 
-	initialise_board();  // initilises the starting gameboard
+	position_type_create(&position_type);
+	initialise_zobrist();
+	initialise_stability();
+	initialise_position(&current_position);  // initilises the starting gameboard
+#ifdef PERF_COUNTERS
+	perf_open(); // Counters of this rank, summarised by game_over
+#endif
 
-	if (rank == 0)
+	if (argc >= 3 && strcmp(argv[1], "--bench") == 0) // Serial benchmark, the other ranks only wait
+	{
+		if (rank == 0)
+		{
+			run_bench(argc, argv);
+		}
+	}
+	else if (argc >= 3 && strcmp(argv[1], "--analyse") == 0 && rank == 0)
+	{
+		run_analysis(argc, argv);
+	}
+	else if (argc >= 2 && strcmp(argv[1], "--serve") == 0 && rank == 0)
+	{
+		run_server(argc, argv);
+	}
+	else if (rank == 0)
 	{
 		run_master(argc, argv);
 	}
@@ -117,6 +491,21 @@ int main(int argc, char *argv[])
 		run_worker(rank);
 	}
 
+	MPI_Bcast(&config.rank_stats, 1, MPI_INT, 0, MPI_COMM_WORLD); // The bench leaves the workers' settings unset
+	MPI_Bcast(&config.memory_mb, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	MPI_Bcast(&config.trace, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	if (config.rank_stats)
+	{
+		report_rank_stats();
+	}
+	if (config.memory_mb > 0)
+	{
+		report_memory();
+	}
+	if (config.trace)
+	{
+		trace_write(trace_path);
+	}
 	MPI_Barrier(MPI_COMM_WORLD); // Waits for all ranks before finalisation
 	game_over();
 }
@@ -127,30 +516,56 @@ int main(int argc, char *argv[])
  * @param argc The number of command-line arguments.
  * @param argv An array of strings containing the command-line arguments.
  */
-void run_master(int argc, char *argv[]) 
+void run_master(int argc, char *argv[])
 {
 	char cmd[CMDBUFSIZE];			 // command buffer
 	char my_move[MOVEBUFSIZE];		 // move buffer
 	char opponent_move[MOVEBUFSIZE]; // opponents move buffer
 	int time_limit;
-	int my_colour;	 				 // current player
+	int my_colour = EMPTY;	 		 // current player
 	int running = 0; 				 // state of game
-	FILE *fp = NULL; 		
+	int turn = 0;					 // gen_move commands so far
+	FILE *fp = NULL;
 
-	if (initialise_master(argc, argv, &time_limit, &my_colour, &fp) != FAILURE) // Initalises Ref functions and Comms
+	default_config(&config);
+	if (initialise_master(argc, argv, &time_limit, &my_colour, &fp, &config) != FAILURE) // Initalises Ref functions and Comms
 	{
 		running = 1;
 	}
 	if (my_colour == EMPTY)
 	{
-		my_colour = BLACK; 
+		my_colour = BLACK;
 	}
 
-	MPI_Bcast(&my_colour, 1, MPI_INT, 0, MPI_COMM_WORLD); // Broadcast my_colour
+	MPI_Bcast(&config, sizeof(SearchConfig), MPI_BYTE, 0, MPI_COMM_WORLD); // Broadcast search settings
+	rng_state = config.seed;
+	initialise_memory(ROOT, 0); // Already done unless the options were unusable
+	initialise_engine(ROOT, fp);
+	initialise_table(fp);
+	initialise_hierarchy(fp);
+	if (config.trace)
+	{
+		trace_open(&arena);
+	}
+	if (config.board_size != BOARDSIDE)
+	{
+		mailbox_initialise(&current_mailbox, config.board_size); // Fails harmlessly when the options did
+	}
+	if (fp != NULL)
+	{
+		const char *pages = (arena.pages == ARENA_HUGETLB)	   ? "huge"
+							: (arena.pages == ARENA_TRANSPARENT) ? "transparent huge"
+																 : "small";
+		fprintf(fp, "Memory: %.1f of %.1f MB of arena used (%s pages), %.1f MB of tables per rank",
+				arena.used / 1048576.0, arena.size / 1048576.0, pages, (table_share + remote_share) / 1048576.0);
+		fprintf(fp, (config.memory_mb > 0) ? ", budget %d MB per rank\n" : "\n", config.memory_mb);
+		fflush(fp);
+	}
 
 	while (running == 1)
 	{
 		/* Receive next command from referee */
+		double wait = trace_now();
 		if (comms_get_cmd(cmd, opponent_move) == FAILURE)
 		{
 			fprintf(fp, "Error getting cmd\n");
@@ -158,6 +573,8 @@ void run_master(int argc, char *argv[])
 			running = 0;
 			break;
 		}
+		trace_span(TRACE_GET_CMD, turn + 1, wait); // The wait before the next turn
+		double received = trace_now();
 
 		/* Received game_over message */
 		if (strcmp(cmd, "game_over") == 0)
@@ -168,14 +585,58 @@ void run_master(int argc, char *argv[])
 			break;
 		}
 		/* Received gen_move message */
+		else if (strcmp(cmd, "gen_move") == 0 && config.board_size != BOARDSIDE)
+		{
+			turn++;
+			if (current_mailbox.to_move != my_colour) // The opponent passed without telling us
+			{
+				mailbox_make_pass(&current_mailbox);
+			}
+
+			double start = trace_now();
+			MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD); // Broadcast running
+			MPI_Bcast(&current_mailbox, sizeof(MailboxPosition), MPI_BYTE, 0, MPI_COMM_WORLD);
+			trace_span(TRACE_BCAST, turn, start);
+
+			start = trace_now();
+			gen_move_mailbox(my_move, fp, &current_mailbox);
+			trace_span(TRACE_GEN_MOVE, turn, start);
+			start = trace_now();
+			mailbox_print(fp, &current_mailbox);
+			trace_span(TRACE_PRINT, turn, start);
+
+			start = trace_now();
+			if (comms_send_move(my_move) == FAILURE)
+			{
+				running = 0;
+				fprintf(fp, "Move send failed\n");
+				fflush(fp);
+				break;
+			}
+			trace_span(TRACE_SEND_MOVE, turn, start);
+			trace_span(TRACE_TURN, turn, received);
+		}
 		else if (strcmp(cmd, "gen_move") == 0)
 		{
+			turn++;
+			if (current_position.to_move != my_colour) // The opponent passed without telling us
+			{
+				make_pass(&current_position);
+			}
+
+			double start = trace_now();
 			MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD);				 // Broadcast running
-			MPI_Bcast(current_board, BOARDSIZE, MPI_INT, 0, MPI_COMM_WORLD); // Broadcast board
+			MPI_Bcast(&current_position, 1, position_type, 0, MPI_COMM_WORLD); // Broadcast position
+			trace_span(TRACE_BCAST, turn, start);
 
-			gen_move_master(my_move, my_colour, fp, current_board); 		 // Generates a move for my_player
-			print_board(fp);
+			start = trace_now();
+			gen_move_master(my_move, my_colour, fp, &current_position); 	 // Generates a move for my_player
+			trace_span(TRACE_GEN_MOVE, turn, start);
+			start = trace_now();
+			print_board(fp, &current_position);
+			trace_span(TRACE_PRINT, turn, start);
 
+			start = trace_now();
 			if (comms_send_move(my_move) == FAILURE)
 			{
 				running = 0;
@@ -183,12 +644,19 @@ void run_master(int argc, char *argv[])
 				fflush(fp);
 				break;
 			}
+			trace_span(TRACE_SEND_MOVE, turn, start);
+			trace_span(TRACE_TURN, turn, received);
 		}
 		/* Received opponent's move (play_move mesage) */
+		else if (strcmp(cmd, "play_move") == 0 && config.board_size != BOARDSIDE)
+		{
+			apply_opp_mailbox_move(opponent_move, fp, &current_mailbox);
+			mailbox_print(fp, &current_mailbox);
+		}
 		else if (strcmp(cmd, "play_move") == 0)
 		{
-			apply_opp_move(opponent_move, my_colour, fp, current_board);
-			print_board(fp);
+			apply_opp_move(opponent_move, my_colour, fp, &current_position);
+			print_board(fp, &current_position);
 		}
 		/* Received unknown message */
 		else
@@ -206,21 +674,29 @@ void run_master(int argc, char *argv[])
  * @param time_limit The time limit for the game.
  * @param my_colour Pointer to the player's color.
  * @param fp Pointer to the file pointer for logging.
+ * @param config The search settings, updated from any options after the referee arguments.
  * @return int The result of initialization (SUCCESS or FAILURE).
  */
-int initialise_master(int argc, char *argv[], int *time_limit, int *my_colour, FILE **fp)
+int initialise_master(int argc, char *argv[], int *time_limit, int *my_colour, FILE **fp, SearchConfig *config)
 {
 	int result = FAILURE;
 
-	if (argc == 5)
+	if (argc >= 5 && parse_options(argc - 5, argv + 5, config) != FAILURE && choose_board_size(config) != FAILURE &&
+		plan_memory(0) != FAILURE)
 	{
 		unsigned long ip = inet_addr(argv[1]);
 		int port = atoi(argv[2]);
 		*time_limit = atoi(argv[3]);
+		if (config->move_time == 0)
+		{
+			config->move_time = MOVETIMEFRACTION * *time_limit;
+		}
 
+		initialise_memory(ROOT, 0);
 		*fp = fopen(argv[4], "w");
 		if (*fp != NULL)
 		{
+			setvbuf(*fp, log_buffers, _IOFBF, LOGBUFSIZE);
 			fprintf(*fp, "Initialise communication and get player colour \n");
 			if (comms_init_network(my_colour, ip, port) != FAILURE)
 			{
@@ -235,47 +711,271 @@ int initialise_master(int argc, char *argv[], int *time_limit, int *my_colour, F
 	}
 	else
 	{
-		fprintf(*fp, "Arguments: <ip> <port> <time_limit> <filename> \n");
+		fprintf(stderr, "Arguments: <ip> <port> <time_limit> <filename> [--engine alphabeta|mcts] [--depth <n>] "
+						"[--time <s>] [--deterministic] [--nodes <n>] [--seed <n>] [--mcts-nodes <n>] [--mcts-c <x>] [--puct] "
+						"[--mcts-sync <n>] [--mcts-share <n>] [--tt-mb <n>] [--tt-mode node|distributed] "
+						"[--tt-remote-depth <n>] [--poll-nodes <n>] [--rank-stats] [--solve-empties <n>] "
+						"[--wld-empties <n>] [--memory <mb>] [--huge-pages] [--net <file>] [--board-size <n>] [--hierarchy] [--trace <file>]\n");
 	}
 
 	return result;
 }
 /**
- * @brief Initilizes the Gameboard
+ * @brief Sets the search settings used when no options are given.
+ *
+ * @param config The settings to fill in.
+ */
+void default_config(SearchConfig *config)
+{
+	config->engine = ALPHABETA_ENGINE;
+	config->move_time = 0;
+	config->depth = 6;
+	config->deterministic = 0;
+	config->node_budget = 1000000;
+	config->seed = (unsigned long long)time(NULL);
+	config->mcts_nodes = 1 << 20;
+	config->mcts_exploration = 1.4;
+	config->mcts_puct = 0;
+	config->mcts_sync = 1024;
+	config->mcts_share = 0;
+	config->tt_mb = 64;
+	config->tt_mode = NODE_TABLE;
+	config->tt_remote_depth = 4;
+	config->poll_nodes = 4096;
+	config->rank_stats = 0;
+	config->solve_empties = 16;
+	config->wld_empties = 20;
+	config->memory_mb = 0;
+	config->huge_pages = 0;
+	config->table_bytes = 0;
+	config->use_net = 0;
+	config->board_size = 0;
+	config->hierarchy = 0;
+	config->trace = 0;
+}
+/**
+ * @brief Reads the options that follow the referee arguments.
  *
+ * @param argc The number of options.
+ * @param argv The options.
+ * @param config The settings to update.
+ * @return SUCCESS, or FAILURE on an unknown or incomplete option.
  */
-void initialise_board()
+int parse_options(int argc, char *argv[], SearchConfig *config)
 {
-	int i;
-	current_board = (int *)malloc(BOARDSIZE * sizeof(int));
-	for (i = 0; i <= 9; i++)
-		current_board[i] = OUTER;
-	for (i = 10; i <= 89; i++)
+	int seed_given = 0;
+	for (int i = 0; i < argc; i++)
 	{
-		if (i % 10 >= 1 && i % 10 <= 8)
-			current_board[i] = EMPTY;
+		if (strcmp(argv[i], "--deterministic") == 0)
+		{
+			config->deterministic = 1;
+		}
+		else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc)
+		{
+			i++;
+			if (strcmp(argv[i], "alphabeta") == 0)
+				config->engine = ALPHABETA_ENGINE;
+			else if (strcmp(argv[i], "mcts") == 0)
+				config->engine = MCTS_ENGINE;
+			else
+				return FAILURE;
+		}
+		else if (strcmp(argv[i], "--mcts-nodes") == 0 && i + 1 < argc)
+		{
+			config->mcts_nodes = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--mcts-c") == 0 && i + 1 < argc)
+		{
+			config->mcts_exploration = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--rank-stats") == 0)
+		{
+			config->rank_stats = 1;
+		}
+		else if (strcmp(argv[i], "--puct") == 0)
+		{
+			config->mcts_puct = 1;
+		}
+		else if (strcmp(argv[i], "--mcts-sync") == 0 && i + 1 < argc)
+		{
+			config->mcts_sync = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--mcts-share") == 0 && i + 1 < argc)
+		{
+			config->mcts_share = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--tt-mb") == 0 && i + 1 < argc)
+		{
+			config->tt_mb = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--tt-mode") == 0 && i + 1 < argc)
+		{
+			i++;
+			if (strcmp(argv[i], "node") == 0)
+				config->tt_mode = NODE_TABLE;
+			else if (strcmp(argv[i], "distributed") == 0)
+				config->tt_mode = DISTRIBUTED_TABLE;
+			else
+				return FAILURE;
+		}
+		else if (strcmp(argv[i], "--tt-remote-depth") == 0 && i + 1 < argc)
+		{
+			config->tt_remote_depth = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--poll-nodes") == 0 && i + 1 < argc)
+		{
+			config->poll_nodes = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc)
+		{
+			config->memory_mb = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--huge-pages") == 0)
+		{
+			config->huge_pages = 1;
+		}
+		else if (strcmp(argv[i], "--net") == 0 && i + 1 < argc)
+		{
+			if (net_load(&network, argv[++i]) == FAILURE)
+			{
+				fprintf(stderr, "%s is not a network file\n", argv[i]);
+				return FAILURE;
+			}
+			config->use_net = 1;
+		}
+		else if (strcmp(argv[i], "--board-size") == 0 && i + 1 < argc)
+		{
+			config->board_size = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--hierarchy") == 0)
+		{
+			config->hierarchy = 1;
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			snprintf(trace_path, LOGPATHBUFSIZE, "%s", argv[++i]);
+			config->trace = 1;
+		}
+		else if (strcmp(argv[i], "--solve-empties") == 0 && i + 1 < argc)
+		{
+			config->solve_empties = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--wld-empties") == 0 && i + 1 < argc)
+		{
+			config->wld_empties = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+		{
+			config->depth = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc)
+		{
+			config->move_time = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc)
+		{
+			config->node_budget = atoll(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			config->seed = strtoull(argv[++i], NULL, 10);
+			seed_given = 1;
+		}
 		else
-			current_board[i] = OUTER;
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return FAILURE;
+		}
+	}
+	if (config->depth < 1)
+	{
+		config->depth = 1;
+	}
+	if (config->mcts_nodes < 2 * LEGALMOVSBUFSIZE)
+	{
+		config->mcts_nodes = 2 * LEGALMOVSBUFSIZE;
+	}
+	config->mcts_sync = max(config->mcts_sync, 1);
+	config->mcts_share = min(max(config->mcts_share, 0), 2);
+	config->tt_mb = max(config->tt_mb, 0);
+	config->poll_nodes = max(config->poll_nodes, 1);
+	if (config->move_time < 0)
+	{
+		config->move_time = 0;
+	}
+	if (config->deterministic && !seed_given)
+	{
+		config->seed = 1; // Reproducible runs never seed from the clock
+	}
+	if (config->memory_mb <= 0)
+	{
+		config->memory_mb = max(match_setting(MATCHCONFIG, "memory", 0), 0);
+	}
+	return SUCCESS;
+}
+/**
+ * @brief Settles the size of the referee's board: the one given with --board-size, or else the "boardSize"
+ * 		  setting of the match, or else 8x8. Other sizes are played on the mailbox board with the Alpha/Beta
+ * 		  search and the square weights only.
+ *
+ * @param config The settings to update.
+ * @return SUCCESS, or FAILURE if the size cannot be played.
+ */
+int choose_board_size(SearchConfig *config)
+{
+	MailboxPosition board;
+
+	if (config->board_size <= 0)
+	{
+		config->board_size = match_setting(MATCHCONFIG, "boardSize", BOARDSIDE);
 	}
-	for (i = 90; i <= 99; i++)
-		current_board[i] = OUTER;
-	current_board[44] = WHITE;
-	current_board[45] = BLACK;
-	current_board[54] = BLACK;
-	current_board[55] = WHITE;
+	if (config->board_size == BOARDSIDE)
+	{
+		return SUCCESS;
+	}
+	if (mailbox_initialise(&board, config->board_size) == FAILURE)
+	{
+		fprintf(stderr, "Boards of %d squares per side are not supported\n", config->board_size);
+		return FAILURE;
+	}
+	if (config->engine == MCTS_ENGINE || config->use_net)
+	{
+		fprintf(stderr, "Only the Alpha/Beta search with the square weights plays on a %dx%d board\n",
+				config->board_size, config->board_size);
+		config->engine = ALPHABETA_ENGINE;
+		config->use_net = 0;
+	}
+	return SUCCESS;
 }
 /**
- * @brief Free's the memory allocated for the game board.
+ * @brief Builds and commits the MPI datatype for a Position: three 64-bit words followed by three bytes,
+ * 		  resized to the padded size of the struct so that arrays of positions can be sent as well.
  *
- * @param active_board The pointer to the game board.
+ * @param type The datatype to create.
  */
-void free_board(int *active_board)
+void position_type_create(MPI_Datatype *type)
 {
-	free(active_board);
+	Position sample = {{0}};
+	MPI_Datatype packed;
+	MPI_Aint base;
+	MPI_Aint displacements[2];
+	int blocklengths[2] = {3, 3};
+	MPI_Datatype types[2] = {MPI_UINT64_T, MPI_UINT8_T};
+
+	MPI_Get_address(&sample, &base);
+	MPI_Get_address(&sample.discs[0], &displacements[0]);
+	MPI_Get_address(&sample.to_move, &displacements[1]);
+	displacements[0] -= base;
+	displacements[1] -= base;
+
+	MPI_Type_create_struct(2, blocklengths, displacements, types, &packed);
+	MPI_Type_create_resized(packed, 0, sizeof(Position), type);
+	MPI_Type_commit(type);
+	MPI_Type_free(&packed);
 }
 /**
  * @brief The entry point for worker processes. Worker processes dynamiclly recieve a set amount of moves which
- * 		  are then run through a MiniMax algorithm with Alpha/Beta Pruning and eventually use MPI to send the results 
+ * 		  are then run through a MiniMax algorithm with Alpha/Beta Pruning and eventually use MPI to send the results
  * 		  and best moves back to the master process
  *
  * @param rank The rank of the process.
@@ -283,439 +983,540 @@ void free_board(int *active_board)
 void run_worker(int rank)
 {
 	int running = 0;
-	int my_colour = 0;
-	int depth = 6;
+	int turn = 0; // positions broadcast so far, numbered as the master's turns
 
-	MPI_Bcast(&my_colour, 1, MPI_INT, 0, MPI_COMM_WORLD); // Broadcast colour
+	MPI_Bcast(&config, sizeof(SearchConfig), MPI_BYTE, 0, MPI_COMM_WORLD); // Broadcast search settings
+	rng_state = config.seed + rank;
+	initialise_memory(rank, 0);
+	initialise_engine(rank, NULL);
+	initialise_table(NULL);
+	initialise_hierarchy(NULL);
+	if (config.trace)
+	{
+		trace_open(&arena);
+	}
+	if (!config.deterministic) // The master only sends control messages when timing matters
+	{
+		search_poll = poll_control;
+		poll_interval = config.poll_nodes;
+	}
+	double wait = MPI_Wtime();
+	double trace_wait = trace_now();
+	PERF_BEGIN(PERF_MPI);
 	MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD);	  // Broadcast running
 
 	while (running == 1)
 	{
+		if (config.board_size != BOARDSIDE) // Every rank searches its share of the root moves
+		{
+			MPI_Bcast(&current_mailbox, sizeof(MailboxPosition), MPI_BYTE, 0, MPI_COMM_WORLD);
+			trace_span(TRACE_BCAST, ++turn, trace_wait);
+			PERF_END(PERF_MPI);
+			mailbox_strategy(NULL);
+			PERF_BEGIN(PERF_MPI);
+			trace_wait = trace_now();
+			MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD);
+			continue;
+		}
 
-		MPI_Bcast(current_board, BOARDSIZE, MPI_INT, 0, MPI_COMM_WORLD); // Broadcast board
-
-		int num_moves;
-		MPI_Recv(&num_moves, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE); // sets num_moves to how many moves for that rank
+		MPI_Bcast(&current_position, 1, position_type, 0, MPI_COMM_WORLD); // Broadcast position
+		trace_span(TRACE_BCAST, ++turn, trace_wait);
 
-		if (num_moves != 0)
+		if (config.engine == MCTS_ENGINE) // Every rank grows its own tree
 		{
-			int *ranks_moves = (int *)malloc(num_moves * sizeof(int)); // allocate space for recieving moves
-			memset(ranks_moves, 0, num_moves);
-			MPI_Recv(ranks_moves, num_moves, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE); // populates rank_moves[] with its set of moves
-
-			/* call minimax function to get score for each move */
+			PERF_END(PERF_MPI);
+			mcts_strategy(NULL, NULL);
+			PERF_BEGIN(PERF_MPI);
+			trace_wait = trace_now();
+			MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD);
+			continue;
+		}
 
-			int score;				  
-			int best_move = -1;		 
-			int best_score = INT_MIN; 
-			int alpha = INT_MIN;
-			int beta = INT_MAX;
-			for (int i = 0; i < num_moves; i++)  	// Goes through all possible moves
-			{ 
-				int *temp_board = (int *)malloc(BOARDSIZE * sizeof(int));
-				for (int j = 0; j < BOARDSIZE; j++)
-				{
-					temp_board[j] = current_board[j]; 	// Creates new temp board for each move thats the same as the current board
-				}
+		if (serve_solve_jobs(&wait)) // The master solved the position with the workers
+		{
+			trace_wait = trace_now();
+			MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD);
+			continue;
+		}
 
-				make_move(ranks_moves[i], my_colour, NULL, temp_board);		// makes the ith move on the temp board
-				score = minimax(temp_board, opponent(my_colour, NULL), depth - 1, rank, alpha, beta); 	// plays minimax on all the possible moves																				  /* update the best score and best move */
+		int work[WORKMSGSIZE];
+		SearchResult result = {-1, INT_MIN, 0, 0, 0, {0, 0, 0}, 0}; // -1 for "pass" move
+		double trace_start = trace_now();
+		MPI_Recv(work, WORKMSGSIZE, MPI_INT, work_source, WORK_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE); // search id and how many moves for that rank
+		search_id = work[0];
+		trace_span(TRACE_RECEIVE_WORK, search_id, trace_start);
+		bound_depth = 0;
+		double start = MPI_Wtime();
+		rank_stats.idle += start - wait;
 
-				if (score > best_score)
-				{
-					best_score = score;
-					best_move = ranks_moves[i];   // Retrives the best score and correlating best move
-				}
-				free_board(temp_board);  
+		if (node_workers > 0) // A coordinator hands its moves on to the ranks of its node instead of searching them
+		{
+			int node_moves[LEGALMOVSBUFSIZE];
+			if (work[1] != 0)
+			{
+				MPI_Recv(node_moves, work[1], MPI_INT, ROOT, WORK_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
 			}
-
-			MPI_Send(&best_move, 1, MPI_INT, 0, 0, MPI_COMM_WORLD); // Each process sends it's best move to Master Process
+			PERF_END(PERF_MPI);
+			rank_stats.comm += MPI_Wtime() - start;
+			coordinate_search(node_moves, work[1], &result);
+			PERF_BEGIN(PERF_MPI);
 		}
-		else
+		else if (work[1] != 0)
 		{
-			int best_move = -1;
-			MPI_Send(&best_move, 1, MPI_INT, 0, 0, MPI_COMM_WORLD);  // Returns -1 for "pass" move 
+			int ranks_moves[LEGALMOVSBUFSIZE];
+			MPI_Recv(ranks_moves, work[1], MPI_INT, work_source, WORK_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE); // populates rank_moves[] with its set of moves
+			PERF_END(PERF_MPI);
+
+			double comm = rank_stats.comm;
+			double search_start = MPI_Wtime();
+			rank_stats.comm += search_start - start;
+			trace_start = trace_now();
+			search_root(&current_position, ranks_moves, work[1], current_position.to_move, &result); // call minimax function to get score for each move
+			trace_span(TRACE_SEARCH, search_id, trace_start);
+			rank_stats.search += MPI_Wtime() - search_start - (rank_stats.comm - comm); // Less the polling
+			rank_stats.nodes += result.nodes;
+			PERF_BEGIN(PERF_MPI);
 		}
 
+		double send_start = MPI_Wtime();
+		trace_start = trace_now();
+		MPI_Send(&result, sizeof(SearchResult), MPI_BYTE, work_source, RESULT_TAG, MPI_COMM_WORLD); // Each process sends it's best move to Master Process
+		trace_span(TRACE_SEND_RESULT, search_id, trace_start);
+		wait = MPI_Wtime();
+		rank_stats.comm += wait - send_start;
+
+		trace_wait = trace_now();
 		MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD); // Broadcasts running
 	}
+	PERF_END(PERF_MPI);
+	if (search_poll != NULL)
+	{
+		poll_control(); // Drops any message that came after the last search
+	}
 }
 /**
- * @brief The minimax algorithm for determining the best move.
+ * @brief Searches a set of root moves with iterative deepening up to config.depth and keeps the best one. The
+ * 		  best move of each iteration is searched first in the next, and every later move only has to beat it
+ * 		  (or a better score another worker finished with at the same depth). When the search is stopped, by
+ * 		  the master or, in deterministic mode, by the node budget, the last iteration counts as far as it got:
+ * 		  a move that beat the previous best in it is kept.
  *
- * @param board The temp game board.
- * @param player The current player.
- * @param depth The depth of the search tree (depth = 6).
- * @param rank The rank of the process.
- * @param alpha The alpha value for alpha-beta pruning.
- * @param beta The beta value for alpha-beta pruning.
- * @return int The evaluation score for the current board position.
+ * @param pos The root position.
+ * @param moves The root moves to search.
+ * @param amount_of_moves The number of root moves.
+ * @param player The player the score is maximised for.
+ * @param result The best move, its score, the completed depth, the node count and the principal variation.
  */
-int minimax(int *board, int player, int depth, int rank, int alpha, int beta)
+void search_root(const Position *pos, int *moves, int amount_of_moves, int player, SearchResult *result)
 {
-
-	if (depth == 0 || is_game_over_move(board)) // if depth reached or move is a game over move
+	nodes_searched = 0;
+	node_limit = config.deterministic ? config.node_budget : 0;
+	search_aborted = 0;
+	next_poll = poll_interval;
+	if (search_table != NULL)
+	{
+		tt_new_search(search_table);
+	}
+	if (remote_probe != NULL)
 	{
-		return evaluate(player, board);  // Evaluates the position on the board
+		dtt_new_search();
 	}
 
-	if (player)  // Maximising Player
+	result->move = moves[0];
+	result->score = INT_MIN + 1;
+	result->depth = 0;
+	result->bounded = 0;
+	for (int depth = 1; depth <= config.depth; depth++)
 	{
-		int maxEval = INT_MIN;
-		int size;
-		int *future_moves = (int *)malloc(LEGALMOVSBUFSIZE * sizeof(int));
-		int *moves = (int *)malloc(LEGALMOVSBUFSIZE * sizeof(int));
-		legal_moves(player, future_moves, NULL, board);
-		size = future_moves[0];
-		process_moves(future_moves, size, moves);
-		free(future_moves);
-		for (int i = 0; i < size; i++)
+		int best_move = -1;
+		int best_score = INT_MIN;
+		for (int i = 1; i < amount_of_moves; i++)
 		{
-			make_move(moves[i], player, NULL, board);
-			int eval = minimax(board, opponent(player, NULL), depth - 1, rank, alpha, beta);
-			maxEval = max(maxEval, eval); // Finds highest evaluation of every move
-			alpha = max(alpha, eval);     // Adjusts Alpha value
-			if (beta <= alpha)			  // Prunes if needed 
+			if (moves[i] == result->move) // The previous best move goes first
 			{
-				break;
+				moves[i] = moves[0];
+				moves[0] = result->move;
 			}
 		}
-		return maxEval;
-	}
-	else  // Minimising Player
-	{
-		int minEval = INT_MAX;
-		int sizes;
-		int *future_moves = (int *)malloc(LEGALMOVSBUFSIZE * sizeof(int));
-		int *moves = (int *)malloc(LEGALMOVSBUFSIZE * sizeof(int));
-		legal_moves(player, future_moves, NULL, board);
-		sizes = future_moves[0];
-		process_moves(future_moves, sizes, moves);
-		free(future_moves);
-		for (int i = 0; i < sizes; i++)
+		for (int i = 0; i < amount_of_moves; i++)  	// Goes through all possible moves
 		{
-			make_move(moves[i], player, NULL, board);
-			int eval = minimax(board, opponent(player, NULL), depth - 1, rank, alpha, beta);
-			minEval = min(minEval, eval);   // Finds lowest evaluation of every move
-			beta = min(beta, eval);			// Adjust Beta values
-			if (beta <= alpha)				// Prunes if needed
+			Position child = *pos; 	// Copies the position for each move
+			int alpha = max(best_score, (bound_depth == depth) ? search_bound : INT_MIN); // what the move must beat
+
+			make_move(&child, moves[i]);		// makes the ith move on the copy
+			int score = minimax(&child, player, depth - 1, alpha, INT_MAX); 	// plays minimax on all the possible moves
+			if (search_aborted)
 			{
 				break;
 			}
+
+			/* update the best score and best move */
+			if (score > alpha)
+			{
+				best_score = score;
+				best_move = moves[i];   // Retrives the best score and correlating best move
+			}
+		}
+		if (search_aborted)
+		{
+			if (best_move != -1) // Better than the previous best at a greater depth
+			{
+				result->move = best_move;
+				result->score = best_score;
+			}
+			break;
+		}
+		result->bounded = (best_move == -1); // Nothing beat another worker's move, keep the previous best
+		if (!result->bounded)
+		{
+			result->move = best_move;
+			result->score = best_score;
+		}
+		else
+		{
+			result->score = search_bound;
 		}
-		return minEval;
+		result->depth = depth;
 	}
-}
-/**
- * @brief if the game is over based on the current board state.
- *
- * @param board The game board represented as an array.
- * @return 1 if the game is over, 0 otherwise.
- */
-int is_game_over_move(int *board)
-{
-	/* Check if both players have no legal moves */
-	if (!has_legal_moves(board, BLACK) && !has_legal_moves(board, WHITE))
+	result->nodes = nodes_searched;
+	if (remote_probe != NULL)
 	{
-		return 1; // Game over
+		dtt_flush();
+		result->table = dtt_stats;
 	}
-	return 0; // Game not over
+
+	Position child = *pos;
+	make_move(&child, result->move);
+	result->pv[0] = result->move;
+	result->pv_length = 1 + search_pv(&child, player, result->pv + 1, PVBUFSIZE - 1);
 }
 /**
- * @brief if the given player has any legal moves on the current board.
+ * @brief Called when the next move should be generated.
  *
- * @param board The temp game board.
- * @param player The player to check for legal moves.
- * @return 1 if the player has legal moves, 0 otherwise.
+ * @param move The output string to store the generated move.
+ * @param my_colour The color of the player executing the move.
+ * @param fp The file pointer for logging and printing.
+ * @param pos The current position.
  */
-int has_legal_moves(int *board, int player)
+void gen_move_master(char *move, int my_colour, FILE *fp, Position *pos)
 {
-	int *future_moves = (int *)malloc(LEGALMOVSBUFSIZE * sizeof(int));
-	legal_moves(player, future_moves, NULL, board);
-	int size = future_moves[0];
-	return size > 0;
-}
+	int loc;
 
-/**
- * @brief the remaining elements of the input array to the output array without the size at moves[0].
- *
- * @param moves The input array containing moves and size.
- * @param amount_of_moves The number of moves in the input array.
- * @param array The output array to store the copied moves.
- */
-void process_moves(int *moves, int amount_of_moves, int *array)
-{
-	for (int i = 0; i < amount_of_moves; i++)
+	if (config.engine == MCTS_ENGINE)
 	{
-		array[i] = moves[i + 1];
+		loc = mcts_strategy(fp, NULL); // Grows the MCTS tree for the move time
 	}
-}
-/**
- * @brief the maximum value between two integers.
- *
- * @param value1 The first value.
- * @param value2 The second value.
- * @return The maximum value.
- */
-int max(int value1, int value2)
-{
-	// Max Function
-	if (value1 > value2)
+	else
+	{
+		loc = bens_strategy(my_colour, fp); // Genrates the best possible move using minimax
+	}
+
+	if (loc == -1) // if move is a pass
 	{
-		return value1;
+		strncpy(move, "pass\n", MOVEBUFSIZE);
+		make_pass(pos);
 	}
 	else
 	{
-		return value2;
+		/* apply move to gameboard */
+		get_move_string(loc, move);
+		make_move(pos, loc);
 	}
 }
 /**
- * @brief the minimum value between two integers.
+ * @brief The opponent's move to the game board. A move that is not legal is logged and ignored.
  *
- * @param value1 The first value.
- * @param value2 The second value.
- * @return The minimum value.
+ * @param move The move string representing the opponent's move.
+ * @param my_colour The color of the player.
+ * @param fp The file pointer for logging.
+ * @param pos The current position.
  */
-int min(int value1, int value2)
+void apply_opp_move(char *move, int my_colour, FILE *fp, Position *pos)
 {
-	// Min Function
-	if (value1 > value2)
+	int loc;
+	if (strncmp(move, "pass", 4) == 0) // with or without the trailing newline
 	{
-		return value2;
+		make_pass(pos);
+		return;
 	}
-	else
+	loc = get_loc(move);
+	if (loc == -1 || !legalp(pos, loc))
 	{
-		return value1;
+		fprintf(fp, "Ignored the illegal move %s\n", move);
+		return;
 	}
+	make_move(pos, loc);
 }
 /**
- * @brief Called when the next move should be generated.
+ * @brief Called when the next move should be generated on a board other than 8x8.
  *
  * @param move The output string to store the generated move.
- * @param my_colour The color of the player executing the move.
  * @param fp The file pointer for logging and printing.
- * @param active_board The current game board.
+ * @param pos The current position.
  */
-void gen_move_master(char *move, int my_colour, FILE *fp, int *active_board)
+void gen_move_mailbox(char *move, FILE *fp, MailboxPosition *pos)
 {
-	int loc;
-
-	loc = bens_strategy(my_colour, fp); // Genrates the best possible move using minimax
+	int loc = mailbox_strategy(fp);
 
 	if (loc == -1) // if move is a pass
 	{
 		strncpy(move, "pass\n", MOVEBUFSIZE);
+		mailbox_make_pass(pos);
 	}
 	else
 	{
-		/* apply move to gameboard */
-		get_move_string(loc, move);
-		make_move(loc, my_colour, fp, active_board);
+		move_to_string(loc, pos->size, move);
+		mailbox_make_move(pos, loc);
 	}
 }
 /**
- * @brief The opponent's move to the game board.
+ * @brief Applies the opponent's move on a board other than 8x8. A move that is not legal is logged and
+ * 		  ignored.
  *
  * @param move The move string representing the opponent's move.
- * @param my_colour The color of the player.
  * @param fp The file pointer for logging.
- * @param active_board The game board represented as an array.
+ * @param pos The current position.
  */
-void apply_opp_move(char *move, int my_colour, FILE *fp, int *active_board)
+void apply_opp_mailbox_move(char *move, FILE *fp, MailboxPosition *pos)
 {
 	int loc;
-	if (strcmp(move, "pass\n") == -1) // changed to -1 from 0
+
+	if (strncmp(move, "pass", 4) == 0) // with or without the trailing newline
 	{
+		mailbox_make_pass(pos);
 		return;
 	}
-	loc = get_loc(move);
-	make_move(loc, opponent(my_colour, fp), fp, active_board);
-}
-/**
- * @brief Necessary cleanup and finalize the game.
- */
-void game_over()
-{
-	free_board(current_board);
-	MPI_Finalize();
-}
-/**
- * @brief Sets a location on the game board to its corresponding move string.
- *
- * @param loc The location on the game board.
- * @param ms The output string to store the move string.
- */
-void get_move_string(int loc, char *ms)
-{
-	int row, col, new_loc;
-	new_loc = loc - (9 + 2 * (loc / 10));
-	row = new_loc / 8;
-	col = new_loc % 8;
-	ms[0] = row + '0';
-	ms[1] = col + '0';
-	ms[2] = '\n';
-	ms[3] = 0;
-}
-/**
- * @brief Converts a move string to its corresponding location on the game board.
- *
- * @param movestring The move string.
- * @return The location on the game board.
- */
-int get_loc(char *movestring)
-{
-	int row, col;
-	/* movestring of form "xy", x = row and y = column */
-	row = movestring[0] - '0';
-	col = movestring[1] - '0';
-	return (10 * (row + 1)) + col + 1;
-}
-/**
- * @brief Generate an array of legal moves for the given player.
- *
- * @param player The player for whom to generate legal moves.
- * @param moves The output array to store the legal moves.
- * @param fp The file pointer for logging.
- * @param active_board The temp game board .
- */
-void legal_moves(int player, int *moves, FILE *fp, int *active_board)
-{
-	int move, i;
-	moves[0] = 0;
-	i = 0;
-	for (move = 11; move <= 88; move++)
+	loc = move_from_string(move, pos->size);
+	if (loc == -1 || mailbox_flips(pos, loc) == 0)
 	{
-		if (legalp(move, player, fp, active_board))
-		{
-			i++;
-			moves[i] = move;
-		}
+		fprintf(fp, "Ignored the illegal move %s\n", move);
+		return;
 	}
-	moves[0] = i;
+	mailbox_make_move(pos, loc);
 }
 /**
- * @brief Check if a move is legal for a player.
+ * @brief Alpha/Beta search on a board other than 8x8, run by every rank at once. Each iteration of the
+ * 		  deepening deals the root moves out round-robin, each rank searches its own moves with the best
+ * 		  score so far as the bound, and MPI_Allreduce picks the best move of all ranks. Every rank stops at
+ * 		  the move time by its own clock, or in deterministic mode at its node budget; an iteration that any
+ * 		  rank could not finish is dropped. The best move of the last iteration leads the next one.
  *
- * @param move The move to check.
- * @param player The player making the move.
- * @param fp The file pointer.
- * @param active_board The active game board.
- * @return Returns 1 if the move is legal, 0 otherwise.
+ * @param fp The file pointer, NULL on the workers.
+ * @return The best move on every rank, -1 to pass.
  */
-int legalp(int move, int player, FILE *fp, int *active_board)
+int mailbox_strategy(FILE *fp)
 {
-	int i;
+	double start = MPI_Wtime();
+	void (*poll)(void) = search_poll;
+	int moves[MAILBOX_MOVESBUFSIZE];
+	int amount_of_moves = mailbox_legal_moves(&current_mailbox, moves);
+	int best[2] = {INT_MIN, -1}; // score and move of the last finished iteration, for MPI_MAXLOC
+	int depth = 0;
+	int rank;
+	long long nodes;
 
-	if (!validp(move))
-		return 0;
-	if (active_board[move] == EMPTY)
+	if (amount_of_moves == 0)
 	{
+		return -1; // Nothing to think about when we have to pass, on any rank
+	}
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	nodes_searched = 0;
+	node_limit = config.deterministic ? config.node_budget : 0;
+	search_aborted = 0;
+	search_deadline = start + config.move_time;
+	search_poll = (!config.deterministic && config.move_time > 0) ? poll_clock : NULL;
+	poll_interval = config.poll_nodes;
+	next_poll = poll_interval;
 
-		i = 0;
-		while (i <= 7 && !would_flip(move, ALLDIRECTIONS[i], player, fp, active_board))
-			i++;
-		if (i == 8)
-			return 0;
-		else
-			return 1;
+	while (depth < config.depth && depth < current_mailbox.empties) // Deeper than the game is long adds nothing
+	{
+		int local[2] = {INT_MIN, -1};
+		int aborted;
+		for (int i = rank; i < amount_of_moves; i += MPI_SIZE)
+		{
+			MailboxPosition child = current_mailbox;
+			mailbox_make_move(&child, moves[i]);
+			int score = mailbox_minimax(&child, current_mailbox.to_move, depth, local[0], INT_MAX);
+			if (search_aborted)
+			{
+				break;
+			}
+			if (score > local[0])
+			{
+				local[0] = score;
+				local[1] = moves[i];
+			}
+		}
+		MPI_Allreduce(&search_aborted, &aborted, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+		if (aborted)
+		{
+			break;
+		}
+		MPI_Allreduce(local, best, 1, MPI_2INT, MPI_MAXLOC, MPI_COMM_WORLD);
+		depth++;
+		for (int i = 1; i < amount_of_moves; i++)
+		{
+			if (moves[i] == best[1]) // The best move goes first
+			{
+				moves[i] = moves[0];
+				moves[0] = best[1];
+				break;
+			}
+		}
 	}
-	else
-		return 0;
-}
-/**
- * @brief Check if a move is valid.
- *
- * @param move The move to check.
- * @return Returns 1 if the move is valid, 0 otherwise.
- */
-int validp(int move)
-{
-	if ((move >= 11) && (move <= 88) && (move % 10 >= 1) && (move % 10 <= 8))
-		return 1;
-	else
-		return 0;
+	search_poll = poll;
+	search_aborted = 0;
+	MPI_Reduce(&nodes_searched, &nodes, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+	if (best[1] == -1) // Not even the first iteration finished
+	{
+		best[1] = moves[0];
+	}
+	if (fp != NULL)
+	{
+		fprintf(fp, "Mailbox search: move %d score %d depth %d nodes %lld time %.3fs\n", best[1], best[0], depth,
+				nodes, MPI_Wtime() - start);
+		fflush(fp);
+	}
+	return best[1];
 }
 /**
- * @brief Check if a move would cause a piece to flip.
- *
- * @param move The move to check.
- * @param dir The direction to check for flipping.
- * @param player The player making the move.
- * @param fp The file pointer.
- * @param active_board The active game board.
- * @return Returns 1 if the move would cause a flip, 0 otherwise.
+ * @brief Necessary cleanup and finalize the game.
  */
-int would_flip(int move, int dir, int player, FILE *fp, int *active_board)
+void game_over()
 {
-	int c;
-	c = move + dir;
-	if (active_board[c] == opponent(player, fp))
-		return find_bracket_piece(c + dir, dir, player, fp, active_board);
-	else
-		return 0;
+#ifdef PERF_COUNTERS
+	report_perf_counters();
+#endif
+	dtt_free();
+	if (table_window != MPI_WIN_NULL)
+	{
+		MPI_Win_unlock_all(table_window);
+		MPI_Win_free(&table_window);
+	}
+	if (node_comm != MPI_COMM_NULL)
+	{
+		MPI_Comm_free(&node_comm);
+	}
+	arena_destroy(&bench_table);
+	arena_destroy(&arena);
+	MPI_Type_free(&position_type);
+	MPI_Finalize();
 }
 /**
- * @brief Find the bracketing piece for a move.
+ * @brief Strategy for making a move but calculating the legal moves in a position, dynamiclly dividing it
+ * 		  up and sending it between processors using MPI. It then Recieves each worker's best move and score and
+ * 		  plays the best of them.
  *
- * @param square The square to start searching from.
- * @param dir The direction to search.
- * @param player The player making the move.
+ * @param my_colour The color of the player.
  * @param fp The file pointer.
- * @param active_board The active game board.
- * @return Returns the bracketing piece if found, 0 otherwise.
+ * @return Returns the best move.
  */
-int find_bracket_piece(int square, int dir, int player, FILE *fp, int *active_board)
+int bens_strategy(int my_colour, FILE *fp)
 {
-	while (validp(square) && active_board[square] == opponent(player, fp))
-		square = square + dir;
-	if (validp(square) && active_board[square] == player)
-		return square;
-	else
-		return 0;
+	SearchResult best;
+
+	search_move(&current_position, &best, fp);
+	return best.move; // Returns Best Move possible, -1 if Move is a Pass
 }
 /**
- * @brief Get the opponent player.
+ * @brief Picks the Alpha/Beta engine's move, the same way in a game and in analysis: the endgame solver's move
+ * 		  when it settles the position, or else the best_result of the distributed search in the time the solver
+ * 		  left. The workers' own scores decide, merged in a canonical order, so the move does not depend on which
+ * 		  rank searched which move.
  *
- * @param player The player.
- * @param fp The file pointer.
- * @return Returns the opponent player.
+ * @param pos The position, already broadcast to the workers.
+ * @param best The move, its score, depth and principal variation, with the nodes of the whole search; -1 as the
+ * 			   move if no worker had one.
+ * @param fp The file pointer for the search summary, NULL for none.
  */
-int opponent(int player, FILE *fp)
+void search_move(const Position *pos, SearchResult *best, FILE *fp)
 {
-	if (player == BLACK)
-		return WHITE;
-	if (player == WHITE)
-		return BLACK;
-	fprintf(fp, "illegal player\n");
-	return EMPTY;
+	SearchResult none = {-1, 0, 0, 0, 0, {0, 0, 0}, 0};
+	double move_time = config.move_time;
+	double start = MPI_Wtime();
+	double solve_start = trace_now();
+	int solve_result = solve_endgame(pos, best, fp);
+
+	trace_span(TRACE_SOLVE, search_id, solve_start);
+	if (solve_result == SUCCESS)
+	{
+		return;
+	}
+	if (move_time > 0) // The search gets what the solver left
+	{
+		config.move_time = move_time - (MPI_Wtime() - start);
+		config.move_time = (config.move_time > MINMOVETIME) ? config.move_time : MINMOVETIME;
+	}
+
+	SearchResult *results = worker_results;
+	int count = distribute_search(pos, results, fp);
+	config.move_time = move_time;
+
+	const SearchResult *result = best_result(results, count);
+	*best = (result != NULL) ? *result : none;
+	best->nodes = 0;
+	for (int i = 0; i < count; i++)
+	{
+		best->nodes += results[i].nodes; // Reported for the whole search
+	}
 }
 /**
- * @brief Strategy for making a move but calculating the legal moves in a position, dynamiclly dividing it 
- * 		  up and sending it between processors using MPI. It then Recieves the optimal positions and preforms another 
- * 		  MiniMax search on them to find the best piece.
+ * @brief Searches every legal move of a position on the workers, dividing the moves among them. Results are
+ * 		  collected as they come in; each finished worker's score is passed on to the others as a bound, and
+ * 		  the remaining searches are stopped when the move time is up. With a single rank the master searches
+ * 		  all moves itself and watches the clock. With --hierarchy the moves go to the ranks of the master's node
+ * 		  and to one coordinator per other node, which answers for its whole node. Every rank must be waiting for
+ * 		  the position.
  *
- * @param my_colour The color of the player.
- * @param fp The file pointer.
- * @return Returns the best move.
+ * @param pos The position, already broadcast to the workers.
+ * @param results One result per worker (or one for the master alone), -1 as the move of workers without moves
+ * 				  and of the ranks behind a coordinator.
+ * @param fp The file pointer for the search summary, NULL for none.
+ * @return The number of results.
  */
-int bens_strategy(int my_colour, FILE *fp)
+int distribute_search(const Position *pos, SearchResult *results, FILE *fp)
 {
-	int *moves = (int *)malloc(LEGALMOVSBUFSIZE * sizeof(int));
-	memset(moves, 0, LEGALMOVSBUFSIZE);
-	legal_moves(my_colour, moves, fp, current_board); // populates moves[] with ALL moves possible
+	double start = MPI_Wtime();
+	int moves[LEGALMOVSBUFSIZE];
+	int total_legal_moves = legal_moves(pos, moves); // populates moves[] with ALL moves possible
+	int work[WORKMSGSIZE];
+	int count = MPI_SIZE - 1;
+	int expected = count; // results to wait for: one per worker, or per rank the master hands moves to
+	double comm = rank_stats.comm;
+	SearchResult none = {-1, INT_MIN, 0, 0, 0, {0, 0, 0}, 0};
+	double dispatch_start = trace_now();
 
-	int total_legal_moves = moves[0]; // amount of possible moves
-
-	if (total_legal_moves < MPI_SIZE - 1)  // If the amount of moves are LESS than the amount of processors avalible
+	search_id++;
+	work[0] = search_id;
+	PERF_BEGIN(PERF_MPI);
+	if (MPI_SIZE == 1) // No workers, searched below
 	{
-		int *output_moves = (int *)malloc(total_legal_moves * sizeof(int));
-		memset(output_moves, 0, total_legal_moves);
-		process_moves(moves, total_legal_moves, output_moves);  // populates output_moves array with all moves
-
+		count = 1;
+		expected = 1;
+	}
+	else if (config.hierarchy) // The ranks of the master's node and the coordinators of the others
+	{
+		hand_out_work(moves, total_legal_moves, worker_weights);
+		expected = 0;
+		for (int i = 1; i < MPI_SIZE; i++)
+		{
+			expected += (worker_weights[i] > 0);
+			if (worker_weights[i] == 0) // Reports to its coordinator
+			{
+				results[i - 1] = none;
+			}
+		}
+	}
+	else if (total_legal_moves < MPI_SIZE - 1)  // If the amount of moves are LESS than the amount of processors avalible
+	{
+		work[1] = total_legal_moves;
 		for (int j = 1; j < MPI_SIZE; j++)  // Sends to Worker Process
 		{
-			MPI_Send(&total_legal_moves, 1, MPI_INT, j, 0, MPI_COMM_WORLD);
-			MPI_Send(output_moves, total_legal_moves, MPI_INT, j, 0, MPI_COMM_WORLD);
+			MPI_Send(work, WORKMSGSIZE, MPI_INT, j, WORK_TAG, MPI_COMM_WORLD);
+			if (total_legal_moves > 0) // Workers only receive a move list that is not empty
+			{
+				MPI_Send(moves, total_legal_moves, MPI_INT, j, WORK_TAG, MPI_COMM_WORLD);
+			}
 		}
 	}
 	else if ((total_legal_moves >= (MPI_SIZE - 1)))  // If the amount of moves are MORE than the amount of processors avalible
@@ -723,7 +1524,7 @@ int bens_strategy(int my_colour, FILE *fp)
 
 		int moves_per_process = total_legal_moves / (MPI_SIZE - 1); // Divide up
 		int remainder_moves = total_legal_moves % (MPI_SIZE - 1);	// Remander goes to rank 3
-		int current_index = 1;
+		int current_index = 0;
 		for (int i = 1; i < MPI_SIZE; i++)
 		{
 			int num_moves = moves_per_process;
@@ -731,192 +1532,1840 @@ int bens_strategy(int my_colour, FILE *fp)
 			{
 				num_moves = num_moves + remainder_moves;
 			}
-			MPI_Send(&num_moves, 1, MPI_INT, i, 0, MPI_COMM_WORLD);
-			MPI_Send(&moves[current_index], num_moves, MPI_INT, i, 0, MPI_COMM_WORLD); // Dynamiclly sends moves to each process
+			work[1] = num_moves;
+			MPI_Send(work, WORKMSGSIZE, MPI_INT, i, WORK_TAG, MPI_COMM_WORLD);
+			MPI_Send(&moves[current_index], num_moves, MPI_INT, i, WORK_TAG, MPI_COMM_WORLD); // Dynamiclly sends moves to each process
 			current_index += num_moves;
 		}
 	}
 
-	int *best_moves = (int *)malloc((MPI_SIZE - 1) * sizeof(int));
-	memset(best_moves, 0, (MPI_SIZE - 1));
-	for (int i = 1; i < MPI_SIZE; i++)
+	PERF_END(PERF_MPI);
+	trace_span(TRACE_DISPATCH, search_id, dispatch_start);
+	double collect_start = MPI_Wtime();
+	double trace_start = trace_now();
+	rank_stats.comm += collect_start - start;
+	int *finished = worker_flags;
+	for (int i = 0; i < MPI_SIZE; i++)
 	{
-		MPI_Recv(&best_moves[i - 1], 1, MPI_INT, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE); // Recovers each processes best move
+		finished[i] = config.hierarchy && worker_weights[i] == 0; // Control messages go through the coordinators
 	}
-
-	int score;
-	int rank = 0;
-	int best_score = INT_MIN;
-	int best_move = -1;
-	int alpha = INT_MIN;
-	int beta = INT_MAX;
-	for (int i = 0; i < MPI_SIZE - 1; i++)
-	{ 
-		int *temp_board = (int *)malloc(BOARDSIZE * sizeof(int));
-		for (int j = 0; j < BOARDSIZE; j++)
+	struct timespec pause = {0, POLLPAUSENS};
+	DTTStats table = {0, 0, 0};
+	long long total_nodes = 0;
+	int received = 0;
+	int stopped = 0;
+	int best_bound = INT_MIN;
+	int min_depth = INT_MAX;
+	int max_depth = 0;
+	int timed = !config.deterministic && config.move_time > 0;
+	if (MPI_SIZE == 1)
+	{
+		results[0] = none;
+		bound_depth = 0;
+		search_deadline = start + config.move_time;
+		if (timed)
 		{
-			temp_board[j] = current_board[j];
+			search_poll = poll_clock;
+			poll_interval = config.poll_nodes;
 		}
-
-		if (best_moves[i] != -1)
+		if (total_legal_moves > 0)
 		{
-			make_move(best_moves[i], my_colour, NULL, temp_board);
-			score = minimax(temp_board, opponent(my_colour, NULL), 1, rank, alpha, beta); // Uses Minimax to get the best move possible
-			best_move = best_moves[i];
+			search_root(pos, moves, total_legal_moves, pos->to_move, &results[0]);
 		}
-		else
+		search_poll = NULL;
+		trace_span(TRACE_SEARCH, search_id, trace_start);
+		rank_stats.search += MPI_Wtime() - collect_start;
+		rank_stats.nodes += results[0].nodes;
+		stopped = search_aborted && timed;
+		received = expected;
+		total_nodes = results[0].nodes;
+		min_depth = max_depth = results[0].depth;
+	}
+	PERF_BEGIN(PERF_MPI);
+	while (received < expected)
+	{
+		int flag;
+		MPI_Status status;
+		MPI_Iprobe(MPI_ANY_SOURCE, RESULT_TAG, MPI_COMM_WORLD, &flag, &status);
+		if (flag)
+		{
+			SearchResult *result = &results[status.MPI_SOURCE - 1];
+			double receive_start = MPI_Wtime();
+			MPI_Recv(result, sizeof(SearchResult), MPI_BYTE, status.MPI_SOURCE, RESULT_TAG, MPI_COMM_WORLD,
+					 MPI_STATUS_IGNORE); // Recovers each processes best move
+			rank_stats.comm += MPI_Wtime() - receive_start;
+			finished[status.MPI_SOURCE] = 1;
+			received++;
+			total_nodes += result->nodes;
+			table.probes += result->table.probes;
+			table.hits += result->table.hits;
+			table.stores += result->table.stores;
+			if (result->move != -1)
+			{
+				min_depth = min(min_depth, result->depth);
+				max_depth = max(max_depth, result->depth);
+			}
+			if (!stopped && !config.deterministic && result->move != -1 && !result->bounded &&
+				result->depth == config.depth && result->score > best_bound)
+			{
+				best_bound = result->score;
+				send_control(NEW_BOUND, config.depth, best_bound, finished);
+			}
+		}
+		else if (!stopped && timed && MPI_Wtime() - start >= config.move_time)
 		{
-			score == INT_MIN + 1;
+			send_control(ABORT_SEARCH, 0, 0, finished);
+			stopped = 1;
 		}
-		/* update the best score and best move */
-		if (score > best_score)
+		else
 		{
-			best_score = score;
-			best_move = best_moves[i];
+			nanosleep(&pause, NULL);
 		}
 	}
-
-	if (total_legal_moves == 0)
+	PERF_END(PERF_MPI);
+	if (MPI_SIZE > 1) // The master only hands out work and waits for it
 	{
-		return -1;  // if Move is a Pass
+		rank_stats.idle += MPI_Wtime() - start - (rank_stats.comm - comm);
+		trace_span(TRACE_COLLECT, search_id, trace_start);
 	}
-	else
+
+	if (fp != NULL)
 	{
-		return best_move; // Returns Best Move possible
+		fprintf(fp, "Searched %lld nodes", total_nodes);
+		if (max_depth > 0)
+		{
+			fprintf(fp, " to depth %d-%d", min_depth, max_depth);
+		}
+		fprintf(fp, stopped ? " in %.3fs, stopped at the move time\n" : " in %.3fs\n", MPI_Wtime() - start);
+		if (remote_probe != NULL)
+		{
+			fprintf(fp, "Distributed table: %lld remote probes, %lld hits, %lld remote stores\n", table.probes,
+					table.hits, table.stores);
+		}
+		fflush(fp);
 	}
+	return count;
 }
 /**
-Writes text to a file.
-
-- @param filename The name of the file to write to.
-- @param text The text to be written to the file.
-*/
-void writeToFile(char *filename, char *text)
+ * @brief A coordinator's part of a search with --hierarchy: hands its share of the root moves on to the other
+ * 		  ranks of its node and waits for them as the master does in distribute_search. The master's bounds and
+ * 		  aborts are passed on to the ranks still searching, and the score of a rank that finishes the full
+ * 		  depth goes to the others as a bound. The node's results are merged into one for the master.
+ *
+ * @param moves The root moves from the master.
+ * @param count The number of root moves, 0 if the master had none for this node.
+ * @param result The best of the node's results, with the nodes and table traffic of all of them.
+ */
+void coordinate_search(const int *moves, int count, SearchResult *result)
 {
-	FILE *dfp;
-	dfp = fopen(filename, "a");
-	fprintf(dfp, "%s", text);
-	fclose(dfp);
+	double start = MPI_Wtime();
+	double comm = rank_stats.comm;
+	struct timespec pause = {0, POLLPAUSENS};
+	SearchResult none = {-1, INT_MIN, 0, 0, 0, {0, 0, 0}, 0};
+	double trace_start = trace_now();
+	int *finished = worker_flags;
+	int received = 0;
+	int stopped = 0;
+	int best_bound = INT_MIN;
+
+	for (int i = 0; i < MPI_SIZE; i++)
+	{
+		finished[i] = (worker_weights[i] == 0); // Only the ranks of this node hear from it
+		worker_results[i] = none;
+	}
+	PERF_BEGIN(PERF_MPI);
+	hand_out_work(moves, count, worker_weights);
+	rank_stats.comm += MPI_Wtime() - start;
+	while (received < node_workers)
+	{
+		int flag;
+		int message[CONTROLMSGSIZE];
+		MPI_Status status;
+		MPI_Iprobe(MPI_ANY_SOURCE, RESULT_TAG, MPI_COMM_WORLD, &flag, &status);
+		if (flag)
+		{
+			SearchResult *node_result = &worker_results[status.MPI_SOURCE];
+			double receive_start = MPI_Wtime();
+			MPI_Recv(node_result, sizeof(SearchResult), MPI_BYTE, status.MPI_SOURCE, RESULT_TAG, MPI_COMM_WORLD,
+					 MPI_STATUS_IGNORE);
+			rank_stats.comm += MPI_Wtime() - receive_start;
+			finished[status.MPI_SOURCE] = 1;
+			received++;
+			if (!stopped && !config.deterministic && node_result->move != -1 && !node_result->bounded &&
+				node_result->depth == config.depth && node_result->score > best_bound)
+			{
+				best_bound = node_result->score;
+				send_control(NEW_BOUND, config.depth, best_bound, finished);
+			}
+			continue;
+		}
+		MPI_Iprobe(ROOT, CONTROL_TAG, MPI_COMM_WORLD, &flag, MPI_STATUS_IGNORE);
+		if (flag)
+		{
+			double receive_start = MPI_Wtime();
+			MPI_Recv(message, CONTROLMSGSIZE, MPI_INT, ROOT, CONTROL_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+			rank_stats.comm += MPI_Wtime() - receive_start;
+			if (message[1] != search_id || stopped) // Late, or after the node was already stopped
+			{
+				continue;
+			}
+			if (message[0] == ABORT_SEARCH)
+			{
+				send_control(ABORT_SEARCH, 0, 0, finished);
+				stopped = 1;
+			}
+			else if (message[0] == NEW_BOUND && message[2] == config.depth && message[3] > best_bound)
+			{
+				best_bound = message[3];
+				send_control(NEW_BOUND, config.depth, best_bound, finished);
+			}
+		}
+		else
+		{
+			nanosleep(&pause, NULL);
+		}
+	}
+	PERF_END(PERF_MPI);
+
+	const SearchResult *best = best_result(worker_results, MPI_SIZE);
+	*result = (best != NULL) ? *best : none;
+	result->nodes = 0;
+	result->table.probes = result->table.hits = result->table.stores = 0;
+	for (int i = 0; i < MPI_SIZE; i++)
+	{
+		result->nodes += worker_results[i].nodes;
+		result->table.probes += worker_results[i].table.probes;
+		result->table.hits += worker_results[i].table.hits;
+		result->table.stores += worker_results[i].table.stores;
+	}
+	rank_stats.idle += MPI_Wtime() - start - (rank_stats.comm - comm);
+	trace_span(TRACE_COORDINATE, search_id, trace_start);
 }
 /**
-Makes a move on the active game board.
-
-- @param move The move to be made.
-- @param player The player making the move.
-- @param fp The file pointer for output.
-- @param active_board The game board array.
-*/
-void make_move(int move, int player, FILE *fp, int *active_board)
+ * @brief Hands root moves out for the current search, in proportion to each rank's weight: every rank with a
+ * 		  weight is sent the search id and its number of moves, then the moves if it has any. When there are fewer
+ * 		  moves than ranks every rank gets all of them, as in the flat split of distribute_search.
+ *
+ * @param moves The root moves.
+ * @param count The number of root moves.
+ * @param weights Per rank, its weight, 0 for the ranks that get nothing.
+ */
+void hand_out_work(const int *moves, int count, const int *weights)
 {
-	int i;
-	active_board[move] = player;
-	for (i = 0; i <= 7; i++)
+	int work[WORKMSGSIZE] = {search_id, 0};
+	int ranks = 0;
+	int total = 0;
+	int share = 0;
+	int first = 0;
+
+	for (int i = 0; i < MPI_SIZE; i++)
+	{
+		ranks += (weights[i] > 0);
+		total += weights[i];
+	}
+	for (int i = 0; i < MPI_SIZE; i++)
 	{
-		make_flips(move, ALLDIRECTIONS[i], player, fp, active_board);
+		if (weights[i] == 0)
+		{
+			continue;
+		}
+		share += weights[i];
+		int last = (count < ranks) ? count : (int)((long long)count * share / total);
+		first = (count < ranks) ? 0 : first;
+		work[1] = last - first;
+		MPI_Send(work, WORKMSGSIZE, MPI_INT, i, WORK_TAG, MPI_COMM_WORLD);
+		if (work[1] > 0) // Only a move list that is not empty is sent
+		{
+			MPI_Send(&moves[first], work[1], MPI_INT, i, WORK_TAG, MPI_COMM_WORLD);
+		}
+		first = last;
 	}
 }
 /**
-Makes flips on the game board.
-
-- @param move The move that triggered the flips.
-- @param dir The direction of the flips.
-- @param player The player making the flips.
-- @param fp The file pointer for output.
-- @param active_board The game board array.
-*/
-void make_flips(int move, int dir, int player, FILE *fp, int *active_board)
+ * @brief Tries to solve a position with the endgame solver instead of searching it: exactly with at most
+ * 		  config.solve_empties empties, as a win, loss or draw with at most config.wld_empties. The master takes
+ * 		  the root moves one after the other, and solve_split hands the positions below them to the workers.
+ * 		  The solve stops at half the move time. When it succeeds the workers are told the solve is over;
+ * 		  otherwise they stay ready for either more jobs or the Alpha/Beta search.
+ *
+ * @param pos The position, already broadcast to the workers.
+ * @param result The best move, its score (the disc difference, or 1, 0 and -1 for a win, draw and loss), the
+ * 				 empties as the depth and the nodes searched.
+ * @param fp The file pointer for the solve summary, NULL for none.
+ * @return SUCCESS if the move is solved and not a proven loss, FAILURE if the position should be searched.
+ */
+int solve_endgame(const Position *pos, SearchResult *result, FILE *fp)
 {
-	int bracketer, c;
-	bracketer = would_flip(move, dir, player, fp, active_board);
-	if (bracketer)
+	int moves[LEGALMOVSBUFSIZE];
+	int size = legal_moves(pos, moves);
+	int exact = pos->empties <= config.solve_empties;
+
+	if (config.engine != ALPHABETA_ENGINE || config.deterministic || size == 0 ||
+		(!exact && pos->empties > config.wld_empties))
+	{
+		return FAILURE;
+	}
+	double start = MPI_Wtime();
+	double search = rank_stats.search;
+	double deadline = (config.move_time > 0) ? start + SOLVETIMEFRACTION * config.move_time : 0;
+	int alpha = exact ? -SOLVE_MAXSCORE - 1 : -1;
+	int beta = exact ? SOLVE_MAXSCORE + 1 : 1;
+	int best = -SOLVE_MAXSCORE - 1;
+	int best_move = moves[0];
+	long long nodes = 0;
+
+	search_id++;
+	search_aborted = 0;
+	if (search_table != NULL)
+	{
+		tt_new_search(search_table);
+	}
+	solve_order(pos, moves, size);
+	for (int i = 0; i < size; i++)
+	{
+		Position child = *pos;
+		int score;
+
+		make_move(&child, moves[i]);
+		if (i == 0)
+		{
+			score = -solve_split(&child, -beta, -alpha, deadline, &nodes);
+		}
+		else // Proves the move is no better with a null window first
+		{
+			score = -solve_split(&child, -alpha - 1, -alpha, deadline, &nodes);
+			if (score > alpha && score < beta && !search_aborted)
+			{
+				score = -solve_split(&child, -beta, -score, deadline, &nodes);
+			}
+		}
+		if (search_aborted)
+		{
+			break;
+		}
+		if (score > best)
+		{
+			best = score;
+			best_move = moves[i];
+			alpha = max(alpha, score);
+			if (alpha >= beta)
+			{
+				break;
+			}
+		}
+	}
+	double elapsed = MPI_Wtime() - start;
+	if (MPI_SIZE > 1) // The master only hands out jobs and waits for them, unless it solves small ones itself
+	{
+		rank_stats.idle += elapsed - (rank_stats.search - search);
+	}
+
+	int solved = !search_aborted && (exact || best >= 0);
+	if (solved && MPI_SIZE > 1)
 	{
-		c = move + dir;
-		do
+		SolveJob done = {search_id, SOLVE_DONE, 0, 0, {{0}}};
+		for (int i = 1; i < MPI_SIZE; i++)
 		{
-			active_board[c] = player;
-			c = c + dir;
-		} while (c != bracketer);
+			MPI_Send(&done, sizeof(SolveJob), MPI_BYTE, i, SOLVE_TAG, MPI_COMM_WORLD);
+		}
+	}
+	if (fp != NULL)
+	{
+		char move[MOVEBUFSIZE];
+		get_move_string(best_move, move);
+		move[2] = 0;
+		if (search_aborted)
+			fprintf(fp, "Solving %d empties stopped after %lld nodes in %.3fs\n", pos->empties, nodes, elapsed);
+		else if (exact)
+			fprintf(fp, "Solved %d empties: %+d with move %s, %lld nodes in %.3fs\n", pos->empties, best, move, nodes,
+					elapsed);
+		else if (best >= 0)
+			fprintf(fp, "Solved %d empties: a %s with move %s, %lld nodes in %.3fs\n", pos->empties,
+					(best > 0) ? "win" : "draw", move, nodes, elapsed);
+		else
+			fprintf(fp, "Solved %d empties: every move loses, searching instead, %lld nodes in %.3fs\n", pos->empties,
+					nodes, elapsed);
+		fflush(fp);
+	}
+	if (!solved)
+	{
+		return FAILURE;
 	}
+	result->move = best_move;
+	result->score = exact ? best : (best > 0); // A loss was not accepted
+	result->depth = pos->empties;
+	result->bounded = 0;
+	result->nodes = nodes;
+	result->table.probes = result->table.hits = result->table.stores = 0;
+	result->pv[0] = best_move;
+	result->pv_length = 1;
+	result->solved = exact ? SOLVED_EXACT : SOLVED_WLD;
+	return SUCCESS;
 }
 /**
-* @brief Prints the game board to a file.
-*
-* @param fp The file pointer for output.
-*/
-void print_board(FILE *fp)
+ * @brief Solves a position below a root move with the workers, Young Brothers Wait style: the eldest child,
+ * 		  after fastest-first ordering, goes to one worker alone, and once it is back every other child goes to
+ * 		  the next idle worker with the window the children so far leave. The first child that refutes the
+ * 		  position aborts the jobs still out. Positions with few empties, or with a single rank, are solved on
+ * 		  the master. Results are fail-soft, as from solve.
+ *
+ * @param pos The position.
+ * @param alpha The lower end of the window.
+ * @param beta The upper end of the window.
+ * @param deadline The MPI_Wtime at which the solve stops and search_aborted is set, 0 for none.
+ * @param nodes The nodes searched, added to.
+ * @return The result for the side to move in pos; meaningless once search_aborted is set.
+ */
+int solve_split(const Position *pos, int alpha, int beta, double deadline, long long *nodes)
 {
-	int row, col;
-	fprintf(fp, "   1 2 3 4 5 6 7 8 [%c=%d %c=%d]\n",
-			nameof(BLACK), count(BLACK, current_board), nameof(WHITE), count(WHITE, current_board));
-	for (row = 1; row <= 8; row++)
+	int moves[LEGALMOVSBUFSIZE];
+	int size = legal_moves(pos, moves);
+
+	if (MPI_SIZE == 1 || pos->empties < SPLITEMPTIES)
 	{
-		fprintf(fp, "%d  ", row);
-		for (col = 1; col <= 8; col++)
-			fprintf(fp, "%c ", nameof(current_board[col + (10 * row)]));
-		fprintf(fp, "\n");
+		return solve_local(pos, alpha, beta, deadline, nodes);
 	}
-	fflush(fp);
+	if (size == 0)
+	{
+		Position child = *pos;
+		make_pass(&child);
+		if (legal_moves(&child, moves) == 0) // Neither player can move
+		{
+			return disc_difference(pos);
+		}
+		return -solve_split(&child, -beta, -alpha, deadline, nodes);
+	}
+
+	int *jobs = worker_jobs;		   // job each worker is solving, 0 when idle
+	int *children = worker_children; // child each worker is solving
+	struct timespec pause = {0, POLLPAUSENS};
+	SolveJob job = {search_id, 0, 0, 0, {{0}}};
+	SolveReply reply;
+	int best = -SOLVE_MAXSCORE - 1;
+	int next = 0;	   // next child to hand out
+	int busy = 0;	   // workers with a job
+	int eldest = 0;	   // 1 once the eldest child is solved
+	int stopped = 0;   // 1 after a cutoff or at the deadline
+
+	memset(jobs, 0, MPI_SIZE * sizeof(int));
+	solve_order(pos, moves, size);
+	PERF_BEGIN(PERF_MPI);
+	while (busy > 0 || (!stopped && next < size))
+	{
+		for (int i = 1; i < MPI_SIZE && !stopped && next < size && (next == 0 || eldest); i++)
+		{
+			if (jobs[i] != 0)
+			{
+				continue;
+			}
+			job.job = ++last_job;
+			job.alpha = -beta;
+			job.beta = -max(alpha, best);
+			job.position = *pos;
+			make_move(&job.position, moves[next]);
+			MPI_Send(&job, sizeof(SolveJob), MPI_BYTE, i, SOLVE_TAG, MPI_COMM_WORLD);
+			jobs[i] = job.job;
+			children[i] = next++;
+			busy++;
+		}
+
+		int flag;
+		MPI_Status status;
+		MPI_Iprobe(MPI_ANY_SOURCE, SOLVED_TAG, MPI_COMM_WORLD, &flag, &status);
+		if (flag)
+		{
+			MPI_Recv(&reply, sizeof(SolveReply), MPI_BYTE, status.MPI_SOURCE, SOLVED_TAG, MPI_COMM_WORLD,
+					 MPI_STATUS_IGNORE);
+			jobs[status.MPI_SOURCE] = 0;
+			busy--;
+			*nodes += reply.nodes;
+			if (!reply.aborted)
+			{
+				eldest |= (children[status.MPI_SOURCE] == 0);
+				best = max(best, -reply.score);
+			}
+			if (!stopped && best >= beta) // Refuted, the other children no longer matter
+			{
+				abort_jobs(jobs);
+				stopped = 1;
+			}
+		}
+		else if (!stopped && deadline > 0 && MPI_Wtime() >= deadline)
+		{
+			abort_jobs(jobs);
+			stopped = 1;
+			search_aborted = 1;
+		}
+		else
+		{
+			nanosleep(&pause, NULL);
+		}
+	}
+	PERF_END(PERF_MPI);
+	return best;
 }
 /**
-* @brief Returns the name of a game piece.
-*
-* @param piece The game piece identifier.
-* @return The name of the game piece.
-*/
-char nameof(int piece)
+ * @brief Solves a position on the master, watching the deadline.
+ *
+ * @param pos The position.
+ * @param alpha The lower end of the window.
+ * @param beta The upper end of the window.
+ * @param deadline The MPI_Wtime at which the solve stops and search_aborted is set, 0 for none.
+ * @param nodes The nodes searched, added to.
+ * @return The result for the side to move; meaningless once search_aborted is set.
+ */
+int solve_local(const Position *pos, int alpha, int beta, double deadline, long long *nodes)
 {
-	assert(0 <= piece && piece < 5);
-	return (piecenames[piece]);
+	double start = MPI_Wtime();
+
+	nodes_searched = 0;
+	node_limit = 0;
+	search_deadline = deadline;
+	search_poll = (deadline > 0) ? poll_clock : NULL;
+	poll_interval = config.poll_nodes;
+	next_poll = poll_interval;
+	int score = solve(pos, alpha, beta);
+	search_poll = NULL;
+	*nodes += nodes_searched;
+	rank_stats.search += MPI_Wtime() - start;
+	rank_stats.nodes += nodes_searched;
+	return score;
 }
 /**
-* @brief Counts the number of game pieces for a player on the game board.
-*
-* @param player The player identifier.
-* @param active_board The game board array.
-* @return The count of game pieces for the player.
-*/
-int count(int player, int *active_board)
-{
-	int i, cnt;
-	cnt = 0;
-	for (i = 1; i <= 88; i++)
-		if (active_board[i] == player)
-			cnt++;
-	return cnt;
-}
-/**
-* @brief Evaluates the game board for a player using a weighted gameboard with higher weights being more
-*        benifitial points on the board.
-*
-* @param player The player identifier.
-* @param active_board The game board array.
-* @return The score for the player.
-*/
-int evaluate(int player, int *active_board)
+ * @brief Tells every worker with an endgame job to stop it. Each still sends its reply, marked as aborted.
+ *
+ * @param jobs Per rank, the job it is solving, 0 if none.
+ */
+void abort_jobs(const int *jobs)
 {
-	int weights[100] = {    
-		0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-		0, 5, -3, 2, 2, 2, 2, -3, 5, 0,
-		0, -3, -4, -1, -1, -1, -1, -4, -3, 0,  // Weighed Board 
-		0, 2, -1, 1, 0, 0, 1, -1, 2, 0,
-		0, 2, -1, 0, 1, 1, 0, -1, 2, 0,
-		0, 2, -1, 0, 1, 1, 0, -1, 2, 0,
-		0, 2, -1, 1, 0, 0, 1, -1, 2, 0,
-		0, -3, -4, -1, -1, -1, -1, -4, -3, 0,
-		0, 5, -3, 2, 2, 2, 2, -3, 5, 0,
-		0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+	double start = MPI_Wtime();
 
-	int score = 0;
-	for (int i = 11; i <= 88; i++)
+	for (int i = 1; i < MPI_SIZE; i++)
 	{
-		if (active_board[i] == player)
-		{
-			score += weights[i]; // Adds Weight 
-		}
-		else if (active_board[i] == opponent(player, NULL))
+		if (jobs[i] != 0)
 		{
-			score -= weights[i]; // Subtracts Weight
+			int message[CONTROLMSGSIZE] = {ABORT_JOB, search_id, jobs[i], 0};
+			MPI_Send(message, CONTROLMSGSIZE, MPI_INT, i, CONTROL_TAG, MPI_COMM_WORLD);
 		}
 	}
-	return score;
+	rank_stats.comm += MPI_Wtime() - start;
+}
+/**
+ * @brief The workers' side of the endgame solver: solves the positions the master sends, one at a time, until
+ * 		  the master either ends the solve or sends work for the Alpha/Beta search, which is left to be received.
+ * 		  Control messages that arrive in between are handled as during a search.
+ *
+ * @param wait The MPI_Wtime since which this rank has been waiting, updated after each job.
+ * @return 1 if the master solved the position, 0 if an Alpha/Beta search follows.
+ */
+int serve_solve_jobs(double *wait)
+{
+	SolveJob job;
+	MPI_Status status;
+
+	for (;;)
+	{
+		MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status); // Work may come from a coordinator
+		if (status.MPI_TAG == WORK_TAG)
+		{
+			return 0;
+		}
+		if (status.MPI_TAG == CONTROL_TAG) // Late for a search or job that is over, or an abort not yet seen
+		{
+			PERF_END(PERF_MPI);
+			poll_control();
+			PERF_BEGIN(PERF_MPI);
+			continue;
+		}
+		double start = MPI_Wtime();
+		rank_stats.idle += start - *wait;
+		MPI_Recv(&job, sizeof(SolveJob), MPI_BYTE, ROOT, SOLVE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		if (job.job == SOLVE_DONE)
+		{
+			*wait = MPI_Wtime();
+			rank_stats.comm += *wait - start;
+			return 1;
+		}
+		PERF_END(PERF_MPI);
+
+		double comm = rank_stats.comm;
+		double search_start = MPI_Wtime();
+		rank_stats.comm += search_start - start;
+		search_id = job.search_id;
+		solve_job = job.job;
+		nodes_searched = 0;
+		node_limit = 0;
+		search_aborted = 0;
+		next_poll = poll_interval;
+		double trace_start = trace_now();
+		SolveReply reply = {job.job, solve(&job.position, job.alpha, job.beta), 0, 0};
+		trace_span(TRACE_SOLVE_JOB, search_id, trace_start);
+		reply.aborted = search_aborted;
+		reply.nodes = nodes_searched;
+		rank_stats.search += MPI_Wtime() - search_start - (rank_stats.comm - comm); // Less the polling
+		rank_stats.nodes += nodes_searched;
+		PERF_BEGIN(PERF_MPI);
+
+		double send_start = MPI_Wtime();
+		MPI_Send(&reply, sizeof(SolveReply), MPI_BYTE, ROOT, SOLVED_TAG, MPI_COMM_WORLD);
+		*wait = MPI_Wtime();
+		rank_stats.comm += *wait - send_start;
+	}
+}
+/**
+ * @brief Picks the best of the workers' results by their own scores: the highest score wins, then a result
+ * 		  that was not cut by another worker's bound, then the lowest square.
+ *
+ * @param results The results.
+ * @param count The number of results.
+ * @return The best result, NULL if no worker had a move.
+ */
+const SearchResult *best_result(const SearchResult *results, int count)
+{
+	const SearchResult *best = NULL;
+
+	for (int i = 0; i < count; i++)
+	{
+		const SearchResult *result = &results[i];
+		if (result->move == -1)
+		{
+			continue;
+		}
+		if (best == NULL || result->score > best->score ||
+			(result->score == best->score && (result->bounded < best->bounded ||
+											  (result->bounded == best->bounded && result->move < best->move))))
+		{
+			best = result;
+		}
+	}
+	return best;
+}
+/**
+ * @brief Sends a control message for the current search to every worker that has not reported yet.
+ *
+ * @param type ABORT_SEARCH or NEW_BOUND.
+ * @param depth The iteration depth of the bound.
+ * @param score The bound.
+ * @param finished Per rank, 1 if it has already reported.
+ */
+void send_control(int type, int depth, int score, const int *finished)
+{
+	int message[CONTROLMSGSIZE] = {type, search_id, depth, score};
+	double start = MPI_Wtime();
+
+	for (int i = 1; i < MPI_SIZE; i++)
+	{
+		if (!finished[i])
+		{
+			MPI_Send(message, CONTROLMSGSIZE, MPI_INT, i, CONTROL_TAG, MPI_COMM_WORLD);
+		}
+	}
+	rank_stats.comm += MPI_Wtime() - start;
+}
+/**
+ * @brief Search poll hook of the workers: receives every control message that has arrived, from the master or
+ * 		  a coordinator. Messages for an earlier search are dropped; an abort stops the current search, or the current endgame job if it names
+ * 		  that job, and a bound is kept if it is the best one so far.
+ */
+void poll_control(void)
+{
+	int flag;
+	int message[CONTROLMSGSIZE];
+	MPI_Status status;
+	double start = MPI_Wtime();
+
+	PERF_BEGIN(PERF_MPI);
+	MPI_Iprobe(MPI_ANY_SOURCE, CONTROL_TAG, MPI_COMM_WORLD, &flag, &status);
+	while (flag)
+	{
+		MPI_Recv(message, CONTROLMSGSIZE, MPI_INT, status.MPI_SOURCE, CONTROL_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		if (message[1] == search_id &&
+			(message[0] == ABORT_SEARCH || (message[0] == ABORT_JOB && message[2] == solve_job)))
+		{
+			search_aborted = 1;
+		}
+		else if (message[1] == search_id && message[0] == NEW_BOUND &&
+				 (message[2] > bound_depth || (message[2] == bound_depth && message[3] > search_bound)))
+		{
+			bound_depth = message[2];
+			search_bound = message[3];
+		}
+		MPI_Iprobe(MPI_ANY_SOURCE, CONTROL_TAG, MPI_COMM_WORLD, &flag, &status);
+	}
+	PERF_END(PERF_MPI);
+	rank_stats.comm += MPI_Wtime() - start;
+}
+/**
+ * @brief Search poll hook of the master when it searches alone: stops the search at search_deadline.
+ */
+void poll_clock(void)
+{
+	if (MPI_Wtime() >= search_deadline)
+	{
+		search_aborted = 1;
+	}
+}
+/**
+ * @brief Gathers every rank's time breakdown on the master, collectively, and prints one line per rank to
+ * 		  standard output:
+ * 		      # rank <r> search <s> comm <s> idle <s> nodes <n>
+ */
+void report_rank_stats(void)
+{
+	int rank;
+	double *all = NULL;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	if (rank == 0)
+	{
+		all = (double *)gather_buffer;
+	}
+	MPI_Gather(&rank_stats, RANKSTATSIZE, MPI_DOUBLE, all, RANKSTATSIZE, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	if (rank != 0)
+	{
+		return;
+	}
+	for (int i = 0; i < MPI_SIZE; i++)
+	{
+		RankStats *stats = (RankStats *)(all + i * RANKSTATSIZE);
+		printf("# rank %d search %.6f comm %.6f idle %.6f nodes %.0f\n", i, stats->search, stats->comm, stats->idle,
+			   stats->nodes);
+	}
+	fflush(stdout);
+}
+/**
+ * @brief Stops this rank's hardware counters and gathers every rank's on the master, collectively. The master
+ * 		  prints, per rank, one line per search phase, one for everything outside the phases and one for the
+ * 		  whole run to standard output:
+ * 		      # perf rank <r> <phase> calls <n> cycles <n> instructions <n> ipc <x> branch-misses <n> ...
+ */
+void report_perf_counters(void)
+{
+	int rank;
+	PerfCounts counts;
+	PerfCounts *all = NULL;
+	int counted = perf_counts(&counts) == SUCCESS;
+	int any_counted;
+
+	perf_close();
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	if (rank == 0)
+	{
+		all = (PerfCounts *)gather_buffer;
+	}
+	MPI_Reduce(&counted, &any_counted, 1, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+	MPI_Gather(&counts, sizeof(PerfCounts), MPI_BYTE, all, sizeof(PerfCounts), MPI_BYTE, 0, MPI_COMM_WORLD);
+	if (rank != 0)
+	{
+		return;
+	}
+	if (!any_counted)
+	{
+		printf("# perf counters unavailable: no PMU, or perf_event_paranoid forbids them\n");
+	}
+	for (int i = 0; i < MPI_SIZE && any_counted; i++)
+	{
+		uint64_t other[PERF_EVENTS];
+		for (int e = 0; e < PERF_EVENTS; e++)
+		{
+			other[e] = all[i].events[PERF_TOTAL][e];
+		}
+		for (int phase = 0; phase < PERF_PHASES; phase++)
+		{
+			print_perf_row(i, PERF_PHASENAMES[phase], all[i].calls[phase], all[i].events[phase]);
+			for (int e = 0; e < PERF_EVENTS; e++) // Multiplexed counters can make the phases exceed the total
+			{
+				other[e] = (other[e] > all[i].events[phase][e]) ? other[e] - all[i].events[phase][e] : 0;
+			}
+		}
+		print_perf_row(i, "other", 0, other);
+		print_perf_row(i, "total", 0, all[i].events[PERF_TOTAL]);
+	}
+	fflush(stdout);
+}
+/**
+ * @brief Prints one line of the hardware counter summary.
+ *
+ * @param rank The rank counted.
+ * @param name The phase.
+ * @param calls How often the phase was entered.
+ * @param events The count of each event.
+ */
+void print_perf_row(int rank, const char *name, uint64_t calls, const uint64_t *events)
+{
+	double ipc = events[PERF_CYCLES] ? (double)events[PERF_INSTRUCTIONS] / events[PERF_CYCLES] : 0.0;
+
+	printf("# perf rank %d %-7s calls %llu", rank, name, (unsigned long long)calls);
+	for (int e = 0; e < PERF_EVENTS; e++)
+	{
+		printf(" %s %llu", PERF_EVENTNAMES[e], (unsigned long long)events[e]);
+		if (e == PERF_INSTRUCTIONS)
+		{
+			printf(" ipc %.2f", ipc);
+		}
+	}
+	printf("\n");
+}
+/**
+ * @brief Sets up the selected engine on this rank. Every rank takes part, and if any rank cannot allocate its
+ * 		  MCTS node pool all of them fall back to the Alpha/Beta search. The master hands the network of --net
+ * 		  to the workers.
+ *
+ * @param rank The rank of the process.
+ * @param fp The file pointer, NULL on the workers.
+ * @return The engine in use.
+ */
+int initialise_engine(int rank, FILE *fp)
+{
+	int ok = 1;
+	int all_ok;
+
+	if (config.engine == MCTS_ENGINE)
+	{
+		ok = mcts_create(&tree, arena_alloc(&arena, mcts_pool_bytes(config.mcts_nodes)), config.mcts_nodes,
+						 config.mcts_exploration, config.mcts_puct, config.seed + rank) != FAILURE;
+	}
+	MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+	if (!all_ok)
+	{
+		if (fp != NULL)
+		{
+			fprintf(fp, "Could not allocate the MCTS node pools, using Alpha/Beta\n");
+			fflush(fp);
+		}
+		config.engine = ALPHABETA_ENGINE;
+	}
+	if (config.use_net) // Read on the master only
+	{
+		MPI_Bcast(&network, sizeof(Network), MPI_BYTE, ROOT, MPI_COMM_WORLD);
+		search_network = &network;
+		if (fp != NULL)
+		{
+			fprintf(fp, "Evaluating with the network, %s kernel\n", net_kernel());
+			fflush(fp);
+		}
+	}
+	return config.engine;
+}
+/**
+ * @brief Allocates the transposition table of the Alpha/Beta search, collectively on every rank. The ranks on
+ * 		  one node are grouped with MPI_Comm_split_type and allocate a single MPI_Win_allocate_shared window,
+ * 		  held by the first rank of the node, which all of them use as one table. In deterministic mode each
+ * 		  rank gets an equal, private part of the window instead.
+ *
+ * @param fp The file pointer, NULL on the workers.
+ */
+void initialise_table(FILE *fp)
+{
+	int node_rank;
+	int node_size;
+	int disp_unit;
+	MPI_Aint bytes;
+	void *memory;
+
+	search_table = NULL;
+	if (config.engine != ALPHABETA_ENGINE || config.tt_mb == 0)
+	{
+		return;
+	}
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+	MPI_Comm_rank(node_comm, &node_rank);
+	MPI_Comm_size(node_comm, &node_size);
+
+	bytes = (config.table_bytes > 0) ? (MPI_Aint)config.table_bytes * node_size : (MPI_Aint)config.tt_mb << 20;
+	table_share = bytes / node_size;
+	if (config.deterministic)
+	{
+		bytes = bytes / node_size;
+	}
+	else if (node_rank != 0)
+	{
+		bytes = 0;
+	}
+	MPI_Win_allocate_shared(bytes, 1, MPI_INFO_NULL, node_comm, &memory, &table_window);
+	if (!config.deterministic)
+	{
+		MPI_Win_shared_query(table_window, 0, &bytes, &disp_unit, &memory);
+	}
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, table_window); // Entries are then read and written directly
+	if (config.huge_pages && (config.deterministic || node_rank == 0))
+	{
+		arena_advise_huge(memory, bytes); // Before tt_clear first touches the pages
+	}
+
+	tt_attach(&table, memory, bytes);
+	if (config.deterministic || node_rank == 0)
+	{
+		tt_clear(&table);
+	}
+	MPI_Win_sync(table_window);
+	MPI_Barrier(node_comm);
+	search_table = &table;
+
+	if (fp != NULL)
+	{
+		fprintf(fp, "Transposition table: %lld entries %s %d ranks on this node\n",
+				(long long)(table.mask + 1) * TT_BUCKETSIZE, config.deterministic ? "for each of" : "shared by",
+				node_size);
+	}
+	if (config.tt_mode == DISTRIBUTED_TABLE && !config.deterministic) // Timing would decide what is found
+	{
+		MPI_Aint partition = (config.table_bytes > 0) ? config.table_bytes : ((MPI_Aint)config.tt_mb << 20) / node_size;
+		int created = dtt_create(partition, config.tt_remote_depth, &arena) != FAILURE;
+		remote_share = created ? partition : 0;
+		if (fp != NULL && created)
+		{
+			fprintf(fp, "Distributed table: %d ranks, probed %d or more plies from the frontier\n", MPI_SIZE,
+					config.tt_remote_depth);
+		}
+		else if (fp != NULL)
+		{
+			fprintf(fp, "Distributed table unavailable, using the node table only\n");
+		}
+	}
+	if (fp != NULL)
+	{
+		fflush(fp);
+	}
+}
+/**
+ * @brief Sets up the two-level split of --hierarchy, collectively on every rank. The ranks are grouped by node as
+ * 		  for the table, and every rank learns the first rank of each node. The master then weighs the ranks of
+ * 		  its own node 1 and each other node's first rank, its coordinator, by the ranks that search behind it;
+ * 		  a coordinator weighs the other ranks of its node 1, and they take their work from it. Turns the option
+ * 		  off where it does not apply: with one rank, MCTS or another board size.
+ *
+ * @param fp The file pointer, NULL on the workers.
+ */
+void initialise_hierarchy(FILE *fp)
+{
+	int rank;
+	int leader;
+	int local = 0;
+	int coordinators = 0;
+
+	work_source = ROOT;
+	node_workers = 0;
+	if (config.engine != ALPHABETA_ENGINE || config.board_size != BOARDSIDE || MPI_SIZE == 1)
+	{
+		config.hierarchy = 0; // The same on every rank
+	}
+	if (!config.hierarchy)
+	{
+		return;
+	}
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	if (node_comm == MPI_COMM_NULL) // No node table
+	{
+		MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+	}
+	leader = rank;
+	MPI_Bcast(&leader, 1, MPI_INT, 0, node_comm);
+
+	int *leaders = (int *)arena_alloc(&arena, MPI_SIZE * sizeof(int));
+	MPI_Allgather(&leader, 1, MPI_INT, leaders, 1, MPI_INT, MPI_COMM_WORLD);
+	memset(worker_weights, 0, MPI_SIZE * sizeof(int));
+	for (int i = 0; i < MPI_SIZE; i++)
+	{
+		worker_weights[leaders[i]]++; // Ranks per node, at its first rank
+	}
+	for (int i = 0; i < MPI_SIZE; i++) // Reads each count before it is replaced by a weight
+	{
+		if (rank == ROOT && leaders[i] == ROOT) // The master's own node
+		{
+			worker_weights[i] = (i != ROOT);
+			local += worker_weights[i];
+		}
+		else if (rank == ROOT && leaders[i] == i) // Searches its share itself when alone on its node
+		{
+			worker_weights[i] = max(worker_weights[i] - 1, 1);
+			coordinators++;
+		}
+		else
+		{
+			worker_weights[i] = (leaders[i] == rank && i != rank);
+			node_workers += worker_weights[i];
+		}
+	}
+	if (leader != ROOT && leader != rank)
+	{
+		work_source = leader;
+	}
+
+	if (fp != NULL)
+	{
+		fprintf(fp, "Hierarchy: %d ranks on the master's node, %d coordinators for the other nodes\n",
+				local, coordinators);
+		fflush(fp);
+	}
+}
+/**
+ * @brief Splits a --memory budget on the master, before the settings are broadcast. BASERESERVE and the
+ * 		  master's arena, the largest of any rank's, come off the top; the rest goes to the MCTS node pools or,
+ * 		  per rank, to the tables.
+ *
+ * @param server 1 in server mode, where the master keeps a log buffer for every game.
+ * @return SUCCESS, or FAILURE if the budget does not even cover the fixed part.
+ */
+int plan_memory(int server)
+{
+	long long budget = (long long)config.memory_mb << 20;
+	long long rest = budget - BASERESERVE - (long long)arena_bytes(1, server, 0);
+
+	config.table_bytes = 0;
+	if (config.memory_mb <= 0)
+	{
+		return SUCCESS;
+	}
+	if (config.engine == MCTS_ENGINE)
+	{
+		long long nodes = (rest - ARENA_ALIGN) / (long long)mcts_pool_bytes(1);
+		config.mcts_nodes = (nodes < 0) ? 0 : (nodes > INT_MAX) ? INT_MAX : (int)nodes;
+		rest = (config.mcts_nodes >= 2 * LEGALMOVSBUFSIZE) ? rest : -1;
+	}
+	else if (config.tt_mb > 0 && config.tt_mode == DISTRIBUTED_TABLE && !config.deterministic)
+	{
+		config.table_bytes = (rest - (long long)dtt_arena_bytes(MPI_SIZE)) / 2; // The node table and the partition
+	}
+	else if (config.tt_mb > 0)
+	{
+		config.table_bytes = rest;
+	}
+	if (rest < 0 || config.table_bytes < 0)
+	{
+		fprintf(stderr, "A budget of %d MB per rank does not cover the %lld MB every rank needs\n", config.memory_mb,
+				(BASERESERVE + (long long)arena_bytes(1, server, 0)) >> 20);
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+/**
+ * @brief The size of a rank's arena: the buffers per worker, the MCTS statistics and node pools, the
+ * 		  distributed table's queues and, on the master, the gather buffer and the log buffers.
+ *
+ * @param master 1 for the master.
+ * @param server 1 in server mode.
+ * @param with_pool 1 to count the MCTS node pools.
+ * @return The bytes.
+ */
+size_t arena_bytes(int master, int server, int with_pool)
+{
+	size_t bytes = arena_block_size(MPI_SIZE * sizeof(SearchResult)) + 4 * arena_block_size(MPI_SIZE * sizeof(int));
+
+	if (config.engine == MCTS_ENGINE)
+	{
+		bytes += arena_block_size(6 * mcts_statistics_size(config.mcts_share) * sizeof(double));
+		bytes += with_pool ? arena_block_size(mcts_pool_bytes(config.mcts_nodes)) : 0;
+	}
+	if (config.engine == ALPHABETA_ENGINE && config.tt_mb > 0 && config.tt_mode == DISTRIBUTED_TABLE &&
+		!config.deterministic)
+	{
+		bytes += dtt_arena_bytes(MPI_SIZE);
+	}
+	if (config.hierarchy)
+	{
+		bytes += arena_block_size(MPI_SIZE * sizeof(int)); // Every rank's node, while the split is set up
+	}
+	if (config.trace)
+	{
+		bytes += trace_arena_bytes(master);
+	}
+	if (master)
+	{
+		size_t row = max(max(RANKSTATSIZE, MEMSTATSIZE) * sizeof(double), sizeof(PerfCounts));
+		bytes += arena_block_size(MPI_SIZE * row) + arena_block_size((server ? MAXGAMES : 1) * LOGBUFSIZE);
+	}
+	return bytes;
+}
+/**
+ * @brief Reserves this rank's arena and takes the buffers every search uses from it. The engine and the
+ * 		  distributed table take their memory from what is left. Does nothing if the arena exists; stops every
+ * 		  rank if it cannot be reserved.
+ *
+ * @param rank The rank of the process.
+ * @param server 1 in server mode.
+ */
+void initialise_memory(int rank, int server)
+{
+	size_t bytes = arena_bytes(rank == ROOT, server, 1);
+
+	if (arena.base != NULL)
+	{
+		return;
+	}
+	if (arena_create(&arena, bytes, config.huge_pages) == FAILURE)
+	{
+		fprintf(stderr, "Rank %d: could not reserve %zu bytes\n", rank, bytes);
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	worker_results = (SearchResult *)arena_alloc(&arena, MPI_SIZE * sizeof(SearchResult));
+	worker_flags = (int *)arena_alloc(&arena, MPI_SIZE * sizeof(int));
+	worker_jobs = (int *)arena_alloc(&arena, MPI_SIZE * sizeof(int));
+	worker_children = (int *)arena_alloc(&arena, MPI_SIZE * sizeof(int));
+	worker_weights = (int *)arena_alloc(&arena, MPI_SIZE * sizeof(int));
+	if (config.engine == MCTS_ENGINE)
+	{
+		share_buffer = (double *)arena_alloc(&arena, 6 * mcts_statistics_size(config.mcts_share) * sizeof(double));
+	}
+	if (rank == ROOT)
+	{
+		size_t row = max(max(RANKSTATSIZE, MEMSTATSIZE) * sizeof(double), sizeof(PerfCounts));
+		gather_buffer = arena_alloc(&arena, MPI_SIZE * row);
+		log_buffers = (char *)arena_alloc(&arena, (server ? MAXGAMES : 1) * LOGBUFSIZE);
+	}
+}
+/**
+ * @brief Gathers what every rank reserved and how much of it was resident on the master, collectively, and
+ * 		  prints one line per rank to standard output:
+ * 		      # memory rank <r> arena <used>/<size> table <b> remote <b> private <b> peak <b> budget <b>
+ * 		  A rank is marked "exceeded" if what it reserved and holds privately, or its peak resident size, is
+ * 		  larger than the budget.
+ */
+void report_memory(void)
+{
+	int rank;
+	double *all = NULL;
+	double mine[MEMSTATSIZE] = {arena.used, arena.size, table_share, remote_share, status_bytes("RssAnon:"),
+								status_bytes("VmHWM:"), (double)((long long)config.memory_mb << 20)};
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	if (rank == 0)
+	{
+		all = (double *)gather_buffer;
+	}
+	MPI_Gather(mine, MEMSTATSIZE, MPI_DOUBLE, all, MEMSTATSIZE, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	if (rank != 0 || all == NULL)
+	{
+		return;
+	}
+	for (int i = 0; i < MPI_SIZE; i++)
+	{
+		double *stats = all + i * MEMSTATSIZE;
+		printf("# memory rank %d arena %.0f/%.0f table %.0f remote %.0f private %.0f peak %.0f budget %.0f%s\n", i,
+			   stats[0], stats[1], stats[2], stats[3], stats[4], stats[5], stats[6],
+			   (stats[2] + stats[3] + stats[4] > stats[6] || stats[5] > stats[6]) ? " exceeded" : "");
+	}
+	fflush(stdout);
+}
+/**
+ * @brief Reads one memory figure of this process from /proc/self/status.
+ *
+ * @param field The field with its colon, such as "VmHWM:" for the peak resident size or "RssAnon:" for the
+ * 				resident memory that is not shared.
+ * @return The bytes, 0 if /proc or the field is not available.
+ */
+long long status_bytes(const char *field)
+{
+	char line[BENCHLINEBUFSIZE];
+	long long kilobytes = 0;
+	FILE *status = fopen("/proc/self/status", "r");
+
+	while (status != NULL && fgets(line, BENCHLINEBUFSIZE, status) != NULL)
+	{
+		if (strncmp(line, field, strlen(field)) == 0)
+		{
+			kilobytes = atoll(line + strlen(field));
+			break;
+		}
+	}
+	if (status != NULL)
+	{
+		fclose(status);
+	}
+	return kilobytes << 10;
+}
+/**
+ * @brief Root-parallel MCTS, run by every rank at once. Each rank grows its own tree from the current
+ * 		  position, reusing the subtree kept from the previous move. Every config.mcts_sync playouts the ranks
+ * 		  optionally share the statistics of their top tree levels, the master sums the root statistics with
+ * 		  MPI_Reduce, and the master decides whether there is time for another round (or, in deterministic
+ * 		  mode, whether the playout budget is spent). The move with the most visits over all ranks is played.
+ *
+ * @param fp The file pointer, NULL on the workers and in analysis.
+ * @param result Filled in on the master if not NULL: the move, the win rate in thousandths and the playouts.
+ * @return Returns the best move on the master, -1 to pass.
+ */
+int mcts_strategy(FILE *fp, SearchResult *result)
+{
+	double start = MPI_Wtime();
+	int rank;
+	int moves[LEGALMOVSBUFSIZE];
+	int searching = 1;
+	int rounds = 0;
+	int share_size = mcts_statistics_size(config.mcts_share);
+	double root_visits[MCTS_SLOTS], root_wins[MCTS_SLOTS];
+	double total_visits[MCTS_SLOTS], total_wins[MCTS_SLOTS];
+	double *base_visits = NULL;
+	double *base_wins = NULL;
+	long long playouts = 0;
+
+	if (legal_moves(&current_position, moves) == 0)
+	{
+		return -1; // Nothing to think about when we have to pass, on any rank
+	}
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	mcts_set_root(&tree, &current_position);
+	uint32_t kept = tree.nodes[0].visits;
+	if (config.mcts_share > 0)
+	{
+		base_visits = share_buffer;
+		base_wins = base_visits + share_size;
+		mcts_gather(&tree, config.mcts_share, base_visits, base_wins);
+	}
+
+	while (searching)
+	{
+		for (int i = 0; i < config.mcts_sync; i++)
+		{
+			mcts_iterate(&tree);
+		}
+		rounds++;
+		if (config.mcts_share > 0)
+		{
+			share_statistics(base_visits, base_wins);
+		}
+
+		mcts_gather(&tree, 1, root_visits, root_wins);
+		MPI_Reduce(root_visits, total_visits, MCTS_SLOTS, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+		MPI_Reduce(root_wins, total_wins, MCTS_SLOTS, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+		if (rank == 0)
+		{
+			if (config.deterministic || config.move_time == 0)
+				searching = (long long)rounds * config.mcts_sync < config.node_budget;
+			else
+				searching = MPI_Wtime() - start < config.move_time;
+		}
+		MPI_Bcast(&searching, 1, MPI_INT, 0, MPI_COMM_WORLD); // Broadcast whether to keep searching
+	}
+
+	MPI_Reduce(&tree.playouts, &playouts, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+	if (rank != 0)
+	{
+		return -1;
+	}
+
+	if (config.mcts_share > 0) // Every tree already holds the shared visits, so the sum counts them once per rank
+	{
+		for (int move = 0; move < MCTS_SLOTS; move++)
+		{
+			total_visits[move] /= MPI_SIZE;
+			total_wins[move] /= MPI_SIZE;
+		}
+	}
+	int best_move = -1;
+	for (int move = 0; move < MCTS_SLOTS; move++)
+	{
+		if (total_visits[move] > 0 && (best_move == -1 || total_visits[move] > total_visits[best_move]))
+		{
+			best_move = move;
+		}
+	}
+	if (result != NULL)
+	{
+		result->move = (best_move == MCTS_PASS) ? -1 : best_move;
+		result->score = (best_move == -1) ? 0 : (int)(1000 * total_wins[best_move] / total_visits[best_move] + 0.5);
+		result->nodes = playouts;
+		result->pv[0] = result->move;
+		result->pv_length = (result->move == -1) ? 0 : 1;
+	}
+	if (fp == NULL)
+	{
+		return (best_move == MCTS_PASS) ? -1 : best_move;
+	}
+	double elapsed = MPI_Wtime() - start;
+	fprintf(fp, "MCTS: %d ranks, %lld playouts in %.3fs (%.0f/s), %d rounds, %u visits reused, %d of %d nodes used\n",
+			MPI_SIZE, playouts, elapsed, playouts / elapsed, rounds, kept, tree.used, tree.capacity);
+	if (best_move != -1)
+	{
+		fprintf(fp, "MCTS: best move %d with %.0f visits, win rate %.3f\n", best_move, total_visits[best_move],
+				total_wins[best_move] / total_visits[best_move]);
+	}
+	fflush(fp);
+	return (best_move == MCTS_PASS) ? -1 : best_move;
+}
+/**
+ * @brief Shares the statistics of the top tree levels between all ranks. Each rank contributes what it added
+ * 		  since the last share, the contributions are summed with MPI_Allreduce, and each rank adds the other
+ * 		  ranks' part to its own tree.
+ *
+ * @param base_visits The visits of the shared levels right after the last share, updated.
+ * @param base_wins The wins of the shared levels right after the last share, updated.
+ */
+void share_statistics(double *base_visits, double *base_wins)
+{
+	int size = mcts_statistics_size(config.mcts_share);
+	double *buffer = share_buffer + 2 * size; // After the base visits and wins
+	double *delta = buffer;				 // visits then wins added by this rank
+	double *total = buffer + 2 * size; // visits then wins added by all ranks
+
+	mcts_gather(&tree, config.mcts_share, delta, delta + size);
+	for (int i = 0; i < 2 * size; i++)
+	{
+		delta[i] -= base_visits[i]; // base_wins directly follows base_visits
+	}
+	MPI_Allreduce(delta, total, 2 * size, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	for (int i = 0; i < 2 * size; i++)
+	{
+		total[i] -= delta[i];
+	}
+	mcts_add(&tree, config.mcts_share, total, total + size);
+	mcts_gather(&tree, config.mcts_share, base_visits, base_wins);
+}
+/**
+ * @brief Searches every position of a benchmark file on this rank alone and reports the nodes searched and the
+ * 		  time taken for each, so that engine changes can be measured and profile-guided builds trained without a
+ * 		  referee. The seed defaults to 1 so that runs repeat.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv "--bench", the file of positions written by position_to_string, then any search options.
+ * @return SUCCESS, or FAILURE if the options or the file could not be used.
+ */
+int run_bench(int argc, char *argv[])
+{
+	char line[BENCHLINEBUFSIZE];
+	char move[MOVEBUFSIZE];
+	int moves[MAILBOX_MOVESBUFSIZE]; // enough for any board
+	int count = 0;
+	int line_number = 0;
+	long long total_nodes = 0;
+	FILE *in;
+
+	default_config(&config);
+	config.seed = 1;
+	if (parse_options(argc - 3, argv + 3, &config) == FAILURE || plan_memory(0) == FAILURE)
+	{
+		fprintf(stderr, "Arguments: --bench <file> [search options]\n");
+		return FAILURE;
+	}
+	rng_state = config.seed;
+	initialise_memory(ROOT, 0);
+	search_network = config.use_net ? &network : NULL;
+	if (config.engine == ALPHABETA_ENGINE && config.tt_mb > 0)
+	{
+		size_t bytes = (config.table_bytes > 0) ? (size_t)config.table_bytes : (size_t)config.tt_mb << 20;
+		if (arena_create(&bench_table, bytes, config.huge_pages) != FAILURE && tt_attach(&table, bench_table.base, bytes) != 0)
+		{
+			tt_clear(&table);
+			search_table = &table;
+			table_share = bytes;
+		}
+	}
+	if (config.engine == MCTS_ENGINE &&
+		mcts_create(&tree, arena_alloc(&arena, mcts_pool_bytes(config.mcts_nodes)), config.mcts_nodes,
+					config.mcts_exploration, config.mcts_puct, config.seed) == FAILURE)
+	{
+		fprintf(stderr, "Could not allocate the MCTS node pool\n");
+		return FAILURE;
+	}
+	in = fopen(argv[2], "r");
+	if (in == NULL)
+	{
+		fprintf(stderr, "File %s could not be opened\n", argv[2]);
+		return FAILURE;
+	}
+
+	double start = MPI_Wtime();
+	while (fgets(line, BENCHLINEBUFSIZE, in) != NULL)
+	{
+		Position pos;
+		SearchResult result = {-1, 0, 0, 0, 0, {0, 0, 0}, 0};
+		line_number++;
+		if (line[0] == '#' || line[0] == '\n')
+		{
+			continue;
+		}
+		MailboxPosition board;
+		if (strcspn(line, " \n") != PLAYABLESQUARES && mailbox_from_string(line, &board) != FAILURE) // Another size
+		{
+			if (mailbox_legal_moves(&board, moves) > 0)
+			{
+				total_nodes += bench_mailbox(&board, ++count);
+			}
+			continue;
+		}
+		if (position_from_string(line, &pos) == FAILURE)
+		{
+			fprintf(stderr, "%s:%d: not a position\n", argv[2], line_number);
+			continue;
+		}
+		int n = legal_moves(&pos, moves);
+		if (n == 0)
+		{
+			continue; // Nothing to search
+		}
+
+		double position_start = MPI_Wtime();
+		if (config.engine == MCTS_ENGINE)
+		{
+			mcts_set_root(&tree, &pos);
+			long long before = tree.playouts;
+			for (long long i = 0; i < config.node_budget; i++)
+			{
+				mcts_iterate(&tree);
+			}
+			result.move = mcts_best_move(&tree);
+			result.nodes = tree.playouts - before;
+		}
+		else
+		{
+			search_root(&pos, moves, n, pos.to_move, &result);
+		}
+		total_nodes += result.nodes;
+		count++;
+
+		get_move_string(result.move, move);
+		move[2] = 0;
+		printf("%3d  %2d empties  move %s  score %6d  depth %2d  %10lld nodes  %.3fs\n", count, pos.empties, move,
+			   result.score, result.depth, result.nodes, MPI_Wtime() - position_start);
+	}
+	fclose(in);
+
+	double elapsed = MPI_Wtime() - start;
+	printf("Total: %d positions, %lld nodes in %.3fs (%.0f nodes/s)\n", count, total_nodes, elapsed,
+		   elapsed > 0 ? total_nodes / elapsed : 0.0);
+	fflush(stdout);
+	return SUCCESS;
+}
+/**
+ * @brief Solves a bench position on a board other than 8x8 exactly, move by move, and prints it like the
+ * 		  others, with the board size in place of the depth.
+ *
+ * @param pos The position, with at least one move.
+ * @param number The position's number in the bench.
+ * @return The nodes searched.
+ */
+long long bench_mailbox(const MailboxPosition *pos, int number)
+{
+	char move[MOVEBUFSIZE];
+	int moves[MAILBOX_MOVESBUFSIZE];
+	int amount_of_moves = mailbox_legal_moves(pos, moves);
+	int alpha = -pos->size * pos->size - 1; // below any disc difference
+	int best_move = moves[0];
+	double start = MPI_Wtime();
+
+	nodes_searched = 0;
+	node_limit = 0;
+	search_aborted = 0;
+	search_poll = NULL;
+	for (int i = 0; i < amount_of_moves; i++)
+	{
+		MailboxPosition child = *pos;
+		mailbox_make_move(&child, moves[i]);
+		int score = -mailbox_solve(&child, -pos->size * pos->size - 1, -alpha);
+		if (score > alpha)
+		{
+			alpha = score;
+			best_move = moves[i];
+		}
+	}
+	move_to_string(best_move, pos->size, move);
+	move[strcspn(move, "\n")] = 0;
+	printf("%3d  %2d empties  move %s  score %6d  solved %dx%d  %10lld nodes  %.3fs\n", number, pos->empties, move,
+		   alpha, pos->size, pos->size, nodes_searched, MPI_Wtime() - start);
+	return nodes_searched;
+}
+/**
+ * @brief Searches every position of a file, or of standard input, on all ranks and prints the best move, its
+ * 		  score, the depth reached, the nodes searched and the principal variation of each, so that test suites
+ * 		  run without a referee. The workers run run_worker as in a game.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv "--analyse", the file of positions written by position_to_string or "-", then any search options.
+ * @return SUCCESS, or FAILURE if the options or the file could not be used.
+ */
+int run_analysis(int argc, char *argv[])
+{
+	char line[BENCHLINEBUFSIZE];
+	int moves[LEGALMOVSBUFSIZE];
+	int running = 0;
+	int line_number = 0;
+	FILE *in = NULL;
+
+	default_config(&config);
+	if (parse_options(argc - 3, argv + 3, &config) == FAILURE || plan_memory(0) == FAILURE)
+	{
+		fprintf(stderr, "Arguments: --analyse <file|-> [search options]\n");
+	}
+	else if (strcmp(argv[2], "-") == 0)
+	{
+		in = stdin;
+	}
+	else if ((in = fopen(argv[2], "r")) == NULL)
+	{
+		fprintf(stderr, "File %s could not be opened\n", argv[2]);
+	}
+	running = (in != NULL);
+	config.board_size = BOARDSIDE; // Analysis is 8x8 only
+
+	MPI_Bcast(&config, sizeof(SearchConfig), MPI_BYTE, 0, MPI_COMM_WORLD); // Broadcast search settings
+	rng_state = config.seed;
+	initialise_memory(ROOT, 0);
+	initialise_engine(ROOT, NULL);
+	initialise_table(NULL);
+	initialise_hierarchy(NULL);
+	if (config.trace)
+	{
+		trace_open(&arena);
+	}
+
+	while (running && fgets(line, BENCHLINEBUFSIZE, in) != NULL)
+	{
+		SearchResult best = {-1, 0, 0, 0, 0, {0, 0, 0}, 0};
+		line_number++;
+		if (line[0] == '#' || line[0] == '\n')
+		{
+			continue;
+		}
+		if (position_from_string(line, &current_position) == FAILURE)
+		{
+			fprintf(stderr, "%s:%d: not a position\n", argv[2], line_number);
+			continue;
+		}
+
+		double start = MPI_Wtime();
+		if (legal_moves(&current_position, moves) > 0) // Nothing to search when the side to move must pass
+		{
+			MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD);				 // Broadcast running
+			MPI_Bcast(&current_position, 1, position_type, 0, MPI_COMM_WORLD); // Broadcast position
+			if (config.engine == MCTS_ENGINE)
+			{
+				mcts_strategy(NULL, &best);
+			}
+			else
+			{
+				search_move(&current_position, &best, NULL); // The move a game would play
+			}
+		}
+		print_result(stdout, &current_position, &best, MPI_Wtime() - start);
+	}
+	if (in != NULL && in != stdin)
+	{
+		fclose(in);
+	}
+
+	running = 0;
+	MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD); // Broadcast running (DONE)
+	return (in != NULL) ? SUCCESS : FAILURE;
+}
+/**
+ * @brief Prints one line of analysis: the position, then the move, score, depth, nodes, seconds and principal
+ * 		  variation.
+ *
+ * @param out The stream to print to.
+ * @param pos The position searched.
+ * @param result What the search found.
+ * @param elapsed The seconds the search took.
+ */
+void print_result(FILE *out, const Position *pos, const SearchResult *result, double elapsed)
+{
+	char position[POSITIONSTRLEN];
+	char move[MOVEBUFSIZE];
+
+	position_to_string(pos, position);
+	get_move_string(result->move, move);
+	move[2] = 0;
+	fprintf(out, "%s move %s score %d depth %d nodes %lld time %.3f", position, (result->move == -1) ? "pass" : move,
+			result->score, result->depth, result->nodes, elapsed);
+	if (result->solved)
+	{
+		fprintf(out, (result->solved == SOLVED_EXACT) ? " solved exact" : " solved wld");
+	}
+	fprintf(out, " pv");
+	for (int i = 0; i < result->pv_length; i++)
+	{
+		get_move_string(result->pv[i], move);
+		move[2] = 0;
+		fprintf(out, " %s", (result->pv[i] == -1) ? "pass" : move);
+	}
+	fprintf(out, "\n");
+	fflush(out);
+}
+/**
+ * @brief Plays many games at once for referees that connect to a port. The master polls the listening socket
+ * 		  and every connection, reads whatever the referees have sent, and then searches the waiting move with
+ * 		  the earliest deadline on all ranks, which run run_worker as in a single game. The engine and the
+ * 		  transposition table are set up once and kept for every game.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv "--serve", the port, the time limit per move, the prefix of the game logs and the number of games
+ * 			   to play (0 for no limit), then any search options.
+ * @return SUCCESS, or FAILURE if the arguments or the port could not be used.
+ */
+int run_server(int argc, char *argv[])
+{
+	Game games[MAXGAMES];
+	struct pollfd fds[MAXGAMES + 1];
+	int slots[MAXGAMES + 1]; // game of each entry of fds
+	int listener = FAILURE;
+	int running = 0;
+	int accepted = 0;
+	int finished = 0;
+	int limit = 0;
+	double move_time;
+
+	default_config(&config);
+	if (argc < 6 || parse_options(argc - 6, argv + 6, &config) == FAILURE || plan_memory(1) == FAILURE)
+	{
+		fprintf(stderr, "Arguments: --serve <port> <time_limit> <log_prefix> <games> [search options]\n");
+	}
+	else if ((listener = comms_listen(atoi(argv[2]))) == FAILURE)
+	{
+		fprintf(stderr, "Could not listen on port %s\n", argv[2]);
+	}
+	else
+	{
+		running = 1;
+		limit = atoi(argv[5]);
+		if (config.move_time == 0)
+		{
+			config.move_time = MOVETIMEFRACTION * atoi(argv[3]);
+		}
+	}
+	move_time = config.move_time;
+	config.board_size = BOARDSIDE; // The server plays 8x8 games only
+	signal(SIGPIPE, SIG_IGN); // A referee that hangs up only ends its own game
+
+	MPI_Bcast(&config, sizeof(SearchConfig), MPI_BYTE, 0, MPI_COMM_WORLD); // Broadcast search settings
+	rng_state = config.seed;
+	initialise_memory(ROOT, 1);
+	initialise_engine(ROOT, NULL);
+	initialise_table(NULL);
+	initialise_hierarchy(NULL);
+	if (config.trace)
+	{
+		trace_open(&arena);
+	}
+	for (int i = 0; i < MAXGAMES; i++)
+	{
+		games[i].fd = -1;
+		games[i].log_buffer = log_buffers + i * LOGBUFSIZE;
+	}
+
+	while (running)
+	{
+		int count = 0;
+		int waiting = 0;
+		int next = -1;
+
+		/* Poll the listener while there is room for another game, and every connection; do not block while a
+		   move is waiting */
+		for (int i = 0; i < MAXGAMES; i++)
+		{
+			if (games[i].fd != -1)
+			{
+				fds[count].fd = games[i].fd;
+				fds[count].events = POLLIN;
+				slots[count++] = i;
+				waiting += games[i].waiting;
+			}
+		}
+		if (count < MAXGAMES && (limit == 0 || accepted < limit))
+		{
+			fds[count].fd = listener;
+			fds[count].events = POLLIN;
+			slots[count++] = -1;
+		}
+		int ready = poll(fds, count, waiting ? 0 : -1);
+		if (ready < 0)
+		{
+			continue; // Interrupted
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			if (fds[i].revents == 0)
+			{
+				continue;
+			}
+			if (slots[i] == -1) // A new referee
+			{
+				int fd = accept(listener, NULL, NULL);
+				for (int j = 0; j < MAXGAMES && fd != -1; j++)
+				{
+					if (games[j].fd == -1)
+					{
+						games[j].fd = fd;
+						games[j].colour = EMPTY;
+						games[j].number = accepted++;
+						games[j].waiting = 0;
+						games[j].fp = NULL;
+						initialise_position(&games[j].position);
+						break;
+					}
+				}
+			}
+			else if (serve_referee(&games[slots[i]], argv[4], move_time) == FAILURE) // Game over or hung up
+			{
+				close_game(&games[slots[i]]);
+				finished++;
+			}
+		}
+		if (limit != 0 && finished >= limit)
+		{
+			running = 0; // The last game ended while reading, and nothing more will arrive
+			break;
+		}
+		if (ready > 0)
+		{
+			continue; // Read everything that has arrived before searching, so that each gen_move is timed from then
+		}
+
+		waiting = 0;
+		for (int i = 0; i < MAXGAMES; i++)
+		{
+			if (games[i].fd != -1 && games[i].waiting)
+			{
+				waiting++;
+				if (next == -1 || games[i].deadline < games[next].deadline)
+				{
+					next = i;
+				}
+			}
+		}
+		if (next != -1 && serve_move(&games[next], waiting) == FAILURE)
+		{
+			close_game(&games[next]);
+			finished++;
+		}
+		if (limit != 0 && finished >= limit)
+		{
+			running = 0;
+		}
+	}
+
+	for (int i = 0; i < MAXGAMES; i++)
+	{
+		if (games[i].fd != -1)
+		{
+			close_game(&games[i]);
+		}
+	}
+	if (listener != FAILURE)
+	{
+		close(listener);
+	}
+	MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD); // Broadcast running (DONE)
+	return (listener != FAILURE) ? SUCCESS : FAILURE;
+}
+/**
+ * @brief Reads one message from a game's referee: first the colour, which opens the game's log, then commands.
+ * 		  A gen_move only marks the game as waiting; the move is searched by serve_move.
+ *
+ * @param game The game.
+ * @param log_prefix The prefix of the game logs.
+ * @param move_time The seconds a move may take from the gen_move on.
+ * @return SUCCESS, or FAILURE when the game is over or the connection failed.
+ */
+int serve_referee(Game *game, const char *log_prefix, double move_time)
+{
+	char cmd[CMDBUFSIZE];
+	char opponent_move[MOVEBUFSIZE];
+	char path[LOGPATHBUFSIZE];
+
+	if (game->colour == EMPTY)
+	{
+		snprintf(path, LOGPATHBUFSIZE, "%s.%d", log_prefix, game->number);
+		if (comms_get_colour_fd(game->fd, &game->colour) == FAILURE || (game->fp = fopen(path, "w")) == NULL)
+		{
+			return FAILURE;
+		}
+		setvbuf(game->fp, game->log_buffer, _IOFBF, LOGBUFSIZE);
+		if (game->colour != WHITE)
+		{
+			game->colour = BLACK;
+		}
+		fprintf(game->fp, "Game %d, playing %s\n", game->number, (game->colour == WHITE) ? "white" : "black");
+		fflush(game->fp);
+		return SUCCESS;
+	}
+
+	if (comms_get_cmd_fd(game->fd, cmd, opponent_move) == FAILURE)
+	{
+		fprintf(game->fp, "Error getting cmd\n");
+		return FAILURE;
+	}
+	if (strcmp(cmd, "game_over") == 0)
+	{
+		fprintf(game->fp, "Game over\n");
+		return FAILURE;
+	}
+	else if (strcmp(cmd, "gen_move") == 0)
+	{
+		game->waiting = 1;
+		game->deadline = MPI_Wtime() + move_time;
+	}
+	else if (strcmp(cmd, "play_move") == 0)
+	{
+		apply_opp_move(opponent_move, game->colour, game->fp, &game->position);
+		print_board(game->fp, &game->position);
+	}
+	else
+	{
+		fprintf(game->fp, "Received unknown command from referee\n");
+	}
+	fflush(game->fp);
+	return SUCCESS;
+}
+/**
+ * @brief Searches the move a game is waiting for on all ranks and sends it. The search gets an equal share of
+ * 		  the time left before the game's deadline among the waiting moves, so that moves queued behind it still
+ * 		  make their own deadlines.
+ *
+ * @param game The game.
+ * @param waiting The number of games waiting for a move, this one included.
+ * @return SUCCESS, or FAILURE if the move could not be sent.
+ */
+int serve_move(Game *game, int waiting)
+{
+	char my_move[MOVEBUFSIZE];
+	int running = 1;
+	double share = (game->deadline - MPI_Wtime()) / waiting;
+
+	config.move_time = (share > MINMOVETIME) ? share : MINMOVETIME; // Only the master keeps time
+	current_position = game->position;
+	if (current_position.to_move != game->colour) // The opponent passed without telling us
+	{
+		make_pass(&current_position);
+	}
+
+	MPI_Bcast(&running, 1, MPI_INT, 0, MPI_COMM_WORLD);				 // Broadcast running
+	MPI_Bcast(&current_position, 1, position_type, 0, MPI_COMM_WORLD); // Broadcast position
+	gen_move_master(my_move, game->colour, game->fp, &current_position);
+	print_board(game->fp, &current_position);
+
+	game->position = current_position;
+	game->waiting = 0;
+	if (comms_send_move_fd(game->fd, my_move) == FAILURE)
+	{
+		fprintf(game->fp, "Move send failed\n");
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+/**
+ * @brief Closes a game's connection and log and frees its slot.
+ *
+ * @param game The game.
+ */
+void close_game(Game *game)
+{
+	close(game->fd);
+	if (game->fp != NULL)
+	{
+		fclose(game->fp);
+	}
+	game->fd = -1;
+}
+/**
+Writes text to a file.
+
+- @param filename The name of the file to write to.
+- @param text The text to be written to the file.
+*/
+void writeToFile(char *filename, char *text)
+{
+	FILE *dfp;
+	dfp = fopen(filename, "a");
+	fprintf(dfp, "%s", text);
+	fclose(dfp);
 }
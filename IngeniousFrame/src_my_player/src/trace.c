@@ -0,0 +1,244 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Spans of where the time of a turn goes, on every rank, written at the
+ *    end as a Chrome trace-event file (chrome://tracing or Perfetto) with
+ *    one row per rank.
+ *
+ *    Every rank reads its own monotonic clock. When the trace is opened the
+ *    master times TRACE_PINGS round trips to each rank and keeps the offset
+ *    of the shortest, so that every span is recorded on the master's clock.
+ *    Spans go into a buffer taken from the rank's arena; once it is full
+ *    further spans are only counted. If any rank's buffers do not fit,
+ *    tracing stays off on every rank. At the end the master gathers each
+ *    rank's spans in turn and streams them to the file.
+ *
+ *H***********************************************************************/
+
+#include <stdio.h>
+#include <time.h>
+#include <mpi.h>
+#include "arena.h"
+#include "board.h"
+#include "trace.h"
+
+double trace_clock(void);
+void trace_write_events(FILE *fp, const TraceEvent *events, int count, int rank, int *first);
+
+const char *trace_names[TRACE_KINDS] = {"turn", "comms_get_cmd", "MPI_Bcast", "gen_move_master", "solve_endgame",
+										"dispatch", "collect", "print_board", "comms_send_move",
+										"receive work", "search_root", "send result", "solve job", "coordinate"};
+const char *trace_ids[TRACE_KINDS] = {"turn", "turn", "turn", "turn", "search", "search", "search",
+									  "turn", "turn", "search", "search", "search", "search", "search"};
+
+TraceEvent *trace_events;	 // this rank's spans, NULL while tracing is off
+TraceEvent *trace_received; // another rank's spans, on the master while it writes them
+int trace_count;			 // spans recorded
+long long trace_dropped;	 // spans that did not fit
+double trace_offset;		 // to add to this rank's clock to read the master's
+double trace_origin;		 // master's clock when the trace was opened, time 0 of the file
+
+/**
+ * @brief Starts tracing, collectively on every rank of MPI_COMM_WORLD: takes the span buffers from the arena
+ * 		  and aligns every rank's clock with the master's.
+ *
+ * @param arena The arena, with trace_arena_bytes bytes left.
+ * @return SUCCESS, or FAILURE on every rank if the buffers did not fit on any of them, in which case no rank
+ * 		   records anything.
+ */
+int trace_open(Arena *arena)
+{
+	int rank;
+	int size;
+	int ok;
+	double stamp;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	trace_events = (TraceEvent *)arena_alloc(arena, TRACE_EVENTS * sizeof(TraceEvent));
+	if (rank == 0)
+	{
+		trace_received = (TraceEvent *)arena_alloc(arena, TRACE_EVENTS * sizeof(TraceEvent));
+	}
+	trace_count = 0;
+	trace_dropped = 0;
+	trace_offset = 0;
+
+	if (rank == 0)
+	{
+		for (int i = 1; i < size; i++)
+		{
+			double best = -1;
+			double offset = 0;
+			for (int j = 0; j < TRACE_PINGS; j++) // The shortest round trip bounds the error best
+			{
+				double sent = trace_clock();
+				MPI_Send(&sent, 1, MPI_DOUBLE, i, TRACE_TAG, MPI_COMM_WORLD);
+				MPI_Recv(&stamp, 1, MPI_DOUBLE, i, TRACE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+				double back = trace_clock();
+				if (best < 0 || back - sent < best)
+				{
+					best = back - sent;
+					offset = (sent + back) / 2 - stamp;
+				}
+			}
+			MPI_Send(&offset, 1, MPI_DOUBLE, i, TRACE_TAG, MPI_COMM_WORLD);
+		}
+		trace_origin = trace_clock();
+	}
+	else
+	{
+		for (int j = 0; j < TRACE_PINGS; j++)
+		{
+			MPI_Recv(&stamp, 1, MPI_DOUBLE, 0, TRACE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+			stamp = trace_clock();
+			MPI_Send(&stamp, 1, MPI_DOUBLE, 0, TRACE_TAG, MPI_COMM_WORLD);
+		}
+		MPI_Recv(&trace_offset, 1, MPI_DOUBLE, 0, TRACE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+	}
+	ok = trace_events != NULL && (rank != 0 || trace_received != NULL);
+	MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD); // So trace_write agrees on every rank
+	if (!ok)
+	{
+		if (rank == 0)
+		{
+			fprintf(stderr, "Tracing is off: the span buffers do not fit in the arena\n");
+		}
+		trace_events = NULL;
+		trace_received = NULL;
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+/**
+ * @brief The arena a rank needs for tracing.
+ *
+ * @param master 1 for the master, which also holds another rank's spans while it writes them.
+ * @return The bytes.
+ */
+size_t trace_arena_bytes(int master)
+{
+	return (master ? 2 : 1) * arena_block_size(TRACE_EVENTS * sizeof(TraceEvent));
+}
+/**
+ * @brief This rank's monotonic clock.
+ *
+ * @return Seconds.
+ */
+double trace_clock(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+/**
+ * @brief The master's clock as this rank reads it, for the start of a span.
+ *
+ * @return Seconds, or 0 without reading the clock while tracing is off.
+ */
+double trace_now(void)
+{
+	return (trace_events != NULL) ? trace_clock() + trace_offset : 0;
+}
+/**
+ * @brief Records a span that ends now.
+ *
+ * @param kind One of the TRACE_ kinds.
+ * @param id The turn or the search id the span belongs to.
+ * @param start When it started, from trace_now.
+ */
+void trace_span(int kind, int id, double start)
+{
+	if (trace_events == NULL)
+	{
+		return;
+	}
+	if (trace_count == TRACE_EVENTS)
+	{
+		trace_dropped++;
+		return;
+	}
+	TraceEvent *event = &trace_events[trace_count++];
+	event->start = start;
+	event->end = trace_now();
+	event->kind = kind;
+	event->id = id;
+}
+/**
+ * @brief Writes every rank's spans to a Chrome trace-event file, collectively on every rank of MPI_COMM_WORLD.
+ * 		  Does nothing if the trace could not be opened, which trace_open made the same on every rank.
+ *
+ * @param path The file, on the master.
+ * @return SUCCESS, or FAILURE on the master if tracing was off or the file could not be written.
+ */
+int trace_write(const char *path)
+{
+	int rank;
+	int size;
+	int first = 1;
+	int count;
+	long long dropped;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	if (trace_events == NULL)
+	{
+		return (rank == 0) ? FAILURE : SUCCESS;
+	}
+	MPI_Reduce(&trace_dropped, &dropped, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+	if (rank != 0)
+	{
+		MPI_Send(&trace_count, 1, MPI_INT, 0, TRACE_TAG, MPI_COMM_WORLD);
+		MPI_Send(trace_events, trace_count * sizeof(TraceEvent), MPI_BYTE, 0, TRACE_TAG, MPI_COMM_WORLD);
+		return SUCCESS;
+	}
+
+	FILE *fp = fopen(path, "w");
+	if (fp != NULL)
+	{
+		fprintf(fp, "{\"traceEvents\":[\n");
+		trace_write_events(fp, trace_events, trace_count, 0, &first);
+	}
+	for (int i = 1; i < size; i++) // Received even without a file, so that no rank is left waiting
+	{
+		MPI_Recv(&count, 1, MPI_INT, i, TRACE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		MPI_Recv(trace_received, count * sizeof(TraceEvent), MPI_BYTE, i, TRACE_TAG, MPI_COMM_WORLD,
+				 MPI_STATUS_IGNORE);
+		if (fp != NULL)
+		{
+			trace_write_events(fp, trace_received, count, i, &first);
+		}
+	}
+	if (fp == NULL)
+	{
+		fprintf(stderr, "File %s could not be opened\n", path);
+		return FAILURE;
+	}
+	fprintf(fp, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"ranks\":%d,\"dropped\":%lld}}\n", size, dropped);
+	return (fclose(fp) == 0) ? SUCCESS : FAILURE;
+}
+/**
+ * @brief Writes one rank's spans as complete ("X") events in microseconds from trace_origin, after a metadata
+ * 		  event naming its row.
+ *
+ * @param fp The file.
+ * @param events The spans.
+ * @param count The number of spans.
+ * @param rank The rank they come from, their row.
+ * @param first 1 until the first event of the file is written, for the commas.
+ */
+void trace_write_events(FILE *fp, const TraceEvent *events, int count, int rank, int *first)
+{
+	fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"rank %d\"}}",
+			*first ? "" : ",\n", rank, rank);
+	*first = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const TraceEvent *event = &events[i];
+		fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"%s\":%d}}",
+				trace_names[event->kind], rank, (event->start - trace_origin) * 1e6,
+				(event->end - event->start) * 1e6, trace_ids[event->kind], event->id);
+	}
+}
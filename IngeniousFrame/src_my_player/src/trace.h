@@ -0,0 +1,46 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stddef.h>
+#include "arena.h"
+
+#define TRACE_EVENTS 65536 // spans each rank can record
+#define TRACE_PINGS 16	   // round trips per rank when the clocks are aligned
+#define TRACE_TAG 6		   // messages of the clock alignment and the export, after my_player's tags
+
+/* Kinds of span, named in trace_names */
+#define TRACE_TURN 0		  // a referee turn on the master, from gen_move received to the move sent
+#define TRACE_GET_CMD 1		  // comms_get_cmd, waiting for the referee
+#define TRACE_BCAST 2		  // the broadcasts of the running flag and the position
+#define TRACE_GEN_MOVE 3	  // gen_move_master
+#define TRACE_SOLVE 4		  // solve_endgame on the master
+#define TRACE_DISPATCH 5	  // handing the root moves out
+#define TRACE_COLLECT 6		  // waiting for the results
+#define TRACE_PRINT 7		  // print_board
+#define TRACE_SEND_MOVE 8	  // comms_send_move
+#define TRACE_RECEIVE_WORK 9  // a worker receiving its root moves
+#define TRACE_SEARCH 10		  // search_root
+#define TRACE_SEND_RESULT 11  // a worker sending its result
+#define TRACE_SOLVE_JOB 12	  // a worker solving one endgame job
+#define TRACE_COORDINATE 13	  // a coordinator's part of a search
+#define TRACE_KINDS 14
+
+/**
+ * One span: its kind, its start and end on the master's clock, and the turn (on the master's turn-level spans)
+ * or the search id it belongs to.
+ */
+typedef struct
+{
+	double start; // seconds
+	double end;
+	int kind;
+	int id;
+} TraceEvent;
+
+int trace_open(Arena *arena);
+size_t trace_arena_bytes(int master);
+double trace_now(void);
+void trace_span(int kind, int id, double start);
+int trace_write(const char *path);
+
+#endif
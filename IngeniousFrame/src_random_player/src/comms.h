@@ -4,7 +4,7 @@
 #define FAILURE -1
 #define SUCCESS 0
 
-#define MOVEBUFSIZE 6
+#define MOVEBUFSIZE 6 // "pass\n", or a row and a column of up to two digits each and "\n"
 #define CMDBUFSIZE 100
 
 int comms_init(int* my_colour);
@@ -2,95 +2,84 @@
 
 /*H**********************************************************************
  *
- *    This is a skeleton to guide development of Othello engines that can be used
- *    with the Ingenious Framework and a Tournament Engine. 
+ *    Baseline Othello engines for the Ingenious Framework and the tournament
+ *    harness, built from the same board, evaluation and search code as
+ *    my_player (libothello).
  *
  *    The communication with the referee is handled by an implementaiton of comms.h,
- *    All communication is performed at rank 0.
+ *    All communication is performed at rank 0. The baselines are serial, so any
+ *    other ranks exit straight away.
+ *
+ *    The engine is chosen with options that follow the referee arguments:
+ *        --engine random      a uniformly random legal move (default)
+ *        --engine greedy      the move that flips the most discs, ties broken at random
+ *        --engine alphabeta   a fixed-depth Alpha/Beta MiniMax search
+ *        --depth <n>          plies searched by the alphabeta engine (default 2)
+ *        --seed <n>           seed for the random number generator
+ *        --board-size <n>     squares per side, or the "boardSize" setting of
+ *                             Othello.json; boards other than 8x8 are played
+ *                             on the mailbox board (mailbox.h)
  *
  *    Board co-ordinates for moves start at the top left corner of the board i.e.
- *    if your engine wishes to place a piece at the top left corner, 
+ *    if your engine wishes to place a piece at the top left corner,
  *    the "gen_move_master" function must return "00".
  *
- *    The match is played by making alternating calls to each engine's 
- *    "gen_move_master" and "apply_opp_move" functions. 
- *    The progression of a match is as follows:
- *        1. Call gen_move_master for black player
- *        2. Call apply_opp_move for white player, providing the black player's move
- *        3. Call gen move for white player
- *        4. Call apply_opp_move for black player, providing the white player's move
- *        .
- *        .
- *        .
- *        N. A player makes the final move and "game_over" is called for both players
- *    
  *    IMPORTANT NOTE:
- *        Write any (debugging) output you would like to see to a file. 
+ *        Write any (debugging) output you would like to see to a file.
  *        	- This can be done using file fp, and fprintf()
  *        	- Don't forget to flush the stream
- *        	- Write a method to make this easier
- *        In a multiprocessor version 
- *        	- each process should write debug info to its own file 
  *H***********************************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <arpa/inet.h>
-#include </opt/homebrew/Cellar/open-mpi/4.1.5/include/mpi.h>
+#include <limits.h>
+#include <mpi.h>
 #include <time.h>
 #include <assert.h>
 #include "comms.h"
+#include "othello.h"
 
-const int EMPTY = 0;
-const int BLACK = 1;
-const int WHITE = 2;
-
-const int OUTER = 3;
-const int ALLDIRECTIONS[8] = {-11, -10, -9, -1, 1, 9, 10, 11};
-const int BOARDSIZE = 100;
-
-const int LEGALMOVSBUFSIZE = 65;
-const char piecenames[4] = {'.','b','w','?'};
+const int RANDOM_ENGINE = 0;
+const int GREEDY_ENGINE = 1;
+const int ALPHABETA_ENGINE = 2;
 
 void run_master(int argc, char *argv[]);
 int initialise_master(int argc, char *argv[], int *time_limit, int *my_colour, FILE **fp);
+int parse_options(int argc, char *argv[]);
 void gen_move_master(char *move, int my_colour, FILE *fp);
+void gen_move_mailbox(char *move, int my_colour, FILE *fp);
 void apply_opp_move(char *move, int my_colour, FILE *fp);
+void print_game(FILE *fp);
 void game_over();
-void run_worker();
-void initialise_board();
-void free_board();
-
-void legal_moves(int player, int *moves, FILE *fp);
-int legalp(int move, int player, FILE *fp);
-int validp(int move);
-int would_flip(int move, int dir, int player, FILE *fp);
-int opponent(int player, FILE *fp);
-int find_bracket_piece(int square, int dir, int player, FILE *fp);
-int bens_strategy(int my_colour, FILE *fp);
-void make_move(int move, int player, FILE *fp);
-void make_flips(int move, int dir, int player, FILE *fp);
-int get_loc(char* movestring);
-void get_move_string(int loc, char *ms);
-void print_board(FILE *fp);
-char nameof(int piece);
-int count(int player, int * board);
-
-int *current_board;
+int random_strategy(const Position *pos);
+int greedy_strategy(const Position *pos);
+int alphabeta_strategy(const Position *pos);
+int mailbox_random_strategy(const MailboxPosition *pos);
+int mailbox_greedy_strategy(const MailboxPosition *pos);
+int mailbox_alphabeta_strategy(const MailboxPosition *pos);
+
+Position current_position;
+MailboxPosition current_mailbox; /* the game when the board is not 8x8 */
+uint64_t rng_state;
+int engine;
+int engine_depth;
+int board_size;
 
 int main(int argc, char *argv[]) {
 	int rank;
 
 	MPI_Init(&argc, &argv);
 	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
- 
-	initialise_board(); //one for each process
+
+	initialise_zobrist();
+	initialise_stability();
+	initialise_position(&current_position);
 
 	if (rank == 0) {
 	    run_master(argc, argv);
-	} else {
-	    run_worker(rank);
 	}
 	game_over();
 }
@@ -100,7 +89,7 @@ void run_master(int argc, char *argv[]) {
 	char my_move[MOVEBUFSIZE];
 	char opponent_move[MOVEBUFSIZE];
 	int time_limit;
-	int my_colour;
+	int my_colour = EMPTY;
 	int running = 0;
 	FILE *fp = NULL;
 
@@ -108,7 +97,6 @@ void run_master(int argc, char *argv[]) {
 		running = 1;
 	}
 	if (my_colour == EMPTY) my_colour = BLACK;
-	// Broadcast my_colour
 
 	while (running == 1) {
 		/* Receive next command from referee */
@@ -128,14 +116,12 @@ void run_master(int argc, char *argv[]) {
 
 		/* Received gen_move message */
 		} else if (strcmp(cmd, "gen_move") == 0) {
-			// Broadcast running
-			// Broadcast board 
+			if (current_position.to_move != my_colour) make_pass(&current_position);
 
 			gen_move_master(my_move, my_colour, fp);
-			print_board(fp);
-		
+			print_game(fp);
 
-			if (comms_send_move(my_move) == FAILURE) { 
+			if (comms_send_move(my_move) == FAILURE) {
 				running = 0;
 				fprintf(fp, "Move send failed\n");
 				fflush(fp);
@@ -145,22 +131,23 @@ void run_master(int argc, char *argv[]) {
 		/* Received opponent's move (play_move mesage) */
 		} else if (strcmp(cmd, "play_move") == 0) {
 			apply_opp_move(opponent_move, my_colour, fp);
-			print_board(fp);
+			print_game(fp);
 
 		/* Received unknown message */
 		} else {
 			fprintf(fp, "Received unknown command from referee\n");
 		}
-		
-		
 	}
-	// Broadcast running
 }
 
 int initialise_master(int argc, char *argv[], int *time_limit, int *my_colour, FILE **fp) {
 	int result = FAILURE;
 
-	if (argc == 5) { 
+	engine = RANDOM_ENGINE;
+	engine_depth = 2;
+	board_size = 0;
+	rng_state = (uint64_t)time(NULL);
+	if (argc >= 5 && parse_options(argc - 5, argv + 5) != FAILURE) {
 		unsigned long ip = inet_addr(argv[1]);
 		int port = atoi(argv[2]);
 		*time_limit = atoi(argv[3]);
@@ -176,214 +163,234 @@ int initialise_master(int argc, char *argv[], int *time_limit, int *my_colour, F
 			fprintf(stderr, "File %s could not be opened", argv[4]);
 		}
 	} else {
-		fprintf(*fp, "Arguments: <ip> <port> <time_limit> <filename> \n");
+		fprintf(stderr, "Arguments: <ip> <port> <time_limit> <filename> [--engine random|greedy|alphabeta] [--depth <n>] [--seed <n>] [--board-size <n>]\n");
 	}
-	
-	return result;
-}
-
-void initialise_board() {
-	int i;
-	current_board = (int *) malloc(BOARDSIZE * sizeof(int));
-	for (i = 0; i <= 9; i++) current_board[i] = OUTER;
-	for (i = 10; i <= 89; i++) {
-		if (i%10 >= 1 && i%10 <= 8) current_board[i] = EMPTY; else current_board[i] = OUTER;
-	}
-	for (i = 90; i <= 99; i++) current_board[i] = OUTER;
-	current_board[44] = WHITE; current_board[45] = BLACK; current_board[54] = BLACK; current_board[55] = WHITE;
-}
 
-void free_board() {
-	free(current_board);
+	return result;
 }
 
 /**
- *   Rank i (i != 0) executes this code 
- *   ----------------------------------
- *   Called at the start of execution on all ranks except for rank 0.
- *   - run_worker should play minimax from its move(s) 
- *   - results should be send to Rank 0 for final selection of a move 
+ * Reads the options that follow the referee arguments; returns FAILURE on an
+ * unknown or incomplete option.
  */
-void run_worker(int rank) {
-	int running = 0;
-	// Broadcast colour
-	// Broadcast running
-
-	while (running == 1) {
-		// Broadcast board
-
-		// Generate move        
-
-		// Broadcast running 
+int parse_options(int argc, char *argv[]) {
+	for (int i = 0; i < argc; i++) {
+		if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "random") == 0) engine = RANDOM_ENGINE;
+			else if (strcmp(argv[i], "greedy") == 0) engine = GREEDY_ENGINE;
+			else if (strcmp(argv[i], "alphabeta") == 0) engine = ALPHABETA_ENGINE;
+			else return FAILURE;
+		} else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+			engine_depth = atoi(argv[++i]);
+			if (engine_depth < 1) engine_depth = 1;
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			rng_state = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--board-size") == 0 && i + 1 < argc) {
+			board_size = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return FAILURE;
+		}
+	}
+	if (board_size <= 0) board_size = match_setting(MATCHCONFIG, "boardSize", BOARDSIDE);
+	if (board_size != BOARDSIDE && mailbox_initialise(&current_mailbox, board_size) == FAILURE) {
+		fprintf(stderr, "Boards of %d squares per side are not supported\n", board_size);
+		return FAILURE;
 	}
+	return SUCCESS;
 }
 
 /**
- *  Rank 0 executes this code: 
+ *  Rank 0 executes this code:
  *  --------------------------
- *  Called when the next move should be generated 
- *  - gen_move_master should play minimax from its move(s)
- *  - the ranks may communicate during execution 
- *  - final results should be gathered at rank 0 for final selection of a move 
+ *  Called when the next move should be generated; asks the selected
+ *  baseline engine for a move and plays it.
  */
 void gen_move_master(char *move, int my_colour, FILE *fp) {
 	int loc;
 
+	if (board_size != BOARDSIDE) {
+		gen_move_mailbox(move, my_colour, fp);
+		return;
+	}
+
 	/* generate move */
-	loc = bens_strategy(my_colour, fp);
+	if (engine == GREEDY_ENGINE) loc = greedy_strategy(&current_position);
+	else if (engine == ALPHABETA_ENGINE) loc = alphabeta_strategy(&current_position);
+	else loc = random_strategy(&current_position);
 
 	if (loc == -1) {
 		strncpy(move, "pass\n", MOVEBUFSIZE);
+		make_pass(&current_position);
 	} else {
 		/* apply move */
 		get_move_string(loc, move);
-	
-		make_move(loc, my_colour, fp);
+		make_move(&current_position, loc);
+	}
+}
+
+/**
+ * The same on a board other than 8x8.
+ */
+void gen_move_mailbox(char *move, int my_colour, FILE *fp) {
+	int loc;
 
+	if (current_mailbox.to_move != my_colour) mailbox_make_pass(&current_mailbox);
+
+	if (engine == GREEDY_ENGINE) loc = mailbox_greedy_strategy(&current_mailbox);
+	else if (engine == ALPHABETA_ENGINE) loc = mailbox_alphabeta_strategy(&current_mailbox);
+	else loc = mailbox_random_strategy(&current_mailbox);
+
+	if (loc == -1) {
+		strncpy(move, "pass\n", MOVEBUFSIZE);
+		mailbox_make_pass(&current_mailbox);
+	} else {
+		move_to_string(loc, board_size, move);
+		mailbox_make_move(&current_mailbox, loc);
 	}
 }
 
 void apply_opp_move(char *move, int my_colour, FILE *fp) {
 	int loc;
-	if (strcmp(move, "pass\n") == 0) {
+	if (strncmp(move, "pass", 4) == 0) {
+		if (board_size != BOARDSIDE) mailbox_make_pass(&current_mailbox);
+		else make_pass(&current_position);
+		return;
+	}
+	if (board_size != BOARDSIDE) {
+		loc = move_from_string(move, board_size);
+		if (loc != -1 && mailbox_flips(&current_mailbox, loc) > 0) mailbox_make_move(&current_mailbox, loc);
+		else fprintf(fp, "Ignored the illegal move %s\n", move);
 		return;
 	}
 	loc = get_loc(move);
-	make_move(loc, opponent(my_colour, fp), fp);
+	if (loc != -1 && legalp(&current_position, loc)) make_move(&current_position, loc);
+	else fprintf(fp, "Ignored the illegal move %s\n", move);
+}
+
+/**
+ * Prints the board being played to the log.
+ */
+void print_game(FILE *fp) {
+	if (board_size != BOARDSIDE) mailbox_print(fp, &current_mailbox);
+	else print_board(fp, &current_position);
 }
 
 void game_over() {
-	free_board();
 	MPI_Finalize();
 }
 
-void get_move_string(int loc, char *ms) {
-	int row, col, new_loc;
-	new_loc = loc - (9 + 2 * (loc / 10));
-	row = new_loc / 8;
-	col = new_loc % 8;
-	ms[0] = row + '0';
-	ms[1] = col + '0';
-	ms[2] = '\n';
-	ms[3] = 0;
-}
+/**
+ * Uniformly random legal move, -1 to pass.
+ */
+int random_strategy(const Position *pos) {
+	int moves[LEGALMOVSBUFSIZE];
+	int n = legal_moves(pos, moves);
 
-int get_loc(char* movestring) {
-	int row, col;
-	/* movestring of form "xy", x = row and y = column */ 
-	row = movestring[0] - '0'; 
-	col = movestring[1] - '0'; 
-	return (10 * (row + 1)) + col + 1;
+	if (n == 0) return -1;
+	return moves[rng_next(&rng_state) % n];
 }
 
-void legal_moves(int player, int *moves, FILE *fp) {
-	int move, i;
-	moves[0] = 0;
-	i = 0;
-	for (move = 11; move <= 88; move++) {
-		if (legalp(move, player, fp)) {
-      i++;
-      moves[i] = move;
-    }
+/**
+ * Legal move that flips the most discs, ties broken uniformly at random; -1 to pass.
+ */
+int greedy_strategy(const Position *pos) {
+	int moves[LEGALMOVSBUFSIZE];
+	int n = legal_moves(pos, moves);
+	int best_move = -1;
+	int best_flips = -1;
+	int ties = 0;
+
+	for (int i = 0; i < n; i++) {
+		int flips = __builtin_popcountll(would_flip(pos, moves[i]));
+		if (flips > best_flips) {
+			best_flips = flips;
+			best_move = moves[i];
+			ties = 1;
+		} else if (flips == best_flips && rng_next(&rng_state) % ++ties == 0) {
+			best_move = moves[i]; /* reservoir sampling over the tied moves */
+		}
 	}
-	moves[0] = i;
+	return best_move;
 }
 
-int legalp(int move, int player, FILE *fp) {
-	int i;
-	if (!validp(move)) return 0;
-	if (current_board[move] == EMPTY) {
-		i = 0;
-		while (i <= 7 && !would_flip(move, ALLDIRECTIONS[i], player, fp)) i++;
-		if (i == 8) return 0; else return 1;
+/**
+ * Best move of a fixed-depth Alpha/Beta MiniMax search with the shared evaluation; -1 to pass.
+ */
+int alphabeta_strategy(const Position *pos) {
+	int moves[LEGALMOVSBUFSIZE];
+	int n = legal_moves(pos, moves);
+	int best_move = -1;
+	int best_score = INT_MIN;
+
+	node_limit = 0;
+	search_aborted = 0;
+	for (int i = 0; i < n; i++) {
+		Position child = *pos;
+		make_move(&child, moves[i]);
+		int score = minimax(&child, pos->to_move, engine_depth - 1, best_score, INT_MAX);
+		if (score > best_score) {
+			best_score = score;
+			best_move = moves[i];
+		}
 	}
-	else return 0;
-}
-
-int validp(int move) {
-	if ((move >= 11) && (move <= 88) && (move%10 >= 1) && (move%10 <= 8))
-		return 1;
-	else return 0;
-}
-
-int would_flip(int move, int dir, int player, FILE *fp) {
-	int c;
-	c = move + dir;
-	if (current_board[c] == opponent(player, fp))
-		return find_bracket_piece(c+dir, dir, player, fp);
-	else return 0;
-}
-
-int find_bracket_piece(int square, int dir, int player, FILE *fp) {
-	while (validp(square) && current_board[square] == opponent(player, fp)) square = square + dir;
-	if (validp(square) && current_board[square] == player) return square;
-	else return 0;
-}
-
-int opponent(int player, FILE *fp) {
-	if (player == BLACK) return WHITE;
-	if (player == WHITE) return BLACK;
-	fprintf(fp, "illegal player\n"); return EMPTY;
+	return best_move;
 }
 
-int bens_strategy(int my_colour, FILE *fp) {
-
-	
-	int r;
-	int *moves = (int *) malloc(LEGALMOVSBUFSIZE * sizeof(int));
-	memset(moves, 0, LEGALMOVSBUFSIZE);
-
-	legal_moves(my_colour, moves, fp);
-	if (moves[0] == 0) {
-		return -1;
-	}
-	srand (time(NULL));
-	r = moves[(rand() % moves[0]) + 1];
-
-	return(r);
-}
+/**
+ * Uniformly random legal move on a board other than 8x8, -1 to pass.
+ */
+int mailbox_random_strategy(const MailboxPosition *pos) {
+	int moves[MAILBOX_MOVESBUFSIZE];
+	int n = mailbox_legal_moves(pos, moves);
 
-void make_move(int move, int player, FILE *fp) {
-	int i;
-	current_board[move] = player;
-	for (i = 0; i <= 7; i++) make_flips(move, ALLDIRECTIONS[i], player, fp);
+	if (n == 0) return -1;
+	return moves[rng_next(&rng_state) % n];
 }
 
-void make_flips(int move, int dir, int player, FILE *fp) {
-	int bracketer, c;
-	bracketer = would_flip(move, dir, player, fp);
-	if (bracketer) {
-		c = move + dir;
-		do {
-			current_board[c] = player;
-			c = c + dir;
-		} while (c != bracketer);
+/**
+ * Legal move that flips the most discs on a board other than 8x8, ties broken uniformly at random; -1 to pass.
+ */
+int mailbox_greedy_strategy(const MailboxPosition *pos) {
+	int moves[MAILBOX_MOVESBUFSIZE];
+	int n = mailbox_legal_moves(pos, moves);
+	int best_move = -1;
+	int best_flips = -1;
+	int ties = 0;
+
+	for (int i = 0; i < n; i++) {
+		int flips = mailbox_flips(pos, moves[i]);
+		if (flips > best_flips) {
+			best_flips = flips;
+			best_move = moves[i];
+			ties = 1;
+		} else if (flips == best_flips && rng_next(&rng_state) % ++ties == 0) {
+			best_move = moves[i];
+		}
 	}
+	return best_move;
 }
 
-void print_board(FILE *fp) {
-	
-	int row, col;
-	fprintf(fp, "   1 2 3 4 5 6 7 8 [%c=%d %c=%d]\n",
-		nameof(BLACK), count(BLACK, current_board), nameof(WHITE), count(WHITE, current_board));
-	for (row = 1; row <= 8; row++) {
-		fprintf(fp, "%d  ", row);
-		for (col = 1; col <= 8; col++)
-			fprintf(fp, "%c ", nameof(current_board[col + (10 * row)]));
-		fprintf(fp, "\n");
+/**
+ * Best move of a fixed-depth Alpha/Beta MiniMax search on a board other than 8x8; -1 to pass.
+ */
+int mailbox_alphabeta_strategy(const MailboxPosition *pos) {
+	int moves[MAILBOX_MOVESBUFSIZE];
+	int n = mailbox_legal_moves(pos, moves);
+	int best_move = -1;
+	int best_score = INT_MIN;
+
+	node_limit = 0;
+	search_aborted = 0;
+	for (int i = 0; i < n; i++) {
+		MailboxPosition child = *pos;
+		mailbox_make_move(&child, moves[i]);
+		int score = mailbox_minimax(&child, pos->to_move, engine_depth - 1, best_score, INT_MAX);
+		if (score > best_score) {
+			best_score = score;
+			best_move = moves[i];
+		}
 	}
-	fflush(fp);
-}
-
-char nameof(int piece) {
-	assert(0 <= piece && piece < 5);
-	return(piecenames[piece]);
-}
-
-int count(int player, int * board) {
-	int i, cnt;
-	cnt = 0;
-	for (i = 1; i <= 88; i++)
-		if (board[i] == player) cnt++;
-	return cnt;
+	return best_move;
 }
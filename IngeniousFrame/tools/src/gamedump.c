@@ -0,0 +1,155 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Prints the games of a game record collection (see gamerec.h).
+ *
+ *    Usage: gamedump [--positions | --summary] <prefix> [first [count]]
+ *        (default)      one line per game: number, result, plies and moves
+ *        --positions    one line per searched move, for evaluation tuning:
+ *                       the position before the move (position_to_string),
+ *                       the search score and the final disc difference,
+ *                       both for the player to move
+ *        --summary      game count, average length and results only
+ *
+ *H***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "othello.h"
+
+#define MOVESTRBUFSIZE 4
+
+void print_game(long long number, const GameRecord *game);
+int print_positions(const GameRecord *game);
+
+int main(int argc, char *argv[])
+{
+	GameReader reader;
+	GameRecord game;
+	int positions = 0;
+	int summary = 0;
+	int arg = 1;
+	long long first = 0;
+	long long limit = -1;
+	long long games = 0;
+	long long plies = 0;
+	long long wins[3] = {0, 0, 0}; // draws, black wins, white wins
+
+	if (arg < argc && strcmp(argv[arg], "--positions") == 0)
+	{
+		positions = 1;
+		arg++;
+	}
+	else if (arg < argc && strcmp(argv[arg], "--summary") == 0)
+	{
+		summary = 1;
+		arg++;
+	}
+	if (arg >= argc)
+	{
+		fprintf(stderr, "Usage: gamedump [--positions | --summary] <prefix> [first [count]]\n");
+		return EXIT_FAILURE;
+	}
+	initialise_zobrist();
+	if (gamerec_open_reader(&reader, argv[arg]) == FAILURE)
+	{
+		fprintf(stderr, "%s%s is not a game record file\n", argv[arg], GAMEREC_DATA);
+		return EXIT_FAILURE;
+	}
+	if (arg + 1 < argc)
+	{
+		first = atoll(argv[arg + 1]);
+		if (gamerec_seek(&reader, first) == FAILURE)
+		{
+			fprintf(stderr, "No game %lld in %s%s\n", first, argv[arg], GAMEREC_INDEX);
+			gamerec_close_reader(&reader);
+			return EXIT_FAILURE;
+		}
+	}
+	if (arg + 2 < argc)
+	{
+		limit = atoll(argv[arg + 2]);
+	}
+
+	while ((limit < 0 || games < limit) && gamerec_read(&reader, &game) == SUCCESS)
+	{
+		if (positions)
+		{
+			if (print_positions(&game) == FAILURE)
+			{
+				fprintf(stderr, "Game %lld holds an illegal move\n", first + games);
+			}
+		}
+		else if (!summary)
+		{
+			print_game(first + games, &game);
+		}
+		games++;
+		plies += game.num_plies;
+		wins[(game.result > 0) ? BLACK : (game.result < 0) ? WHITE : EMPTY]++;
+	}
+	gamerec_close_reader(&reader);
+
+	if (summary)
+	{
+		printf("%lld games, %.1f plies per game, black %lld, white %lld, drawn %lld\n", games,
+			   games > 0 ? (double)plies / games : 0.0, wins[BLACK], wins[WHITE], wins[EMPTY]);
+	}
+	return EXIT_SUCCESS;
+}
+/**
+ * @brief Prints a game on one line: its number, result, length and moves.
+ *
+ * @param number The number of the game in the collection.
+ * @param game The game.
+ */
+void print_game(long long number, const GameRecord *game)
+{
+	char move[MOVESTRBUFSIZE];
+
+	printf("%lld %+d %d %d:", number, game->result, game->num_plies, game->opening_plies);
+	for (int i = 0; i < game->num_plies; i++)
+	{
+		if (game->moves[i] == GAMEREC_PASS)
+		{
+			printf(" pass");
+			continue;
+		}
+		get_move_string(game->moves[i], move);
+		move[2] = 0;
+		printf(" %s", move);
+	}
+	printf("\n");
+}
+/**
+ * @brief Prints every searched position of a game with its score and the final result for the player to move.
+ *
+ * @param game The game.
+ * @return SUCCESS, or FAILURE if the game holds an illegal move.
+ */
+int print_positions(const GameRecord *game)
+{
+	char str[POSITIONSTRLEN];
+	Position pos;
+
+	if (gamerec_replay(game, game->num_plies, &pos) == FAILURE) // Checks every move once
+	{
+		return FAILURE;
+	}
+	initialise_position(&pos);
+	for (int ply = 0; ply < game->num_plies; ply++)
+	{
+		if (game->scores[ply] != GAMEREC_NOSCORE)
+		{
+			position_to_string(&pos, str);
+			printf("%s %d %d\n", str, game->scores[ply], (pos.to_move == BLACK) ? game->result : -game->result);
+		}
+		if (game->moves[ply] == GAMEREC_PASS)
+			make_pass(&pos);
+		else
+			make_move(&pos, game->moves[ply]);
+	}
+	return SUCCESS;
+}
@@ -0,0 +1,630 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Trains the evaluation network (net.h) on self-play games and writes
+ *    it for my_player --net. Rank r reads the collections <prefix>.<r>,
+ *    <prefix>.<r + ranks>, ... as selfplay writes them, and every position
+ *    before a move becomes an example whose target is the game's final
+ *    disc difference. Each time an example is used it is seen from a
+ *    random player's side and in a random one of the eight orientations,
+ *    and it trains the second and output layers of its stage of the game.
+ *
+ *    The network is trained in floating point with Adam on the mean
+ *    squared error, with the gradients of each batch summed over all ranks
+ *    so that every rank keeps the same weights. Weights are clipped to
+ *    what their quantised form can hold. Every sixteenth game is held out,
+ *    and the error on those is printed after each epoch, and once more for
+ *    the quantised network read back from the file.
+ *
+ *    Usage: nettrain <prefix> <network> [options]
+ *        --epochs <n>   passes over the games (default 20)
+ *        --rate <x>     Adam learning rate (default 0.001)
+ *        --batch <n>    examples per rank per step (default 256)
+ *        --seed <n>     seed of the weights and the sampling (default 1)
+ *
+ *H***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include "othello.h"
+
+#define HOLDOUT 16	 // every HOLDOUT-th game is held out
+#define ADAMBETA1 0.9f
+#define ADAMBETA2 0.999f
+#define ADAMEPSILON 1e-8f
+#define WEIGHT1LIMIT 3.9f // |first layer weight| that cannot overflow a 16-bit accumulator over 64 discs
+#define WEIGHT2LIMIT 1.98f // |second layer weight| that fits in 8 bits in 1/64ths
+
+/**
+ * Training settings, the same on every rank.
+ */
+typedef struct
+{
+	int epochs;				 // passes over the games
+	float rate;				 // Adam learning rate
+	int batch;				 // examples per rank per step
+	unsigned long long seed; // seed of the weights and of rank 0's sampling
+} TrainConfig;
+
+/**
+ * The network in floating point, laid out as in Network. Every member is a float, so the struct can also be
+ * walked as one array of NETPARAMS floats.
+ */
+typedef struct
+{
+	float weights1[NET_INPUTS][NET_HIDDEN1];
+	float bias1[NET_HIDDEN1];
+	float weights2[NET_BUCKETS][NET_HIDDEN2][NET_HIDDEN1];
+	float bias2[NET_BUCKETS][NET_HIDDEN2];
+	float weights3[NET_BUCKETS][NET_HIDDEN2];
+	float bias3[NET_BUCKETS];
+} FloatNetwork;
+
+#define NETPARAMS ((int)(sizeof(FloatNetwork) / sizeof(float)))
+
+/**
+ * A position before a move, with the result of its game.
+ */
+typedef struct
+{
+	uint64_t discs[2]; // black and white discs
+	int8_t result;	   // final disc difference, black minus white
+} Example;
+
+/**
+ * Examples of one kind, in a growing array.
+ */
+typedef struct
+{
+	Example *examples;
+	long long count;
+	long long capacity;
+} ExampleSet;
+
+int parse_options(int argc, char *argv[], TrainConfig *config);
+int read_games(const char *prefix, int rank, int size, ExampleSet *train, ExampleSet *held_out);
+int add_example(ExampleSet *set, const Position *pos, int result);
+int example_bucket(const Example *example);
+void initialise_weights(FloatNetwork *net, uint64_t *rng);
+float random_uniform(uint64_t *rng, float limit);
+void sample(const Example *example, uint64_t *rng, uint64_t *own, uint64_t *opp, float *target);
+float forward(const FloatNetwork *net, uint64_t own, uint64_t opp, int bucket, float *pre1, float *hidden1,
+			  float *pre2, float *hidden2);
+float backward(const FloatNetwork *net, uint64_t own, uint64_t opp, int bucket, float target, float scale,
+			   FloatNetwork *gradient);
+void adam_step(FloatNetwork *net, const FloatNetwork *gradient, FloatNetwork *moment1, FloatNetwork *moment2,
+			   float rate, long long step);
+double held_out_error(const FloatNetwork *net, const ExampleSet *held_out);
+double quantised_error(const Network *net, const ExampleSet *held_out);
+void quantise(const FloatNetwork *net, Network *quantised);
+float clip(float value, float limit);
+
+int main(int argc, char *argv[])
+{
+	int rank;
+	int size;
+	TrainConfig config = {20, 0.001f, 256, 1};
+	ExampleSet train = {NULL, 0, 0};
+	ExampleSet held_out = {NULL, 0, 0};
+	static FloatNetwork net;
+	static FloatNetwork gradient;
+	static FloatNetwork moment1;
+	static FloatNetwork moment2;
+	static Network quantised;
+	long long counts[2];
+	long long total[2];
+	long long batches;
+	int ok;
+	int all_ok;
+
+	MPI_Init(&argc, &argv);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	initialise_zobrist();
+
+	if (argc < 3 || parse_options(argc - 3, argv + 3, &config) == FAILURE)
+	{
+		if (rank == 0)
+		{
+			fprintf(stderr, "Usage: nettrain <prefix> <network> [--epochs <n>] [--rate <x>] [--batch <n>] "
+							"[--seed <n>]\n");
+		}
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+
+	ok = read_games(argv[1], rank, size, &train, &held_out) == SUCCESS && train.count >= config.batch;
+	MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+	if (!all_ok)
+	{
+		if (!ok)
+		{
+			fprintf(stderr, "Rank %d: fewer than %d examples in %s.%d%s and the collections after it\n", rank,
+					config.batch, argv[1], rank, GAMEREC_DATA);
+		}
+		free(train.examples);
+		free(held_out.examples);
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+	counts[0] = train.count;
+	counts[1] = held_out.count;
+	MPI_Allreduce(counts, total, 2, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+	long long held_out_total = (total[1] > 0) ? total[1] : 1;
+	batches = train.count / config.batch;
+	MPI_Allreduce(MPI_IN_PLACE, &batches, 1, MPI_LONG_LONG, MPI_MIN, MPI_COMM_WORLD); // Every rank steps together
+	if (rank == 0)
+	{
+		printf("%lld examples, %lld held out, %lld steps of %d per epoch on %d ranks\n", total[0], total[1],
+			   batches, config.batch * size, size);
+	}
+
+	uint64_t rng = config.seed;
+	initialise_weights(&net, &rng); // The same on every rank
+	memset(&moment1, 0, sizeof(moment1));
+	memset(&moment2, 0, sizeof(moment2));
+	rng = config.seed + rank;
+	double start = MPI_Wtime();
+	long long step = 0;
+	for (int epoch = 1; epoch <= config.epochs; epoch++)
+	{
+		double loss = 0;
+		for (long long i = train.count - 1; i > 0; i--) // Shuffles this rank's examples
+		{
+			long long j = rng_next(&rng) % (i + 1);
+			Example swap = train.examples[i];
+			train.examples[i] = train.examples[j];
+			train.examples[j] = swap;
+		}
+		for (long long b = 0; b < batches; b++)
+		{
+			memset(&gradient, 0, sizeof(gradient));
+			for (int e = 0; e < config.batch; e++)
+			{
+				uint64_t own;
+				uint64_t opp;
+				float target;
+				sample(&train.examples[b * config.batch + e], &rng, &own, &opp, &target);
+				loss += backward(&net, own, opp, example_bucket(&train.examples[b * config.batch + e]), target,
+								 1.0f / (config.batch * size), &gradient);
+			}
+			MPI_Allreduce(MPI_IN_PLACE, &gradient, NETPARAMS, MPI_FLOAT, MPI_SUM, MPI_COMM_WORLD);
+			adam_step(&net, &gradient, &moment1, &moment2, config.rate, ++step);
+		}
+
+		double sums[2] = {loss, held_out_error(&net, &held_out)};
+		MPI_Allreduce(MPI_IN_PLACE, sums, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+		if (rank == 0)
+		{
+			printf("epoch %2d  train rmse %.2f  held-out rmse %.2f discs  %.1fs\n", epoch,
+				   sqrt(sums[0] / (batches * config.batch * size)), sqrt(sums[1] / held_out_total), MPI_Wtime() - start);
+			fflush(stdout);
+		}
+	}
+
+	ok = 1;
+	if (rank == 0)
+	{
+		quantise(&net, &quantised);
+		ok = net_save(&quantised, argv[2]) == SUCCESS;
+	}
+	MPI_Bcast(&ok, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	if (!ok || net_load(&quantised, argv[2]) == FAILURE) // Read back as my_player will
+	{
+		if (rank == 0)
+		{
+			fprintf(stderr, "Could not write %s\n", argv[2]);
+		}
+		ok = 0;
+	}
+	else
+	{
+		double error = quantised_error(&quantised, &held_out);
+		MPI_Allreduce(MPI_IN_PLACE, &error, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+		if (rank == 0)
+		{
+			printf("quantised held-out rmse %.2f discs (%s kernel), written to %s\n", sqrt(error / held_out_total),
+				   net_kernel(), argv[2]);
+		}
+	}
+	free(train.examples);
+	free(held_out.examples);
+	MPI_Finalize();
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+/**
+ * @brief Reads the options that follow the prefix and the network.
+ *
+ * @param argc The number of options.
+ * @param argv The options.
+ * @param config The settings to update.
+ * @return SUCCESS, or FAILURE on an unknown or incomplete option.
+ */
+int parse_options(int argc, char *argv[], TrainConfig *config)
+{
+	for (int i = 0; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--epochs") == 0 && i + 1 < argc)
+		{
+			config->epochs = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+		{
+			config->rate = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+		{
+			config->batch = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			config->seed = strtoull(argv[++i], NULL, 10);
+		}
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return FAILURE;
+		}
+	}
+	config->epochs = max(config->epochs, 0);
+	config->batch = max(config->batch, 1);
+	return (config->rate > 0) ? SUCCESS : FAILURE;
+}
+/**
+ * @brief Reads this rank's share of the collections, <prefix>.<rank>, <prefix>.<rank + size> and so on until
+ * 		  one is missing, and splits the positions before each move into training and held-out examples by game.
+ *
+ * @param prefix The prefix the collections were written with.
+ * @param rank The rank of this process.
+ * @param size The number of ranks.
+ * @param train The training examples.
+ * @param held_out The held-out examples.
+ * @return SUCCESS, or FAILURE if there was no memory for the examples.
+ */
+int read_games(const char *prefix, int rank, int size, ExampleSet *train, ExampleSet *held_out)
+{
+	char path[GAMEREC_PATHBUFSIZE];
+	GameReader reader;
+	GameRecord game;
+	long long games = 0;
+
+	for (int collection = rank;; collection += size)
+	{
+		snprintf(path, GAMEREC_PATHBUFSIZE, "%s.%d", prefix, collection);
+		if (gamerec_open_reader(&reader, path) == FAILURE)
+		{
+			break;
+		}
+		while (gamerec_read(&reader, &game) == SUCCESS)
+		{
+			Position pos;
+			ExampleSet *set = (games++ % HOLDOUT == HOLDOUT - 1) ? held_out : train;
+			initialise_position(&pos);
+			for (int ply = 0; ply < game.num_plies; ply++)
+			{
+				if (game.moves[ply] == GAMEREC_PASS)
+				{
+					make_pass(&pos);
+					continue;
+				}
+				if (add_example(set, &pos, game.result) == FAILURE)
+				{
+					gamerec_close_reader(&reader);
+					return FAILURE;
+				}
+				make_move(&pos, game.moves[ply]);
+			}
+		}
+		gamerec_close_reader(&reader);
+	}
+	return SUCCESS;
+}
+/**
+ * @brief Appends an example, doubling the array when it is full.
+ *
+ * @return SUCCESS, or FAILURE if there was no memory.
+ */
+int add_example(ExampleSet *set, const Position *pos, int result)
+{
+	if (set->count == set->capacity)
+	{
+		long long capacity = (set->capacity > 0) ? 2 * set->capacity : 4096;
+		Example *examples = (Example *)realloc(set->examples, capacity * sizeof(Example));
+		if (examples == NULL)
+		{
+			return FAILURE;
+		}
+		set->examples = examples;
+		set->capacity = capacity;
+	}
+	set->examples[set->count].discs[0] = pos->discs[0];
+	set->examples[set->count].discs[1] = pos->discs[1];
+	set->examples[set->count].result = result;
+	set->count++;
+	return SUCCESS;
+}
+/**
+ * @brief Picks the second and output layers an example trains, by the stage of its game.
+ */
+int example_bucket(const Example *example)
+{
+	return net_bucket(PLAYABLESQUARES - __builtin_popcountll(example->discs[0] | example->discs[1]));
+}
+/**
+ * @brief Draws the starting weights: small enough that the first layer starts inside its clipping range.
+ */
+void initialise_weights(FloatNetwork *net, uint64_t *rng)
+{
+	for (int f = 0; f < NET_INPUTS; f++)
+	{
+		for (int j = 0; j < NET_HIDDEN1; j++)
+		{
+			net->weights1[f][j] = random_uniform(rng, 0.1f);
+		}
+	}
+	for (int j = 0; j < NET_HIDDEN1; j++)
+	{
+		net->bias1[j] = 0.5f;
+	}
+	for (int b = 0; b < NET_BUCKETS; b++)
+	{
+		for (int k = 0; k < NET_HIDDEN2; k++)
+		{
+			for (int j = 0; j < NET_HIDDEN1; j++)
+			{
+				net->weights2[b][k][j] = random_uniform(rng, sqrtf(3.0f / NET_HIDDEN1));
+			}
+			net->bias2[b][k] = 0.5f;
+			net->weights3[b][k] = random_uniform(rng, 1.0f);
+		}
+		net->bias3[b] = 0;
+	}
+}
+/**
+ * @brief Draws a number uniformly from -limit to limit.
+ */
+float random_uniform(uint64_t *rng, float limit)
+{
+	return limit * (2.0f * (rng_next(rng) >> 11) / (float)(1ULL << 53) - 1.0f);
+}
+/**
+ * @brief Turns an example into the inputs and target of one step: seen by a random player, in a random
+ * 		  orientation.
+ *
+ * @param example The example.
+ * @param rng The random number generator.
+ * @param own The discs of the player the example is seen by.
+ * @param opp The other player's discs.
+ * @param target The final disc difference for that player.
+ */
+void sample(const Example *example, uint64_t *rng, uint64_t *own, uint64_t *opp, float *target)
+{
+	uint64_t bits = rng_next(rng);
+	int side = bits & 1;
+	int symmetry = (bits >> 1) % SYMMETRIES;
+
+	*own = transform_discs(example->discs[side], symmetry);
+	*opp = transform_discs(example->discs[1 - side], symmetry);
+	*target = side ? -example->result : example->result;
+}
+/**
+ * @brief Runs the network forward as the quantised one does, with activations clipped to 0..1.
+ *
+ * @return The output, in discs.
+ */
+float forward(const FloatNetwork *net, uint64_t own, uint64_t opp, int bucket, float *pre1, float *hidden1,
+			  float *pre2, float *hidden2)
+{
+	float output = net->bias3[bucket];
+
+	memcpy(pre1, net->bias1, sizeof(net->bias1));
+	for (int side = 0; side < 2; side++)
+	{
+		for (uint64_t discs = side ? opp : own; discs; discs &= discs - 1)
+		{
+			const float *row = net->weights1[side * PLAYABLESQUARES + __builtin_ctzll(discs)];
+			for (int j = 0; j < NET_HIDDEN1; j++)
+			{
+				pre1[j] += row[j];
+			}
+		}
+	}
+	for (int j = 0; j < NET_HIDDEN1; j++)
+	{
+		hidden1[j] = fminf(fmaxf(pre1[j], 0), 1);
+	}
+	for (int k = 0; k < NET_HIDDEN2; k++)
+	{
+		pre2[k] = net->bias2[bucket][k];
+		for (int j = 0; j < NET_HIDDEN1; j++)
+		{
+			pre2[k] += net->weights2[bucket][k][j] * hidden1[j];
+		}
+		hidden2[k] = fminf(fmaxf(pre2[k], 0), 1);
+		output += net->weights3[bucket][k] * hidden2[k];
+	}
+	return output;
+}
+/**
+ * @brief Adds the gradient of one example's squared error to the gradient of the batch.
+ *
+ * @param net The network.
+ * @param own The discs of the player scored for.
+ * @param opp The other player's discs.
+ * @param bucket The second and output layers of the example's stage.
+ * @param target The final disc difference for the player.
+ * @param scale The weight of the example in the batch.
+ * @param gradient The gradient, added to.
+ * @return The squared error.
+ */
+float backward(const FloatNetwork *net, uint64_t own, uint64_t opp, int bucket, float target, float scale,
+			   FloatNetwork *gradient)
+{
+	float pre1[NET_HIDDEN1];
+	float hidden1[NET_HIDDEN1];
+	float pre2[NET_HIDDEN2];
+	float hidden2[NET_HIDDEN2];
+	float delta1[NET_HIDDEN1] = {0};
+	float error = forward(net, own, opp, bucket, pre1, hidden1, pre2, hidden2) - target;
+	float delta = 2 * error * scale;
+
+	gradient->bias3[bucket] += delta;
+	for (int k = 0; k < NET_HIDDEN2; k++)
+	{
+		gradient->weights3[bucket][k] += delta * hidden2[k];
+		if (pre2[k] <= 0 || pre2[k] >= 1) // Clipped, no gradient
+		{
+			continue;
+		}
+		float delta2 = delta * net->weights3[bucket][k];
+		gradient->bias2[bucket][k] += delta2;
+		for (int j = 0; j < NET_HIDDEN1; j++)
+		{
+			gradient->weights2[bucket][k][j] += delta2 * hidden1[j];
+			delta1[j] += delta2 * net->weights2[bucket][k][j];
+		}
+	}
+	for (int j = 0; j < NET_HIDDEN1; j++)
+	{
+		if (pre1[j] <= 0 || pre1[j] >= 1)
+		{
+			delta1[j] = 0;
+		}
+		gradient->bias1[j] += delta1[j];
+	}
+	for (int side = 0; side < 2; side++)
+	{
+		for (uint64_t discs = side ? opp : own; discs; discs &= discs - 1)
+		{
+			float *row = gradient->weights1[side * PLAYABLESQUARES + __builtin_ctzll(discs)];
+			for (int j = 0; j < NET_HIDDEN1; j++)
+			{
+				row[j] += delta1[j];
+			}
+		}
+	}
+	return error * error;
+}
+/**
+ * @brief Takes one Adam step, then clips the weights to what their quantised form can hold.
+ */
+void adam_step(FloatNetwork *net, const FloatNetwork *gradient, FloatNetwork *moment1, FloatNetwork *moment2,
+			   float rate, long long step)
+{
+	float *params = (float *)net;
+	const float *grads = (const float *)gradient;
+	float *m = (float *)moment1;
+	float *v = (float *)moment2;
+	float correction1 = 1 - powf(ADAMBETA1, step);
+	float correction2 = 1 - powf(ADAMBETA2, step);
+
+	for (int i = 0; i < NETPARAMS; i++)
+	{
+		m[i] = ADAMBETA1 * m[i] + (1 - ADAMBETA1) * grads[i];
+		v[i] = ADAMBETA2 * v[i] + (1 - ADAMBETA2) * grads[i] * grads[i];
+		params[i] -= rate * (m[i] / correction1) / (sqrtf(v[i] / correction2) + ADAMEPSILON);
+	}
+	for (int f = 0; f < NET_INPUTS; f++)
+	{
+		for (int j = 0; j < NET_HIDDEN1; j++)
+		{
+			net->weights1[f][j] = clip(net->weights1[f][j], WEIGHT1LIMIT);
+		}
+	}
+	for (int j = 0; j < NET_HIDDEN1; j++)
+	{
+		net->bias1[j] = clip(net->bias1[j], WEIGHT1LIMIT);
+	}
+	for (int b = 0; b < NET_BUCKETS; b++)
+	{
+		for (int k = 0; k < NET_HIDDEN2; k++)
+		{
+			for (int j = 0; j < NET_HIDDEN1; j++)
+			{
+				net->weights2[b][k][j] = clip(net->weights2[b][k][j], WEIGHT2LIMIT);
+			}
+		}
+	}
+}
+/**
+ * @brief Sums the squared errors of the floating-point network on the held-out examples, scored for black as
+ * 		  quantised_error scores them, so that the two figures compare.
+ */
+double held_out_error(const FloatNetwork *net, const ExampleSet *held_out)
+{
+	float pre1[NET_HIDDEN1];
+	float hidden1[NET_HIDDEN1];
+	float pre2[NET_HIDDEN2];
+	float hidden2[NET_HIDDEN2];
+	double sum = 0;
+
+	for (long long i = 0; i < held_out->count; i++)
+	{
+		const Example *example = &held_out->examples[i];
+		float error = forward(net, example->discs[0], example->discs[1], example_bucket(example), pre1, hidden1,
+							  pre2, hidden2) - example->result;
+		sum += error * error;
+	}
+	return sum;
+}
+/**
+ * @brief Sums the squared errors of the quantised network on the held-out examples, scored for black.
+ */
+double quantised_error(const Network *net, const ExampleSet *held_out)
+{
+	NetAccumulator acc;
+	double sum = 0;
+
+	for (long long i = 0; i < held_out->count; i++)
+	{
+		Position pos;
+		pos.discs[0] = held_out->examples[i].discs[0];
+		pos.discs[1] = held_out->examples[i].discs[1];
+		pos.empties = PLAYABLESQUARES - __builtin_popcountll(pos.discs[0] | pos.discs[1]);
+		net_refresh(net, &pos, &acc);
+		double error = (double)net_evaluate(net, &acc, &pos, BLACK) / NET_SCORESCALE - held_out->examples[i].result;
+		sum += error * error;
+	}
+	return sum;
+}
+/**
+ * @brief Rounds the weights to the fixed-point form of net.h.
+ */
+void quantise(const FloatNetwork *net, Network *quantised)
+{
+	for (int f = 0; f < NET_INPUTS; f++)
+	{
+		for (int j = 0; j < NET_HIDDEN1; j++)
+		{
+			quantised->weights1[f][j] = lroundf(net->weights1[f][j] * NET_ONE);
+		}
+	}
+	for (int j = 0; j < NET_HIDDEN1; j++)
+	{
+		quantised->bias1[j] = lroundf(net->bias1[j] * NET_ONE);
+	}
+	for (int b = 0; b < NET_BUCKETS; b++)
+	{
+		for (int k = 0; k < NET_HIDDEN2; k++)
+		{
+			for (int j = 0; j < NET_HIDDEN1; j++)
+			{
+				quantised->weights2[b][k][j] = lroundf(net->weights2[b][k][j] * NET_WEIGHTSCALE);
+			}
+			quantised->bias2[b][k] = lroundf(net->bias2[b][k] * NET_ONE * NET_WEIGHTSCALE);
+			quantised->weights3[b][k] = lroundf(net->weights3[b][k] * NET_WEIGHTSCALE);
+		}
+		quantised->bias3[b] = lroundf(net->bias3[b] * NET_ONE * NET_WEIGHTSCALE);
+	}
+}
+/**
+ * @brief Clips a value to -limit..limit.
+ */
+float clip(float value, float limit)
+{
+	return fminf(fmaxf(value, -limit), limit);
+}
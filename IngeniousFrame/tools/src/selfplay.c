@@ -0,0 +1,361 @@
+/* vim: :se ai :se sw=4 :se ts=4 :se sts :se et */
+
+/*H**********************************************************************
+ *
+ *    Self-play game generator. Every MPI rank plays its share of the games
+ *    against itself and appends them to its own collection
+ *    <prefix>.<rank>.ogr (see gamerec.h), so the ranks never wait for each
+ *    other until the final summary.
+ *
+ *    Each game opens with a number of uniformly random moves, so that the
+ *    games differ, and is then played out by a fixed-depth Alpha/Beta
+ *    MiniMax search whose score is recorded for every searched move.
+ *
+ *    With --net the search evaluates with a network (net.h) instead of the
+ *    square weights, so that games of one network can train the next.
+ *
+ *    With --dedup a rank does not play the same opening twice: a random
+ *    opening that ends in a position the rank has already played from, in
+ *    any of its eight orientations (canonical_hash), is drawn again. When
+ *    few distinct openings exist, one is replayed after OPENINGDRAWS draws.
+ *
+ *    Usage: selfplay <prefix> [options]
+ *        --games <n>          games over all ranks (default 1000)
+ *        --depth <n>          search depth (default 4)
+ *        --random-plies <n>   random opening moves (default 8)
+ *        --seed <n>           seed; rank r plays with seed + r (default 1)
+ *        --dedup              no opening twice per rank, up to symmetry
+ *        --net <file>         evaluate with the network in the file
+ *
+ *H***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <mpi.h>
+#include "othello.h"
+
+#define OPENINGDRAWS 64 // random openings drawn per game before a duplicate is accepted
+
+/**
+ * Self-play settings, the same on every rank.
+ */
+typedef struct
+{
+	long long games;		 // games over all ranks
+	int depth;				 // search depth
+	int random_plies;		 // random opening moves per game
+	unsigned long long seed; // seed of rank 0
+	int dedup;				 // 1 to avoid replaying an opening
+	const char *net;		 // network file to evaluate with, NULL for the square weights
+} SelfPlayConfig;
+
+/**
+ * The canonical hashes of the openings a rank has played, in an open-addressing table that is never more than
+ * half full.
+ */
+typedef struct
+{
+	uint64_t *keys; // canonical hashes with the low bit set, 0 for a free slot
+	uint64_t mask;	// slots - 1, a power of two minus one
+} OpeningSet;
+
+int parse_options(int argc, char *argv[], SelfPlayConfig *config);
+void play_game(const SelfPlayConfig *config, uint64_t *rng, OpeningSet *seen, GameRecord *game);
+void play_opening(const SelfPlayConfig *config, uint64_t *rng, Position *pos, GameRecord *game);
+int opening_insert(OpeningSet *seen, const Position *pos);
+int search_move(const Position *pos, int depth, int *score);
+
+int main(int argc, char *argv[])
+{
+	int rank;
+	int size;
+	char prefix[GAMEREC_PATHBUFSIZE];
+	SelfPlayConfig config = {1000, 4, 8, 1, 0, NULL};
+	static Network net;
+	GameWriter writer;
+	GameRecord game;
+	OpeningSet seen = {NULL, 0};
+	long long local[4] = {0, 0, 0, 0}; // games, plies, nodes, distinct openings
+	long long total[4];
+	int ok = 1;
+	int all_ok;
+
+	MPI_Init(&argc, &argv);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	initialise_zobrist();
+	initialise_stability();
+
+	if (argc < 2 || parse_options(argc - 2, argv + 2, &config) == FAILURE)
+	{
+		if (rank == 0)
+		{
+			fprintf(stderr, "Usage: selfplay <prefix> [--games <n>] [--depth <n>] [--random-plies <n>] [--seed <n>] "
+							"[--dedup] [--net <file>]\n");
+		}
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+
+	if (config.net != NULL && net_load(&net, config.net) == FAILURE)
+	{
+		fprintf(stderr, "Rank %d: %s is not a network file\n", rank, config.net);
+		ok = 0;
+	}
+	search_network = (config.net != NULL) ? &net : NULL;
+
+	long long my_games = config.games / size + (rank < config.games % size);
+	if (config.dedup)
+	{
+		uint64_t slots = 2;
+		while (slots < 2 * (uint64_t)my_games)
+		{
+			slots *= 2;
+		}
+		seen.keys = (uint64_t *)calloc(slots, sizeof(uint64_t));
+		seen.mask = slots - 1;
+		if (seen.keys == NULL)
+		{
+			fprintf(stderr, "Rank %d: no memory for %llu openings\n", rank, (unsigned long long)slots);
+			ok = 0;
+		}
+	}
+	snprintf(prefix, GAMEREC_PATHBUFSIZE, "%s.%d", argv[1], rank);
+	if (ok && gamerec_open_writer(&writer, prefix) == FAILURE)
+	{
+		fprintf(stderr, "Rank %d: could not open %s%s\n", rank, prefix, GAMEREC_DATA);
+		ok = 0;
+		free(seen.keys);
+		seen.keys = NULL;
+	}
+	MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+	if (!all_ok)
+	{
+		if (ok)
+		{
+			gamerec_close_writer(&writer);
+		}
+		free(seen.keys);
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+
+	double start = MPI_Wtime();
+	uint64_t rng = config.seed + rank;
+	nodes_searched = 0;
+	node_limit = 0;
+	for (long long i = 0; i < my_games; i++)
+	{
+		play_game(&config, &rng, config.dedup ? &seen : NULL, &game);
+		if (gamerec_append(&writer, &game) == FAILURE)
+		{
+			fprintf(stderr, "Rank %d: could not write game %lld\n", rank, i);
+			break;
+		}
+		local[0]++;
+		local[1] += game.num_plies;
+	}
+	local[2] = nodes_searched;
+	for (uint64_t slot = 0; config.dedup && slot <= seen.mask; slot++)
+	{
+		local[3] += seen.keys[slot] != 0;
+	}
+	gamerec_close_writer(&writer);
+	free(seen.keys);
+
+	MPI_Reduce(local, total, 4, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+	if (rank == 0)
+	{
+		double elapsed = MPI_Wtime() - start;
+		printf("%lld games, %lld plies, %lld nodes on %d ranks in %.1fs (%.1f games/s), written to %s.<rank>%s\n",
+			   total[0], total[1], total[2], size, elapsed, total[0] / elapsed, argv[1], GAMEREC_DATA);
+		if (config.dedup)
+		{
+			printf("%lld openings, distinct on each rank up to symmetry\n", total[3]);
+		}
+	}
+	MPI_Finalize();
+	return EXIT_SUCCESS;
+}
+/**
+ * @brief Reads the options that follow the prefix.
+ *
+ * @param argc The number of options.
+ * @param argv The options.
+ * @param config The settings to update.
+ * @return SUCCESS, or FAILURE on an unknown or incomplete option.
+ */
+int parse_options(int argc, char *argv[], SelfPlayConfig *config)
+{
+	for (int i = 0; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+		{
+			config->games = atoll(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc)
+		{
+			config->depth = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--random-plies") == 0 && i + 1 < argc)
+		{
+			config->random_plies = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			config->seed = strtoull(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--dedup") == 0)
+		{
+			config->dedup = 1;
+		}
+		else if (strcmp(argv[i], "--net") == 0 && i + 1 < argc)
+		{
+			config->net = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return FAILURE;
+		}
+	}
+	config->depth = max(config->depth, 1);
+	config->random_plies = min(max(config->random_plies, 0), 60);
+	return SUCCESS;
+}
+/**
+ * @brief Plays one game from the starting position: random opening moves, then the search. A pass is recorded
+ * 		  when only one player cannot move, and the game ends when neither can.
+ *
+ * @param config The self-play settings.
+ * @param rng The random number generator of this rank.
+ * @param seen The openings played so far, to draw a new one; NULL to take the first opening drawn.
+ * @param game The game played.
+ */
+void play_game(const SelfPlayConfig *config, uint64_t *rng, OpeningSet *seen, GameRecord *game)
+{
+	Position pos;
+	int moves[LEGALMOVSBUFSIZE];
+	int n;
+
+	for (int draw = 1;; draw++)
+	{
+		play_opening(config, rng, &pos, game);
+		if (seen == NULL || opening_insert(seen, &pos) || draw >= OPENINGDRAWS)
+		{
+			break;
+		}
+	}
+	while (game->num_plies < GAMEREC_MAXPLIES)
+	{
+		int ply = game->num_plies;
+		n = legal_moves(&pos, moves);
+		if (n == 0)
+		{
+			Position passed = pos;
+			make_pass(&passed);
+			if (legal_moves(&passed, moves) == 0)
+			{
+				break; // Neither player can move
+			}
+			game->moves[ply] = GAMEREC_PASS;
+			game->scores[ply] = GAMEREC_NOSCORE;
+			pos = passed;
+		}
+		else
+		{
+			int score;
+			game->moves[ply] = search_move(&pos, config->depth, &score);
+			game->scores[ply] = min(max(score, -INT16_MAX), INT16_MAX);
+			make_move(&pos, game->moves[ply]);
+		}
+		game->num_plies++;
+	}
+	game->result = count(&pos, BLACK) - count(&pos, WHITE);
+}
+/**
+ * @brief Starts a game with the random opening moves. The opening ends early if a player has to pass.
+ *
+ * @param config The self-play settings.
+ * @param rng The random number generator of this rank.
+ * @param pos The position after the opening.
+ * @param game The game, holding only the opening.
+ */
+void play_opening(const SelfPlayConfig *config, uint64_t *rng, Position *pos, GameRecord *game)
+{
+	int moves[LEGALMOVSBUFSIZE];
+
+	initialise_position(pos);
+	game->num_plies = 0;
+	game->opening_plies = 0;
+	while (game->num_plies < config->random_plies)
+	{
+		int n = legal_moves(pos, moves);
+		if (n == 0)
+		{
+			break;
+		}
+		int ply = game->num_plies;
+		game->moves[ply] = moves[rng_next(rng) % n];
+		game->scores[ply] = GAMEREC_NOSCORE;
+		make_move(pos, game->moves[ply]);
+		game->num_plies++;
+		game->opening_plies++;
+	}
+}
+/**
+ * @brief Adds the position an opening ends in to the openings played, keyed on its canonical hash so that
+ * 		  rotated and reflected openings count as one.
+ *
+ * @param seen The openings played.
+ * @param pos The position after the opening.
+ * @return 1 if the opening is new, 0 if it was played before.
+ */
+int opening_insert(OpeningSet *seen, const Position *pos)
+{
+	uint64_t key = canonical_hash(pos) | 1;
+	uint64_t slot = key & seen->mask;
+
+	while (seen->keys[slot] != 0)
+	{
+		if (seen->keys[slot] == key)
+		{
+			return 0;
+		}
+		slot = (slot + 1) & seen->mask;
+	}
+	seen->keys[slot] = key;
+	return 1;
+}
+/**
+ * @brief Searches every legal move of a position to a fixed depth. Ties go to the first move generated.
+ *
+ * @param pos The position, with at least one legal move.
+ * @param depth The search depth.
+ * @param score The score of the best move for the player to move.
+ * @return The best move.
+ */
+int search_move(const Position *pos, int depth, int *score)
+{
+	int moves[LEGALMOVSBUFSIZE];
+	int n = legal_moves(pos, moves);
+	int best_move = moves[0];
+	int best_score = INT_MIN;
+
+	search_aborted = 0;
+	for (int i = 0; i < n; i++)
+	{
+		Position child = *pos;
+		make_move(&child, moves[i]);
+		int value = minimax(&child, pos->to_move, depth - 1, best_score, INT_MAX);
+		if (value > best_score)
+		{
+			best_score = value;
+			best_move = moves[i];
+		}
+	}
+	*score = best_score;
+	return best_move;
+}